@@ -0,0 +1,92 @@
+// baseline_pool.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _MJSYNC_BENCH_BASELINE_POOL_HPP_
+#define _MJSYNC_BENCH_BASELINE_POOL_HPP_
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mjx {
+    namespace bench {
+        class _Baseline_pool { // the textbook pool, std::thread workers around a single locked queue
+        public:
+            using _Callable = void(*)(void*);
+
+            explicit _Baseline_pool(const size_t _Count)
+                : _Myqueue(), _Mylock(), _Mycv(), _Mythreads(), _Mystop(false) {
+                _Mythreads.reserve(_Count);
+                for (size_t _Idx = 0; _Idx < _Count; ++_Idx) {
+                    _Mythreads.emplace_back(&_Baseline_pool::_Work, this);
+                }
+            }
+
+            ~_Baseline_pool() noexcept {
+                {
+                    ::std::lock_guard _Guard(_Mylock);
+                    _Mystop = true;
+                }
+
+                _Mycv.notify_all();
+                for (::std::thread& _Thread : _Mythreads) {
+                    _Thread.join();
+                }
+            }
+
+            _Baseline_pool(const _Baseline_pool&)            = delete;
+            _Baseline_pool& operator=(const _Baseline_pool&) = delete;
+
+            size_t _Thread_count() const noexcept {
+                return _Mythreads.size();
+            }
+
+            void _Submit(const _Callable _Func, void* const _Arg) {
+                // Note: The baseline has no priorities, the tasks always run in the submission order.
+                {
+                    ::std::lock_guard _Guard(_Mylock);
+                    _Myqueue.push_back(_Entry{_Func, _Arg});
+                }
+
+                _Mycv.notify_one();
+            }
+
+        private:
+            struct _Entry {
+                _Callable _Func;
+                void* _Arg;
+            };
+
+            void _Work() {
+                for (;;) {
+                    _Entry _Next;
+                    {
+                        ::std::unique_lock _Guard(_Mylock);
+                        _Mycv.wait(_Guard, [this] { return _Mystop || !_Myqueue.empty(); });
+                        if (_Myqueue.empty()) { // stopped and drained, break
+                            return;
+                        }
+
+                        _Next = _Myqueue.front();
+                        _Myqueue.pop_front();
+                    }
+
+                    _Next._Func(_Next._Arg);
+                }
+            }
+
+            ::std::deque<_Entry> _Myqueue;
+            ::std::mutex _Mylock;
+            ::std::condition_variable _Mycv;
+            ::std::vector<::std::thread> _Mythreads;
+            bool _Mystop; // guarded by _Mylock
+        };
+    } // namespace bench
+} // namespace mjx
+
+#endif // _MJSYNC_BENCH_BASELINE_POOL_HPP_
\ No newline at end of file
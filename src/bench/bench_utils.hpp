@@ -0,0 +1,241 @@
+// bench_utils.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _MJSYNC_BENCH_BENCH_UTILS_HPP_
+#define _MJSYNC_BENCH_BENCH_UTILS_HPP_
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace mjx {
+    namespace bench {
+        using _Clock = ::std::chrono::steady_clock;
+
+        inline uint64_t _Elapsed_ns(const _Clock::time_point _Start, const _Clock::time_point _End) noexcept {
+            return static_cast<uint64_t>(
+                ::std::chrono::duration_cast<::std::chrono::nanoseconds>(_End - _Start).count());
+        }
+
+        inline void _Spin_for(const uint64_t _Nanoseconds) noexcept {
+            // busy work that keeps the worker occupied without touching shared memory
+            const _Clock::time_point _Start = _Clock::now();
+            while (_Elapsed_ns(_Start, _Clock::now()) < _Nanoseconds) {
+            }
+        }
+
+        inline void _Wait_for_zero(const ::std::atomic<size_t>& _Counter) noexcept {
+            while (_Counter.load(::std::memory_order_acquire) != 0) {
+                ::std::this_thread::yield();
+            }
+        }
+
+        inline double _Median(::std::vector<double> _Values) {
+            if (_Values.empty()) {
+                return 0.0;
+            }
+
+            ::std::sort(_Values.begin(), _Values.end());
+            const size_t _Mid = _Values.size() / 2;
+            return _Values.size() % 2 != 0 ? _Values[_Mid] : (_Values[_Mid - 1] + _Values[_Mid]) / 2.0;
+        }
+
+        template <class _Fn>
+        double _Measure(const size_t _Repetitions, _Fn&& _Run) {
+            // returns the median duration of the runs in seconds, the first run only warms up
+            _Run();
+            ::std::vector<double> _Samples;
+            _Samples.reserve(_Repetitions);
+            for (size_t _Idx = 0; _Idx < _Repetitions; ++_Idx) {
+                const _Clock::time_point _Start = _Clock::now();
+                _Run();
+                _Samples.push_back(static_cast<double>(_Elapsed_ns(_Start, _Clock::now())) / 1e9);
+            }
+
+            return _Median(::std::move(_Samples));
+        }
+
+        template <class _Fn>
+        void _Run_concurrently(const size_t _Count, _Fn&& _Func) {
+            // starts _Count threads, releases them at once and waits until all of them return,
+            // each thread receives its index
+            ::std::atomic<bool> _Go{false};
+            ::std::vector<::std::thread> _Threads;
+            _Threads.reserve(_Count);
+            for (size_t _Idx = 0; _Idx < _Count; ++_Idx) {
+                _Threads.emplace_back([&_Go, &_Func, _Idx] {
+                    while (!_Go.load(::std::memory_order_acquire)) {
+                        ::std::this_thread::yield();
+                    }
+
+                    _Func(_Idx);
+                });
+            }
+
+            _Go.store(true, ::std::memory_order_release);
+            for (::std::thread& _Thread : _Threads) {
+                _Thread.join();
+            }
+        }
+
+        inline ::std::vector<size_t> _Thread_counts(const size_t _Max) {
+            // powers of two below _Max, then _Max itself, the points of a scalability curve
+            ::std::vector<size_t> _Counts;
+            for (size_t _Count = 1; _Count < _Max; _Count *= 2) {
+                _Counts.push_back(_Count);
+            }
+
+            _Counts.push_back(_Max);
+            return _Counts;
+        }
+
+        struct _Options {
+            size_t _Threads     = 0; // zero selects the number of hardware threads
+            size_t _Tasks       = 0; // zero selects the suite's default
+            size_t _Repetitions = 5;
+            const char* _Output = nullptr; // null writes to the standard output
+            const char* _Filter = nullptr; // runs only the workloads whose name contains it
+            bool _Valid         = true;
+
+            bool _Selected(const char* const _Name) const noexcept {
+                return !_Filter || ::strstr(_Name, _Filter) != nullptr;
+            }
+        };
+
+        inline size_t _Hardware_threads() noexcept {
+            const unsigned int _Count = ::std::thread::hardware_concurrency();
+            return _Count > 0 ? _Count : 1;
+        }
+
+        inline _Options _Parse_options(const int _Argc, char** const _Argv) {
+            _Options _Opts;
+            for (int _Idx = 1; _Idx < _Argc; ++_Idx) {
+                const char* const _Arg   = _Argv[_Idx];
+                const char* const _Value = _Idx + 1 < _Argc ? _Argv[_Idx + 1] : nullptr;
+                if (!_Value) { // every option takes a value
+                    _Opts._Valid = false;
+                    break;
+                }
+
+                if (::strcmp(_Arg, "--threads") == 0) {
+                    _Opts._Threads = static_cast<size_t>(::strtoull(_Value, nullptr, 10));
+                } else if (::strcmp(_Arg, "--tasks") == 0) {
+                    _Opts._Tasks = static_cast<size_t>(::strtoull(_Value, nullptr, 10));
+                } else if (::strcmp(_Arg, "--repetitions") == 0) {
+                    _Opts._Repetitions = static_cast<size_t>(::strtoull(_Value, nullptr, 10));
+                } else if (::strcmp(_Arg, "--output") == 0) {
+                    _Opts._Output = _Value;
+                } else if (::strcmp(_Arg, "--filter") == 0) {
+                    _Opts._Filter = _Value;
+                } else {
+                    _Opts._Valid = false;
+                    break;
+                }
+
+                ++_Idx;
+            }
+
+            if (_Opts._Threads == 0) {
+                _Opts._Threads = _Hardware_threads();
+            }
+
+            if (_Opts._Repetitions == 0) {
+                _Opts._Repetitions = 1;
+            }
+
+            return _Opts;
+        }
+
+        inline void _Print_usage(const char* const _Program) noexcept {
+            ::fprintf(stderr, "usage: %s [--threads N] [--tasks N] [--repetitions N] [--filter NAME] [--output PATH]\n",
+                _Program);
+        }
+
+        class _Json_record { // flat JSON object, the fields keep their insertion order
+        public:
+            _Json_record& _Set(const char* const _Key, const char* const _Value) {
+                ::std::string _Quoted = "\"";
+                for (const char* _Ch = _Value; *_Ch; ++_Ch) {
+                    if (*_Ch == '"' || *_Ch == '\\') {
+                        _Quoted += '\\';
+                    }
+
+                    _Quoted += *_Ch;
+                }
+
+                _Quoted += '"';
+                _Myfields.emplace_back(_Key, ::std::move(_Quoted));
+                return *this;
+            }
+
+            _Json_record& _Set(const char* const _Key, const uint64_t _Value) {
+                _Myfields.emplace_back(_Key, ::std::to_string(_Value));
+                return *this;
+            }
+
+            _Json_record& _Set(const char* const _Key, const double _Value) {
+                char _Buf[32];
+                ::snprintf(_Buf, sizeof(_Buf), "%.3f", _Value);
+                _Myfields.emplace_back(_Key, _Buf);
+                return *this;
+            }
+
+            ::std::string _Str() const {
+                ::std::string _Result = "{";
+                for (size_t _Idx = 0; _Idx < _Myfields.size(); ++_Idx) {
+                    if (_Idx > 0) {
+                        _Result += ", ";
+                    }
+
+                    _Result += '"';
+                    _Result += _Myfields[_Idx].first;
+                    _Result += "\": ";
+                    _Result += _Myfields[_Idx].second;
+                }
+
+                _Result += '}';
+                return _Result;
+            }
+
+        private:
+            ::std::vector<::std::pair<::std::string, ::std::string>> _Myfields;
+        };
+
+        inline bool _Write_report(const _Options& _Opts, const _Json_record& _Header,
+            const ::std::vector<_Json_record>& _Results) {
+            // the header fields describe the run, the results are listed under "results"
+            ::std::string _Text = _Header._Str();
+            _Text.pop_back(); // reopen the header object
+            _Text += _Text.size() > 1 ? ", \"results\": [" : "\"results\": [";
+            for (size_t _Idx = 0; _Idx < _Results.size(); ++_Idx) {
+                _Text += _Idx > 0 ? ",\n    " : "\n    ";
+                _Text += _Results[_Idx]._Str();
+            }
+
+            _Text += "\n]}\n";
+            FILE* const _File = _Opts._Output ? ::fopen(_Opts._Output, "wb") : stdout;
+            if (!_File) {
+                return false;
+            }
+
+            const bool _Written = ::fwrite(_Text.data(), 1, _Text.size(), _File) == _Text.size();
+            if (_File != stdout) {
+                return ::fclose(_File) == 0 && _Written;
+            }
+
+            return ::fflush(_File) == 0 && _Written;
+        }
+    } // namespace bench
+} // namespace mjx
+
+#endif // _MJSYNC_BENCH_BENCH_UTILS_HPP_
\ No newline at end of file
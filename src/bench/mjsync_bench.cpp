@@ -0,0 +1,508 @@
+// mjsync_bench.cpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <atomic>
+#include <bench/baseline_pool.hpp>
+#include <bench/bench_utils.hpp>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mjsync/async.hpp>
+#include <mjsync/latency_histogram.hpp>
+#include <mjsync/thread.hpp>
+#include <mjsync/thread_pool.hpp>
+#include <thread>
+#include <vector>
+
+// Note: Every workload runs on each target in turn: mjsync's thread_pool, a single mjsync thread, async()
+//       over a thread_pool, and the std::thread pools with the same number of workers. Each target is created
+//       before its runs and destroyed after them, so that the idle workers of one target never compete with
+//       the next one. The throughput results are the median of the repetitions, after one untimed warm-up run.
+
+namespace mjx {
+    namespace bench {
+        class _Bench_target { // a scheduler under test, the callable may run on any of its workers
+        public:
+            using _Callable = void(*)(void*);
+
+            virtual ~_Bench_target() noexcept {}
+
+            virtual void _Submit(const _Callable _Func, void* const _Arg, const task_priority _Priority) = 0;
+        };
+
+        class _Pool_target : public _Bench_target {
+        public:
+            explicit _Pool_target(const size_t _Count) : _Mypool(_Count) {}
+
+            void _Submit(const _Callable _Func, void* const _Arg, const task_priority _Priority) override {
+                _Mypool.schedule_task(_Func, _Arg, _Priority);
+            }
+
+        private:
+            thread_pool _Mypool;
+        };
+
+        class _Thread_target : public _Bench_target {
+        public:
+            _Thread_target() : _Mythread() {}
+
+            void _Submit(const _Callable _Func, void* const _Arg, const task_priority _Priority) override {
+                _Mythread.schedule_task(_Func, _Arg, _Priority);
+            }
+
+        private:
+            thread _Mythread;
+        };
+
+        class _Async_target : public _Bench_target {
+        public:
+            explicit _Async_target(const size_t _Count) : _Mypool(_Count) {}
+
+            void _Submit(const _Callable _Func, void* const _Arg, const task_priority _Priority) override {
+                (void) ::mjx::async(_Mypool, _Priority, _Func, _Arg); // the future is dropped, completion is counted
+            }
+
+        private:
+            thread_pool _Mypool;
+        };
+
+        class _Std_target : public _Bench_target {
+        public:
+            explicit _Std_target(const size_t _Count) : _Mypool(_Count) {}
+
+            void _Submit(const _Callable _Func, void* const _Arg, const task_priority) override {
+                _Mypool._Submit(_Func, _Arg);
+            }
+
+        private:
+            _Baseline_pool _Mypool;
+        };
+
+        struct _Target_info {
+            const char* _Name;
+            size_t _Workers;
+            bool _Is_baseline; // compared against by the targets with the same number of workers
+            ::std::function<::std::unique_ptr<_Bench_target>()> _Create;
+        };
+
+        ::std::vector<_Target_info> _Make_targets(const size_t _Threads) {
+            // each baseline precedes the targets it is compared against
+            ::std::vector<_Target_info> _Targets;
+            _Targets.push_back({"std_thread_pool", _Threads, true,
+                [_Threads] { return ::std::make_unique<_Std_target>(_Threads); }});
+            _Targets.push_back({"thread_pool", _Threads, false,
+                [_Threads] { return ::std::make_unique<_Pool_target>(_Threads); }});
+            _Targets.push_back({"async", _Threads, false,
+                [_Threads] { return ::std::make_unique<_Async_target>(_Threads); }});
+            _Targets.push_back({"std_thread_single", 1, true,
+                [] { return ::std::make_unique<_Std_target>(1); }});
+            _Targets.push_back({"thread", 1, false,
+                [] { return ::std::make_unique<_Thread_target>(); }});
+            return _Targets;
+        }
+
+        class _Baseline_table { // values of the baseline targets, keyed by the number of workers and a variant
+        public:
+            void _Store(const size_t _Workers, const uint64_t _Variant, const double _Value) {
+                _Myentries.push_back({_Workers, _Variant, _Value});
+            }
+
+            double _Find(const size_t _Workers, const uint64_t _Variant) const noexcept {
+                for (const _Entry& _Item : _Myentries) {
+                    if (_Item._Workers == _Workers && _Item._Variant == _Variant) {
+                        return _Item._Value;
+                    }
+                }
+
+                return 0.0;
+            }
+
+        private:
+            struct _Entry {
+                size_t _Workers;
+                uint64_t _Variant;
+                double _Value;
+            };
+
+            ::std::vector<_Entry> _Myentries;
+        };
+
+        void _Compare(_Json_record& _Record, const _Target_info& _Target, _Baseline_table& _Table,
+            const uint64_t _Variant, const double _Cost) {
+            // the cost is a duration or a latency, the speedup is above one if the target is faster than the baseline
+            if (_Target._Is_baseline) {
+                _Table._Store(_Target._Workers, _Variant, _Cost);
+                return;
+            }
+
+            const double _Baseline = _Table._Find(_Target._Workers, _Variant);
+            if (_Baseline > 0.0 && _Cost > 0.0) {
+                _Record._Set("speedup_vs_baseline", _Baseline / _Cost);
+            }
+        }
+
+        void _Add_percentiles(_Json_record& _Record, const latency_histogram& _Hist) {
+            _Record._Set("samples", _Hist.count())
+                ._Set("mean_ns", static_cast<uint64_t>(_Hist.mean().count()))
+                ._Set("p50_ns", static_cast<uint64_t>(_Hist.percentile(50.0).count()))
+                ._Set("p90_ns", static_cast<uint64_t>(_Hist.percentile(90.0).count()))
+                ._Set("p99_ns", static_cast<uint64_t>(_Hist.percentile(99.0).count()))
+                ._Set("p999_ns", static_cast<uint64_t>(_Hist.percentile(99.9).count()))
+                ._Set("max_ns", static_cast<uint64_t>(_Hist.maximum().count()));
+        }
+
+        void _Count_down(void* const _Arg) {
+            static_cast<::std::atomic<size_t>*>(_Arg)->fetch_sub(1, ::std::memory_order_release);
+        }
+
+        void _Empty_throughput(const _Options& _Opts, ::std::vector<_Json_record>& _Results) {
+            // one producer submits empty tasks as fast as it can, measures the per-task overhead
+            const size_t _Tasks = _Opts._Tasks;
+            _Baseline_table _Table;
+            for (const _Target_info& _Target : _Make_targets(_Opts._Threads)) {
+                ::std::unique_ptr<_Bench_target> _Impl = _Target._Create();
+                ::std::atomic<size_t> _Remaining{0};
+                const double _Seconds = _Measure(_Opts._Repetitions, [&] {
+                    _Remaining.store(_Tasks, ::std::memory_order_relaxed);
+                    for (size_t _Idx = 0; _Idx < _Tasks; ++_Idx) {
+                        _Impl->_Submit(&_Count_down, &_Remaining, task_priority::normal);
+                    }
+
+                    _Wait_for_zero(_Remaining);
+                });
+
+                _Json_record _Record;
+                _Record._Set("workload", "empty_throughput")._Set("target", _Target._Name)
+                    ._Set("workers", _Target._Workers)._Set("tasks", _Tasks)._Set("seconds", _Seconds)
+                    ._Set("tasks_per_second", static_cast<double>(_Tasks) / _Seconds);
+                _Compare(_Record, _Target, _Table, 0, _Seconds);
+                _Results.push_back(::std::move(_Record));
+            }
+        }
+
+        struct _Latency_probe {
+            _Clock::time_point _Submitted;
+            _Clock::time_point _Started;
+            ::std::atomic<bool> _Done{false};
+        };
+
+        void _Stamp_start(void* const _Arg) {
+            _Latency_probe* const _Probe = static_cast<_Latency_probe*>(_Arg);
+            _Probe->_Started             = _Clock::now();
+            _Probe->_Done.store(true, ::std::memory_order_release);
+        }
+
+        void _Submit_latency(const _Options& _Opts, ::std::vector<_Json_record>& _Results) {
+            // one task at a time, so the latency includes waking an idle worker but never queueing
+            const size_t _Samples = _Opts._Tasks / 10 > 0 ? _Opts._Tasks / 10 : 1;
+            _Baseline_table _Table;
+            for (const _Target_info& _Target : _Make_targets(_Opts._Threads)) {
+                ::std::unique_ptr<_Bench_target> _Impl = _Target._Create();
+                latency_histogram _Hist;
+                for (size_t _Idx = 0; _Idx < _Samples; ++_Idx) {
+                    _Latency_probe _Probe;
+                    _Probe._Submitted = _Clock::now();
+                    _Impl->_Submit(&_Stamp_start, &_Probe, task_priority::normal);
+                    while (!_Probe._Done.load(::std::memory_order_acquire)) {
+                        ::std::this_thread::yield();
+                    }
+
+                    _Hist.record(_Probe._Started - _Probe._Submitted);
+                }
+
+                _Json_record _Record;
+                _Record._Set("workload", "submit_latency")._Set("target", _Target._Name)
+                    ._Set("workers", _Target._Workers);
+                _Add_percentiles(_Record, _Hist);
+                _Compare(_Record, _Target, _Table, 0, static_cast<double>(_Hist.percentile(50.0).count()));
+                _Results.push_back(::std::move(_Record));
+            }
+        }
+
+        void _Spin_and_count_down(void* const _Arg) {
+            _Spin_for(1000);
+            _Count_down(_Arg);
+        }
+
+        void _Fan_out_fan_in(const _Options& _Opts, ::std::vector<_Json_record>& _Results) {
+            // rounds of short tasks, each round waits for all of its tasks before the next one starts
+            _Baseline_table _Table;
+            for (const _Target_info& _Target : _Make_targets(_Opts._Threads)) {
+                const size_t _Width  = _Target._Workers * 4;
+                const size_t _Rounds = _Opts._Tasks / 4 / _Width > 0 ? _Opts._Tasks / 4 / _Width : 1;
+                ::std::unique_ptr<_Bench_target> _Impl = _Target._Create();
+                ::std::atomic<size_t> _Remaining{0};
+                const double _Seconds = _Measure(_Opts._Repetitions, [&] {
+                    for (size_t _Round = 0; _Round < _Rounds; ++_Round) {
+                        _Remaining.store(_Width, ::std::memory_order_relaxed);
+                        for (size_t _Idx = 0; _Idx < _Width; ++_Idx) {
+                            _Impl->_Submit(&_Spin_and_count_down, &_Remaining, task_priority::normal);
+                        }
+
+                        _Wait_for_zero(_Remaining);
+                    }
+                });
+
+                // the ideal time assumes the work is spread perfectly and costs nothing to schedule
+                const double _Ideal = static_cast<double>(_Rounds) * 4 * 1e-6;
+                _Json_record _Record;
+                _Record._Set("workload", "fan_out_fan_in")._Set("target", _Target._Name)
+                    ._Set("workers", _Target._Workers)._Set("width", _Width)._Set("rounds", _Rounds)
+                    ._Set("task_ns", uint64_t{1000})._Set("seconds", _Seconds)
+                    ._Set("rounds_per_second", static_cast<double>(_Rounds) / _Seconds)
+                    ._Set("efficiency", _Ideal / _Seconds);
+                _Compare(_Record, _Target, _Table, 0, _Seconds);
+                _Results.push_back(::std::move(_Record));
+            }
+        }
+
+        struct _Fork_node;
+
+        struct _Fork_context {
+            _Bench_target* _Target;
+            _Fork_node* _Nodes; // an implicit binary heap, the children of node i are 2i+1 and 2i+2
+            size_t _Leaves; // index of the first leaf
+            ::std::atomic<size_t> _Remaining;
+        };
+
+        struct _Fork_node {
+            _Fork_context* _Context;
+            size_t _Index;
+        };
+
+        void _Fork(void* const _Arg) {
+            // each inner node spawns its two children from the worker that runs it, the leaves only count down
+            _Fork_node* const _Node       = static_cast<_Fork_node*>(_Arg);
+            _Fork_context* const _Context = _Node->_Context;
+            if (_Node->_Index < _Context->_Leaves) {
+                _Fork_node* const _Children = _Context->_Nodes + 2 * _Node->_Index;
+                _Context->_Target->_Submit(&_Fork, _Children + 1, task_priority::normal);
+                _Context->_Target->_Submit(&_Fork, _Children + 2, task_priority::normal);
+            }
+
+            _Context->_Remaining.fetch_sub(1, ::std::memory_order_release);
+        }
+
+        void _Fork_join(const _Options& _Opts, ::std::vector<_Json_record>& _Results) {
+            // a binary tree of tasks that spawn their children, the join counts every node
+            size_t _Depth = 1;
+            while ((size_t{2} << (_Depth + 1)) - 1 <= _Opts._Tasks) {
+                ++_Depth;
+            }
+
+            const size_t _Count = (size_t{2} << _Depth) - 1;
+            _Baseline_table _Table;
+            for (const _Target_info& _Target : _Make_targets(_Opts._Threads)) {
+                ::std::unique_ptr<_Bench_target> _Impl = _Target._Create();
+                ::std::vector<_Fork_node> _Nodes(_Count);
+                _Fork_context _Context{_Impl.get(), _Nodes.data(), (size_t{1} << _Depth) - 1, 0};
+                for (size_t _Idx = 0; _Idx < _Count; ++_Idx) {
+                    _Nodes[_Idx] = _Fork_node{&_Context, _Idx};
+                }
+
+                const double _Seconds = _Measure(_Opts._Repetitions, [&] {
+                    _Context._Remaining.store(_Count, ::std::memory_order_relaxed);
+                    _Impl->_Submit(&_Fork, &_Nodes[0], task_priority::normal);
+                    _Wait_for_zero(_Context._Remaining);
+                });
+
+                _Json_record _Record;
+                _Record._Set("workload", "fork_join")._Set("target", _Target._Name)
+                    ._Set("workers", _Target._Workers)._Set("depth", _Depth)._Set("tasks", _Count)
+                    ._Set("seconds", _Seconds)._Set("tasks_per_second", static_cast<double>(_Count) / _Seconds);
+                _Compare(_Record, _Target, _Table, 0, _Seconds);
+                _Results.push_back(::std::move(_Record));
+            }
+        }
+
+        struct _Priority_probe {
+            _Clock::time_point _Submitted;
+            _Clock::time_point _Started;
+            ::std::atomic<size_t>* _Remaining;
+        };
+
+        void _Stamp_priority(void* const _Arg) {
+            _Priority_probe* const _Probe = static_cast<_Priority_probe*>(_Arg);
+            _Probe->_Started              = _Clock::now();
+            _Spin_for(200);
+            _Count_down(_Probe->_Remaining);
+        }
+
+        void _Mixed_priorities(const _Options& _Opts, ::std::vector<_Json_record>& _Results) {
+            // a burst of tasks with all priorities interleaved, the latency of each priority shows
+            // how much the scheduler favors the urgent tasks once the workers fall behind
+            constexpr task_priority _Priorities[] = {task_priority::idle, task_priority::below_normal,
+                task_priority::normal, task_priority::above_normal, task_priority::real_time};
+            constexpr const char* _Names[]        = {"idle", "below_normal", "normal", "above_normal", "real_time"};
+            constexpr size_t _Levels              = sizeof(_Priorities) / sizeof(_Priorities[0]);
+            const size_t _Tasks                   = _Opts._Tasks / 10 > _Levels ? _Opts._Tasks / 10 : _Levels;
+            _Baseline_table _Table;
+            for (const _Target_info& _Target : _Make_targets(_Opts._Threads)) {
+                ::std::unique_ptr<_Bench_target> _Impl = _Target._Create();
+                ::std::atomic<size_t> _Remaining{0};
+                ::std::vector<_Priority_probe> _Probes(_Tasks);
+                latency_histogram _Hists[_Levels];
+                const double _Seconds = _Measure(_Opts._Repetitions, [&] {
+                    _Remaining.store(_Tasks, ::std::memory_order_relaxed);
+                    for (size_t _Idx = 0; _Idx < _Tasks; ++_Idx) {
+                        _Probes[_Idx]._Remaining = &_Remaining;
+                        _Probes[_Idx]._Submitted = _Clock::now();
+                        _Impl->_Submit(&_Stamp_priority, &_Probes[_Idx], _Priorities[_Idx % _Levels]);
+                    }
+
+                    _Wait_for_zero(_Remaining);
+                    for (size_t _Idx = 0; _Idx < _Tasks; ++_Idx) {
+                        _Hists[_Idx % _Levels].record(_Probes[_Idx]._Started - _Probes[_Idx]._Submitted);
+                    }
+                });
+
+                for (size_t _Level = 0; _Level < _Levels; ++_Level) {
+                    _Json_record _Record;
+                    _Record._Set("workload", "mixed_priorities")._Set("target", _Target._Name)
+                        ._Set("workers", _Target._Workers)._Set("priority", _Names[_Level])
+                        ._Set("tasks", _Tasks)._Set("seconds", _Seconds);
+                    _Add_percentiles(_Record, _Hists[_Level]);
+                    _Compare(_Record, _Target, _Table, _Level,
+                        static_cast<double>(_Hists[_Level].percentile(50.0).count()));
+                    _Results.push_back(::std::move(_Record));
+                }
+            }
+        }
+
+        void _Producer_scaling(const _Options& _Opts, ::std::vector<_Json_record>& _Results) {
+            // the same number of empty tasks, submitted by 1 to N threads at once
+            const ::std::vector<size_t> _Counts = _Thread_counts(_Opts._Threads);
+            _Baseline_table _Table;
+            for (const _Target_info& _Target : _Make_targets(_Opts._Threads)) {
+                ::std::unique_ptr<_Bench_target> _Impl = _Target._Create();
+                for (const size_t _Producers : _Counts) {
+                    const size_t _Per_producer = _Opts._Tasks / _Producers > 0 ? _Opts._Tasks / _Producers : 1;
+                    const size_t _Tasks        = _Per_producer * _Producers;
+                    ::std::atomic<size_t> _Remaining{0};
+                    const double _Seconds = _Measure(_Opts._Repetitions, [&] {
+                        _Remaining.store(_Tasks, ::std::memory_order_relaxed);
+                        _Run_concurrently(_Producers, [&](size_t) {
+                            for (size_t _Task = 0; _Task < _Per_producer; ++_Task) {
+                                _Impl->_Submit(&_Count_down, &_Remaining, task_priority::normal);
+                            }
+                        });
+
+                        _Wait_for_zero(_Remaining);
+                    });
+
+                    _Json_record _Record;
+                    _Record._Set("workload", "producer_scaling")._Set("target", _Target._Name)
+                        ._Set("workers", _Target._Workers)._Set("producers", _Producers)._Set("tasks", _Tasks)
+                        ._Set("seconds", _Seconds)._Set("tasks_per_second", static_cast<double>(_Tasks) / _Seconds);
+                    _Compare(_Record, _Target, _Table, _Producers, _Seconds);
+                    _Results.push_back(::std::move(_Record));
+                }
+            }
+        }
+
+        struct _Queue_blocker { // occupies every worker, so that the submitted tasks stay queued
+            ::std::atomic<size_t> _Started{0};
+            ::std::atomic<bool> _Released{false};
+            ::std::atomic<size_t>* _Remaining;
+        };
+
+        void _Block_worker(void* const _Arg) {
+            _Queue_blocker* const _Blocker = static_cast<_Queue_blocker*>(_Arg);
+            _Blocker->_Started.fetch_add(1, ::std::memory_order_release);
+            while (!_Blocker->_Released.load(::std::memory_order_acquire)) {
+                ::std::this_thread::yield();
+            }
+
+            _Count_down(_Blocker->_Remaining);
+        }
+
+        void _Queue_depth_latency(const _Options& _Opts, ::std::vector<_Json_record>& _Results) {
+            // Note: The workers are blocked while the queue is filled to the given depth, then the cost of
+            //       each further submission is timed. A queue that scales keeps the latency flat from 10
+            //       to 1,000,000 pending tasks. Each round times at most a tenth of the depth, so the depth
+            //       barely changes while sampling, the small depths take more rounds to collect the samples.
+            constexpr size_t _Depths[] = {10, 100, 1000, 10000, 100000, 1000000};
+            constexpr size_t _Samples  = 1000;
+            _Baseline_table _Table;
+            for (const _Target_info& _Target : _Make_targets(_Opts._Threads)) {
+                ::std::unique_ptr<_Bench_target> _Impl = _Target._Create();
+                for (const size_t _Depth : _Depths) {
+                    const size_t _Window = _Depth / 10 < _Samples ? (_Depth / 10 > 0 ? _Depth / 10 : 1) : _Samples;
+                    ::std::atomic<size_t> _Remaining{0};
+                    latency_histogram _Hist;
+                    while (_Hist.count() < _Samples) {
+                        _Queue_blocker _Blocker;
+                        _Blocker._Remaining = &_Remaining;
+                        _Remaining.store(_Target._Workers + _Depth + _Window, ::std::memory_order_relaxed);
+                        for (size_t _Idx = 0; _Idx < _Target._Workers; ++_Idx) {
+                            _Impl->_Submit(&_Block_worker, &_Blocker, task_priority::normal);
+                        }
+
+                        while (_Blocker._Started.load(::std::memory_order_acquire) < _Target._Workers) {
+                            ::std::this_thread::yield();
+                        }
+
+                        for (size_t _Idx = 0; _Idx < _Depth; ++_Idx) {
+                            _Impl->_Submit(&_Count_down, &_Remaining, task_priority::normal);
+                        }
+
+                        for (size_t _Idx = 0; _Idx < _Window; ++_Idx) {
+                            const _Clock::time_point _Start = _Clock::now();
+                            _Impl->_Submit(&_Count_down, &_Remaining, task_priority::normal);
+                            _Hist.record(_Clock::now() - _Start);
+                        }
+
+                        _Blocker._Released.store(true, ::std::memory_order_release);
+                        _Wait_for_zero(_Remaining);
+                    }
+
+                    _Json_record _Record;
+                    _Record._Set("workload", "queue_depth_latency")._Set("target", _Target._Name)
+                        ._Set("workers", _Target._Workers)._Set("depth", _Depth);
+                    _Add_percentiles(_Record, _Hist);
+                    _Compare(_Record, _Target, _Table, _Depth, static_cast<double>(_Hist.percentile(50.0).count()));
+                    _Results.push_back(::std::move(_Record));
+                }
+            }
+        }
+    } // namespace bench
+} // namespace mjx
+
+int main(int _Argc, char** _Argv) {
+    using namespace ::mjx::bench;
+    _Options _Opts = _Parse_options(_Argc, _Argv);
+    if (!_Opts._Valid) {
+        _Print_usage(_Argv[0]);
+        return 2;
+    }
+
+    if (_Opts._Tasks == 0) {
+        _Opts._Tasks = 200000;
+    }
+
+    struct _Workload {
+        const char* _Name;
+        void (*_Run)(const _Options&, ::std::vector<_Json_record>&);
+    };
+
+    constexpr _Workload _Workloads[] = {{"empty_throughput", &_Empty_throughput},
+        {"submit_latency", &_Submit_latency}, {"fan_out_fan_in", &_Fan_out_fan_in}, {"fork_join", &_Fork_join},
+        {"mixed_priorities", &_Mixed_priorities}, {"producer_scaling", &_Producer_scaling},
+        {"queue_depth_latency", &_Queue_depth_latency}};
+    ::std::vector<_Json_record> _Results;
+    for (const _Workload& _Item : _Workloads) {
+        if (_Opts._Selected(_Item._Name)) {
+            ::fprintf(stderr, "running %s\n", _Item._Name);
+            _Item._Run(_Opts, _Results);
+        }
+    }
+
+    _Json_record _Header;
+    _Header._Set("benchmark", "mjsync_bench")._Set("hardware_threads", _Hardware_threads())
+        ._Set("threads", _Opts._Threads)._Set("tasks", _Opts._Tasks)._Set("repetitions", _Opts._Repetitions);
+    return _Write_report(_Opts, _Header, _Results) ? 0 : 1;
+}
\ No newline at end of file
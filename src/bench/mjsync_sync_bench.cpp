@@ -0,0 +1,360 @@
+// mjsync_sync_bench.cpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <atomic>
+#include <bench/bench_utils.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mjsync/shared_resource.hpp>
+#include <mjsync/srwlock.hpp>
+#include <mjsync/sync_flag.hpp>
+#include <mjsync/waitable_event.hpp>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+// Note: The operations are spread evenly over 1 to N threads, so every point of a scalability curve performs
+//       the same total amount of work. The wall time per operation falls as the primitive scales, the thread
+//       time per operation (the wall time multiplied by the number of threads) stays flat only if it scales
+//       perfectly. Each result is the median of the repetitions, after one untimed warm-up run.
+
+namespace mjx {
+    namespace bench {
+        class _Xorshift { // cheap per-thread generator, decides between reads and writes
+        public:
+            explicit _Xorshift(const uint64_t _Seed) noexcept : _Mystate(_Seed | 1) {}
+
+            uint32_t _Next_percent() noexcept {
+                _Mystate ^= _Mystate << 13;
+                _Mystate ^= _Mystate >> 7;
+                _Mystate ^= _Mystate << 17;
+                return static_cast<uint32_t>(_Mystate % 100);
+            }
+
+        private:
+            uint64_t _Mystate;
+        };
+
+        struct alignas(64) _Padded_counter { // the data guarded by the lock, alone on its cache line
+            uint64_t _Value = 0;
+        };
+
+        void _Set_scaling_fields(_Json_record& _Record, const size_t _Threads, const uint64_t _Ops,
+            const double _Seconds, const double _Single_seconds) {
+            const double _Wall_ns = _Seconds * 1e9 / static_cast<double>(_Ops);
+            _Record._Set("threads", _Threads)._Set("ops", _Ops)._Set("seconds", _Seconds)
+                ._Set("ns_per_op", _Wall_ns)._Set("thread_ns_per_op", _Wall_ns * static_cast<double>(_Threads))
+                ._Set("ops_per_second", static_cast<double>(_Ops) / _Seconds);
+            if (_Single_seconds > 0.0) { // the throughput relative to a single thread
+                _Record._Set("scaling", _Single_seconds / _Seconds);
+            }
+        }
+
+        template <class _Lock_fn, class _Unlock_fn, class _Lock_shared_fn, class _Unlock_shared_fn>
+        double _Run_lock_mix(const _Options& _Opts, const size_t _Threads, const uint32_t _Write_percent,
+            _Lock_fn&& _Lock, _Unlock_fn&& _Unlock, _Lock_shared_fn&& _Lock_shared, _Unlock_shared_fn&& _Unlock_shared,
+            _Padded_counter& _Counter) {
+            const size_t _Per_thread = _Opts._Tasks / _Threads;
+            return _Measure(_Opts._Repetitions, [&] {
+                _Run_concurrently(_Threads, [&](const size_t _Index) {
+                    _Xorshift _Random(0x9E3779B97F4A7C15ull * (_Index + 1));
+                    uint64_t _Seen = 0;
+                    for (size_t _Idx = 0; _Idx < _Per_thread; ++_Idx) {
+                        if (_Random._Next_percent() < _Write_percent) {
+                            _Lock();
+                            ++_Counter._Value;
+                            _Unlock();
+                        } else {
+                            _Lock_shared();
+                            _Seen += _Counter._Value;
+                            _Unlock_shared();
+                        }
+                    }
+
+                    if (_Seen == UINT64_MAX) { // keeps the reads alive
+                        ::fputc('\0', stderr);
+                    }
+                });
+            });
+        }
+
+        void _Lock_scaling(const _Options& _Opts, ::std::vector<_Json_record>& _Results) {
+            // exclusive and shared acquire/release pairs around a tiny critical section, mjsync's shared_lock
+            // next to std::shared_mutex, for several read/write ratios
+            constexpr uint32_t _Write_percents[] = {0, 10, 50, 100};
+            for (const uint32_t _Write_percent : _Write_percents) {
+                double _Single[2] = {0.0, 0.0};
+                for (const size_t _Threads : _Thread_counts(_Opts._Threads)) {
+                    const uint64_t _Ops = (_Opts._Tasks / _Threads) * _Threads;
+                    shared_lock _Srw;
+                    _Padded_counter _Srw_counter;
+                    const double _Srw_seconds = _Run_lock_mix(_Opts, _Threads, _Write_percent,
+                        [&] { _Srw.lock(); }, [&] { _Srw.unlock(); },
+                        [&] { _Srw.lock_shared(); }, [&] { _Srw.unlock_shared(); }, _Srw_counter);
+                    ::std::shared_mutex _Std;
+                    _Padded_counter _Std_counter;
+                    const double _Std_seconds = _Run_lock_mix(_Opts, _Threads, _Write_percent,
+                        [&] { _Std.lock(); }, [&] { _Std.unlock(); },
+                        [&] { _Std.lock_shared(); }, [&] { _Std.unlock_shared(); }, _Std_counter);
+                    if (_Threads == 1) {
+                        _Single[0] = _Srw_seconds;
+                        _Single[1] = _Std_seconds;
+                    }
+
+                    _Json_record _Srw_record;
+                    _Srw_record._Set("workload", "lock_scaling")._Set("primitive", "shared_lock")
+                        ._Set("write_percent", uint64_t{_Write_percent});
+                    _Set_scaling_fields(_Srw_record, _Threads, _Ops, _Srw_seconds, _Single[0]);
+                    _Srw_record._Set("speedup_vs_std", _Std_seconds / _Srw_seconds);
+                    _Results.push_back(::std::move(_Srw_record));
+
+                    _Json_record _Std_record;
+                    _Std_record._Set("workload", "lock_scaling")._Set("primitive", "std::shared_mutex")
+                        ._Set("write_percent", uint64_t{_Write_percent});
+                    _Set_scaling_fields(_Std_record, _Threads, _Ops, _Std_seconds, _Single[1]);
+                    _Results.push_back(::std::move(_Std_record));
+                }
+            }
+        }
+
+        struct _Visit_payload { // a few fields, so that a visit does more than a single load
+            uint64_t _Count = 0;
+            uint64_t _Sum   = 0;
+        };
+
+        void _Resource_visit(const _Options& _Opts, ::std::vector<_Json_record>& _Results) {
+            // visit() through a mutable reference takes the exclusive lock, through a const one the shared lock
+            for (const bool _Exclusive : {true, false}) {
+                double _Single = 0.0;
+                for (const size_t _Threads : _Thread_counts(_Opts._Threads)) {
+                    const size_t _Per_thread = _Opts._Tasks / _Threads;
+                    const uint64_t _Ops      = _Per_thread * _Threads;
+                    shared_resource<_Visit_payload> _Resource;
+                    const double _Seconds = _Measure(_Opts._Repetitions, [&] {
+                        _Run_concurrently(_Threads, [&](const size_t _Index) {
+                            uint64_t _Seen = 0;
+                            for (size_t _Idx = 0; _Idx < _Per_thread; ++_Idx) {
+                                if (_Exclusive) {
+                                    _Resource.visit([_Index](_Visit_payload& _Payload) noexcept {
+                                        ++_Payload._Count;
+                                        _Payload._Sum += _Index;
+                                    });
+                                } else {
+                                    const shared_resource<_Visit_payload>& _View = _Resource;
+                                    _Seen += _View.visit([](const _Visit_payload& _Payload) noexcept {
+                                        return _Payload._Count + _Payload._Sum;
+                                    });
+                                }
+                            }
+
+                            if (_Seen == UINT64_MAX) { // keeps the reads alive
+                                ::fputc('\0', stderr);
+                            }
+                        });
+                    });
+
+                    if (_Threads == 1) {
+                        _Single = _Seconds;
+                    }
+
+                    _Json_record _Record;
+                    _Record._Set("workload", "resource_visit")._Set("primitive", "shared_resource")
+                        ._Set("mode", _Exclusive ? "exclusive" : "shared");
+                    _Set_scaling_fields(_Record, _Threads, _Ops, _Seconds, _Single);
+                    _Results.push_back(::std::move(_Record));
+                }
+            }
+        }
+
+        double _Event_ping_pong(const size_t _Rounds) {
+            // returns the one-way latency in nanoseconds, half of a median round trip
+            waitable_event _Ping;
+            waitable_event _Pong;
+            ::std::thread _Peer([&] {
+                for (size_t _Idx = 0; _Idx < _Rounds; ++_Idx) {
+                    _Ping.wait_and_reset();
+                    _Pong.notify();
+                }
+            });
+
+            ::std::vector<double> _Trips;
+            _Trips.reserve(_Rounds);
+            for (size_t _Idx = 0; _Idx < _Rounds; ++_Idx) {
+                const _Clock::time_point _Start = _Clock::now();
+                _Ping.notify();
+                _Pong.wait_and_reset();
+                _Trips.push_back(static_cast<double>(_Elapsed_ns(_Start, _Clock::now())));
+            }
+
+            _Peer.join();
+            return _Median(::std::move(_Trips)) / 2.0;
+        }
+
+        class _Std_event { // the std::condition_variable counterpart of notify() and wait_and_reset()
+        public:
+            void _Notify() {
+                {
+                    ::std::lock_guard _Guard(_Mylock);
+                    _Myset = true;
+                }
+
+                _Mycv.notify_one();
+            }
+
+            void _Wait_and_reset() {
+                ::std::unique_lock _Guard(_Mylock);
+                _Mycv.wait(_Guard, [this] { return _Myset; });
+                _Myset = false;
+            }
+
+        private:
+            ::std::mutex _Mylock;
+            ::std::condition_variable _Mycv;
+            bool _Myset = false;
+        };
+
+        double _Std_ping_pong(const size_t _Rounds) {
+            _Std_event _Ping;
+            _Std_event _Pong;
+            ::std::thread _Peer([&] {
+                for (size_t _Idx = 0; _Idx < _Rounds; ++_Idx) {
+                    _Ping._Wait_and_reset();
+                    _Pong._Notify();
+                }
+            });
+
+            ::std::vector<double> _Trips;
+            _Trips.reserve(_Rounds);
+            for (size_t _Idx = 0; _Idx < _Rounds; ++_Idx) {
+                const _Clock::time_point _Start = _Clock::now();
+                _Ping._Notify();
+                _Pong._Wait_and_reset();
+                _Trips.push_back(static_cast<double>(_Elapsed_ns(_Start, _Clock::now())));
+            }
+
+            _Peer.join();
+            return _Median(::std::move(_Trips)) / 2.0;
+        }
+
+        void _Event_latency(const _Options& _Opts, ::std::vector<_Json_record>& _Results) {
+            // two threads wake each other in turn, every wake-up goes through the kernel
+            const size_t _Rounds = _Opts._Tasks / 20 > 0 ? _Opts._Tasks / 20 : 1;
+            ::std::vector<double> _Event_samples;
+            ::std::vector<double> _Std_samples;
+            (void) _Event_ping_pong(_Rounds / 10 + 1); // warm-up
+            for (size_t _Idx = 0; _Idx < _Opts._Repetitions; ++_Idx) {
+                _Event_samples.push_back(_Event_ping_pong(_Rounds));
+                _Std_samples.push_back(_Std_ping_pong(_Rounds));
+            }
+
+            const double _Event_ns = _Median(::std::move(_Event_samples));
+            const double _Std_ns   = _Median(::std::move(_Std_samples));
+            _Json_record _Event_record;
+            _Event_record._Set("workload", "event_ping_pong")._Set("primitive", "waitable_event")
+                ._Set("rounds", _Rounds)._Set("notify_to_wake_ns", _Event_ns)
+                ._Set("speedup_vs_std", _Std_ns / _Event_ns);
+            _Results.push_back(::std::move(_Event_record));
+
+            _Json_record _Std_record;
+            _Std_record._Set("workload", "event_ping_pong")._Set("primitive", "std::condition_variable")
+                ._Set("rounds", _Rounds)._Set("notify_to_wake_ns", _Std_ns);
+            _Results.push_back(::std::move(_Std_record));
+        }
+
+        void _Flag_polling(const _Options& _Opts, ::std::vector<_Json_record>& _Results) {
+            // the cost of is_set() while one more thread keeps toggling the flag, and without it
+            struct _Order_info {
+                const char* _Name;
+                ::std::memory_order _Order;
+            };
+
+            constexpr _Order_info _Orders[] = {{"seq_cst", ::std::memory_order_seq_cst},
+                {"acquire", ::std::memory_order_acquire}, {"relaxed", ::std::memory_order_relaxed}};
+            for (const bool _Contended : {false, true}) {
+                for (const _Order_info& _Info : _Orders) {
+                    double _Single = 0.0;
+                    for (const size_t _Threads : _Thread_counts(_Opts._Threads)) {
+                        const size_t _Per_thread = _Opts._Tasks / _Threads;
+                        const uint64_t _Ops      = _Per_thread * _Threads;
+                        sync_flag _Flag;
+                        ::std::atomic<bool> _Stop{false};
+                        ::std::thread _Writer;
+                        if (_Contended) {
+                            _Writer = ::std::thread([&] {
+                                while (!_Stop.load(::std::memory_order_relaxed)) {
+                                    _Flag.set();
+                                    _Flag.clear();
+                                }
+                            });
+                        }
+
+                        const double _Seconds = _Measure(_Opts._Repetitions, [&] {
+                            _Run_concurrently(_Threads, [&](size_t) {
+                                uint64_t _Seen = 0;
+                                for (size_t _Idx = 0; _Idx < _Per_thread; ++_Idx) {
+                                    _Seen += _Flag.is_set(_Info._Order) ? 1 : 0;
+                                }
+
+                                if (_Seen == UINT64_MAX) { // keeps the polls alive
+                                    ::fputc('\0', stderr);
+                                }
+                            });
+                        });
+
+                        if (_Contended) {
+                            _Stop.store(true, ::std::memory_order_relaxed);
+                            _Writer.join();
+                        }
+
+                        if (_Threads == 1) {
+                            _Single = _Seconds;
+                        }
+
+                        _Json_record _Record;
+                        _Record._Set("workload", "flag_polling")._Set("primitive", "sync_flag")
+                            ._Set("order", _Info._Name)._Set("writer", _Contended ? "toggling" : "none");
+                        _Set_scaling_fields(_Record, _Threads, _Ops, _Seconds, _Single);
+                        _Results.push_back(::std::move(_Record));
+                    }
+                }
+            }
+        }
+    } // namespace bench
+} // namespace mjx
+
+int main(int _Argc, char** _Argv) {
+    using namespace ::mjx::bench;
+    _Options _Opts = _Parse_options(_Argc, _Argv);
+    if (!_Opts._Valid) {
+        _Print_usage(_Argv[0]);
+        return 2;
+    }
+
+    if (_Opts._Tasks == 0) { // operations per scalability point
+        _Opts._Tasks = 1000000;
+    }
+
+    struct _Workload {
+        const char* _Name;
+        void (*_Run)(const _Options&, ::std::vector<_Json_record>&);
+    };
+
+    constexpr _Workload _Workloads[] = {{"lock_scaling", &_Lock_scaling}, {"resource_visit", &_Resource_visit},
+        {"event_ping_pong", &_Event_latency}, {"flag_polling", &_Flag_polling}};
+    ::std::vector<_Json_record> _Results;
+    for (const _Workload& _Item : _Workloads) {
+        if (_Opts._Selected(_Item._Name)) {
+            ::fprintf(stderr, "running %s\n", _Item._Name);
+            _Item._Run(_Opts, _Results);
+        }
+    }
+
+    _Json_record _Header;
+    _Header._Set("benchmark", "mjsync_sync_bench")._Set("hardware_threads", _Hardware_threads())
+        ._Set("threads", _Opts._Threads)._Set("ops", _Opts._Tasks)._Set("repetitions", _Opts._Repetitions);
+    return _Write_report(_Opts, _Header, _Results) ? 0 : 1;
+}
\ No newline at end of file
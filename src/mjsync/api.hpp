@@ -7,9 +7,13 @@
 #ifndef _MJSYNC_API_HPP_
 #define _MJSYNC_API_HPP_
 
+#ifdef _WIN32
 #ifdef MJSYNC_EXPORTS
 #define _MJSYNC_API __declspec(dllexport)
 #else // ^^^ MJSYNC_EXPORTS ^^^ / vvv !MJSYNC_EXPORTS vvv
 #define _MJSYNC_API __declspec(dllimport)
 #endif // MJSYNC_EXPORTS
+#else // ^^^ _WIN32 ^^^ / vvv !_WIN32 vvv
+#define _MJSYNC_API __attribute__((visibility("default")))
+#endif // _WIN32
 #endif // _MJSYNC_API_HPP_
\ No newline at end of file
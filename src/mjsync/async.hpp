@@ -7,57 +7,181 @@
 #ifndef _MJSYNC_ASYNC_HPP_
 #define _MJSYNC_ASYNC_HPP_
 #include <concepts>
-#include <mjmem/smart_pointer.hpp>
+#include <functional>
+#include <memory>
+#include <mjmem/object_allocator.hpp>
+#include <mjsync/future.hpp>
+#include <mjsync/stop_token.hpp>
 #include <mjsync/task.hpp>
 #include <mjsync/thread.hpp>
+#include <mjsync/trace.hpp>
 #include <tuple>
 #include <type_traits>
+#include <utility>
 
 namespace mjx {
     template <class _Sched>
-    concept task_scheduler = requires(_Sched& _Scheduler) {
-        { _Scheduler.schedule_task(thread::callable{}, static_cast<void*>(nullptr), task_priority{}) }
-            -> ::std::same_as<task>;
+    concept task_scheduler = requires(_Sched& _Scheduler, const task_descriptor& _Desc) {
+        { _Scheduler.schedule_task(_Desc) } -> ::std::same_as<task>;
     };
 
     template <class _Fn, class... _Types>
-    class _Task_invoker { // invokes any callable as a thread task
+    using _Async_result_t =
+        ::std::remove_cvref_t<::std::invoke_result_t<::std::decay_t<_Fn>, ::std::decay_t<_Types>...>>;
+
+    template <bool _Inline, class _Ty, class _Fn, class... _Types>
+    class _Async_state : public _Future_state<_Ty> { // keeps the callable and its result in one block
     public:
-        template <class _Tuple, size_t... _Indices>
-        static constexpr void _Invoker(void* _Arg) {
-            // obtain _Fn and _Types... from _Arg, then invoke it
-            const unique_smart_ptr<_Tuple> _Unique(static_cast<_Tuple*>(_Arg));
-            _Tuple& _Vals = *_Unique;
-            ::std::invoke(::std::move(::std::get<_Indices>(_Vals))...);
+        template <class _Fx, class... _Args>
+        _Async_state(void* const _Scheduler, const _Future_state_base::_Schedule_fn _Schedule,
+            const task_priority _Priority, _Fx&& _Func, _Args&&... _Vals)
+            : _Future_state<_Ty>(_Scheduler, _Schedule, _Priority),
+            _Myvals(::std::forward<_Fx>(_Func), ::std::forward<_Args>(_Vals)...) {}
+
+        _Async_state(const _Async_state&)            = delete;
+        _Async_state& operator=(const _Async_state&) = delete;
+
+    private:
+        void _Run() override {
+            try {
+                if constexpr (::std::is_void_v<_Ty>) {
+                    ::std::apply(_Invoke_fn, ::std::move(_Myvals));
+                    this->_Set_value();
+                } else {
+                    this->_Set_value(::std::apply(_Invoke_fn, ::std::move(_Myvals)));
+                }
+            } catch (...) {
+                this->_Set_exception(::std::current_exception());
+            }
+        }
+
+        void _Destroy() noexcept override {
+            if constexpr (_Inline) { // lives in the inline storage of its task, which is being recycled
+                ::std::destroy_at(this);
+            } else {
+                ::mjx::delete_object(this);
+            }
         }
 
-        template <class _Tuple, size_t... _Indices>
-        static constexpr auto _Get_invoker(::std::index_sequence<_Indices...>) noexcept {
-            return &_Invoker<_Tuple, _Indices...>;
+        static constexpr auto _Invoke_fn = []<class... _Vals>(_Vals&&... _Args) -> decltype(auto) {
+            return ::std::invoke(::std::forward<_Vals>(_Args)...);
+        };
+
+        ::std::tuple<_Fn, _Types...> _Myvals;
+    };
+
+    template <class _State_t, class... _Types>
+    struct _Async_emplacer { // constructs the state in the inline storage of the task
+        void* _Scheduler;
+        _Future_state_base::_Schedule_fn _Schedule;
+        task_priority _Priority;
+        ::std::tuple<_Types&&...> _Args;
+        _State_t* _State;
+
+        static void* _Emplace(void* const _Storage, void* const _Self) {
+            _Async_emplacer& _Emplacer = *static_cast<_Async_emplacer*>(_Self);
+            _Emplacer._State           = ::std::apply([&](_Types&&... _Vals) {
+                return ::std::construct_at(static_cast<_State_t*>(_Storage), _Emplacer._Scheduler,
+                    _Emplacer._Schedule, _Emplacer._Priority, ::std::forward<_Types>(_Vals)...);
+            }, ::std::move(_Emplacer._Args));
+            return _Emplacer._State;
         }
     };
 
+    template <task_scheduler _Sched>
+    task _Schedule_on(void* const _Scheduler, const task_descriptor& _Desc) {
+        return static_cast<_Sched*>(_Scheduler)->schedule_task(_Desc);
+    }
+
+    template <task_scheduler _Sched, class _Fn, class... _Types>
+    future<_Async_result_t<_Fn, _Types...>> _Async_on_heap(_Sched& _Scheduler, const trace_label _Label,
+        const task_priority _Priority, _Fn&& _Func, _Types&&... _Args) {
+        using _Result_t = _Async_result_t<_Fn, _Types...>;
+        using _State_t  = _Async_state<false, _Result_t, ::std::decay_t<_Fn>, ::std::decay_t<_Types>...>;
+        _State_t* const _State = ::mjx::create_object<_State_t>(::std::addressof(_Scheduler),
+            &_Schedule_on<_Sched>, _Priority, ::std::forward<_Fn>(_Func), ::std::forward<_Types>(_Args)...);
+        future<_Result_t> _Future = _Future_factory::_Make<_Result_t>(_State); // takes the consumer's reference
+        try {
+            // Note: Once scheduled, the task slot owns the producer's reference and drops it through
+            //       _Abandon() when recycled. If the scheduler is inactive, drop it here instead.
+            task_descriptor _Desc{&_Future_state_base::_Invoke, _State, _Priority, &_Future_state_base::_Abandon};
+            _Desc.label = _Label.name;
+            task _Task  = _Scheduler.schedule_task(_Desc);
+            if (_Task.is_registered()) {
+                _Future_factory::_Pin(_Future, ::std::move(_Task)); // the future waits for the task
+            } else {
+                _Future_state_base::_Abandon(_State);
+            }
+        } catch (...) {
+            _Future_state_base::_Abandon(_State);
+            throw;
+        }
+
+        return _Future;
+    }
+
     template <task_scheduler _Sched, class _Fn, class... _Types>
-    constexpr task async(_Sched& _Scheduler, const task_priority _Priority, _Fn&& _Func, _Types&&... _Args) {
-        using _Invoker_t        = _Task_invoker<_Fn, _Types...>;
-        using _Tuple_t          = ::std::tuple<::std::decay_t<_Fn>, ::std::decay_t<_Types>...>;
-        auto _Vals              = ::mjx::make_unique_smart_ptr<_Tuple_t>(
-            ::std::forward<_Fn>(_Func), ::std::forward<_Types>(_Args)...);
-        constexpr auto _Invoker = _Invoker_t::_Get_invoker<_Tuple_t>(
-            ::std::make_index_sequence<1 + sizeof...(_Types)>{});
-        task _Task              = _Scheduler.schedule_task(_Invoker, _Vals.get(), _Priority);
-        if (_Task.is_registered()) {
-            _Vals.release(); // release ownership of _Vals, _Invoker() will destroy it
+    future<_Async_result_t<_Fn, _Types...>> async(_Sched& _Scheduler, const trace_label _Label,
+        const task_priority _Priority, _Fn&& _Func, _Types&&... _Args) {
+        // the label names the task in traces, see trace.hpp
+        using _Result_t = _Async_result_t<_Fn, _Types...>;
+        using _State_t  = _Async_state<true, _Result_t, ::std::decay_t<_Fn>, ::std::decay_t<_Types>...>;
+        if constexpr (sizeof(_State_t) <= task::inline_storage_size
+            && alignof(_State_t) <= task::inline_storage_alignment) {
+            // Note: The state is constructed directly in the task's inline storage, so no allocation takes place.
+            //       The future pins the task, so the storage outlives both the future and the producer.
+            _Async_emplacer<_State_t, _Fn, _Types...> _Emplacer{::std::addressof(_Scheduler), &_Schedule_on<_Sched>,
+                _Priority, ::std::forward_as_tuple(::std::forward<_Fn>(_Func), ::std::forward<_Types>(_Args)...),
+                nullptr};
+            task_descriptor _Desc{&_Future_state_base::_Invoke, &_Emplacer, _Priority,
+                &_Future_state_base::_Abandon, &_Async_emplacer<_State_t, _Fn, _Types...>::_Emplace};
+            _Desc.label = _Label.name;
+            task _Task = _Scheduler.schedule_task(_Desc);
+            if (_Emplacer._State) {
+                return _Future_factory::_Make<_Result_t>(_Emplacer._State, ::std::move(_Task));
+            }
+
+            // the scheduler is inactive and the arguments are untouched, the heap path reports the failure
         }
 
-        return _Task;
+        return ::mjx::_Async_on_heap(
+            _Scheduler, _Label, _Priority, ::std::forward<_Fn>(_Func), ::std::forward<_Types>(_Args)...);
+    }
+
+    template <task_scheduler _Sched, class _Fn, class... _Types>
+    future<_Async_result_t<_Fn, _Types...>> async(
+        _Sched& _Scheduler, const trace_label _Label, _Fn&& _Func, _Types&&... _Args) {
+        return ::mjx::async(
+            _Scheduler, _Label, task_priority::normal, ::std::forward<_Fn>(_Func), ::std::forward<_Types>(_Args)...);
+    }
+
+    template <task_scheduler _Sched, class _Fn, class... _Types>
+    future<_Async_result_t<_Fn, _Types...>> async(
+        _Sched& _Scheduler, const task_priority _Priority, _Fn&& _Func, _Types&&... _Args) {
+        return ::mjx::async(
+            _Scheduler, trace_label{}, _Priority, ::std::forward<_Fn>(_Func), ::std::forward<_Types>(_Args)...);
     }
 
     template <task_scheduler _Sched, class _Fn, class... _Types>
-    constexpr task async(_Sched& _Scheduler, _Fn&& _Func, _Types&&... _Args) {
+    future<_Async_result_t<_Fn, _Types...>> async(_Sched& _Scheduler, _Fn&& _Func, _Types&&... _Args) {
         return ::mjx::async(
             _Scheduler, task_priority::normal, ::std::forward<_Fn>(_Func), ::std::forward<_Types>(_Args)...);
     }
+
+    template <task_scheduler _Sched, class _Fn, class... _Types>
+    future<_Async_result_t<_Fn, stop_token, _Types...>> async(_Sched& _Scheduler, const stop_token _Token,
+        const task_priority _Priority, _Fn&& _Func, _Types&&... _Args) {
+        // the callable receives the token as its first argument, polling it lets a running task stop early
+        return ::mjx::async(
+            _Scheduler, _Priority, ::std::forward<_Fn>(_Func), _Token, ::std::forward<_Types>(_Args)...);
+    }
+
+    template <task_scheduler _Sched, class _Fn, class... _Types>
+    future<_Async_result_t<_Fn, stop_token, _Types...>> async(
+        _Sched& _Scheduler, const stop_token _Token, _Fn&& _Func, _Types&&... _Args) {
+        return ::mjx::async(_Scheduler, _Token, task_priority::normal, ::std::forward<_Fn>(_Func),
+            ::std::forward<_Types>(_Args)...);
+    }
 } // namespace mjx
 
 #endif // _MJSYNC_ASYNC_HPP_
\ No newline at end of file
@@ -0,0 +1,357 @@
+// coroutine.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _MJSYNC_COROUTINE_HPP_
+#define _MJSYNC_COROUTINE_HPP_
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mjsync/async.hpp>
+#include <mjsync/task.hpp>
+#include <mjsync/thread.hpp>
+#include <type_traits>
+#include <utility>
+
+namespace mjx {
+    class schedule_awaitable { // resumes the awaiting coroutine on a thread of the scheduler
+    public:
+        using _Schedule_fn = task(*)(void*, const task_descriptor&);
+
+        schedule_awaitable(
+            void* const _Scheduler, const _Schedule_fn _Schedule, const task_priority _Priority) noexcept
+            : _Myscheduler(_Scheduler), _Myschedule(_Schedule), _Mypriority(_Priority), _Mycanceled(false) {}
+
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        bool await_suspend(const ::std::coroutine_handle<> _Handle) {
+            // Note: Once the task is registered, the coroutine may already run on another thread,
+            //       so this awaitable must not be touched anymore.
+            _Resumer _Record{_Handle, this, false};
+            const task_descriptor _Desc{&_Resume, &_Record, _Mypriority, &_Finish, &_Emplace};
+            if (_Myschedule(_Myscheduler, _Desc).is_registered()) {
+                return true;
+            }
+
+            _Mycanceled = true; // the scheduler is inactive, continue at once and report the failure
+            return false;
+        }
+
+        void await_resume() const {
+            if (_Mycanceled) {
+                throw ::std::future_error(::std::future_errc::broken_promise);
+            }
+        }
+
+    private:
+        struct _Resumer { // lives in the task's inline storage, which outlives the coroutine's frame
+            ::std::coroutine_handle<> _Handle;
+            schedule_awaitable* _Awaitable;
+            bool _Started;
+        };
+
+        static void* _Emplace(void* const _Storage, void* const _Arg) noexcept {
+            return ::std::construct_at(static_cast<_Resumer*>(_Storage), *static_cast<_Resumer*>(_Arg));
+        }
+
+        static void _Resume(void* const _Arg) {
+            _Resumer* const _Record = static_cast<_Resumer*>(_Arg);
+            _Record->_Started       = true;
+            _Record->_Handle.resume();
+        }
+
+        static void _Finish(void* const _Arg) noexcept {
+            // a canceled task must still resume the coroutine, otherwise its awaiters would never finish
+            _Resumer* const _Record = static_cast<_Resumer*>(_Arg);
+            if (!_Record->_Started) {
+                _Record->_Awaitable->_Mycanceled = true;
+                _Record->_Handle.resume();
+            }
+        }
+
+        void* _Myscheduler;
+        _Schedule_fn _Myschedule;
+        task_priority _Mypriority;
+        bool _Mycanceled;
+    };
+
+    // returns an awaitable that resumes the awaiting coroutine on a thread of the scheduler
+    template <task_scheduler _Sched>
+    inline schedule_awaitable schedule(
+        _Sched& _Scheduler, const task_priority _Priority = task_priority::normal) noexcept {
+        return schedule_awaitable(::std::addressof(_Scheduler), &_Schedule_on<_Sched>, _Priority);
+    }
+
+    template <class _Ty>
+    class co_task;
+
+    class _Co_promise_base {
+    public:
+        _Co_promise_base() noexcept : _Mycontinuation(), _Myexception() {}
+
+        _Co_promise_base(const _Co_promise_base&)            = delete;
+        _Co_promise_base& operator=(const _Co_promise_base&) = delete;
+
+        struct _Final_awaiter { // transfers control to the awaiter, without growing the stack
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            template <class _Promise>
+            ::std::coroutine_handle<> await_suspend(const ::std::coroutine_handle<_Promise> _Handle) noexcept {
+                const ::std::coroutine_handle<> _Next = _Handle.promise()._Mycontinuation;
+                return _Next ? _Next : ::std::noop_coroutine();
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        ::std::suspend_always initial_suspend() const noexcept {
+            return {};
+        }
+
+        _Final_awaiter final_suspend() const noexcept {
+            return {};
+        }
+
+        void unhandled_exception() noexcept {
+            _Myexception = ::std::current_exception();
+        }
+
+        void _Set_continuation(const ::std::coroutine_handle<> _Handle) noexcept {
+            _Mycontinuation = _Handle;
+        }
+
+    protected:
+        ::std::coroutine_handle<> _Mycontinuation; // the coroutine that awaits this one
+        ::std::exception_ptr _Myexception;
+    };
+
+    template <class _Ty>
+    class _Co_promise : public _Co_promise_base { // stores the result inline
+    public:
+        _Co_promise() noexcept : _Co_promise_base(), _Myhas_value(false) {}
+
+        ~_Co_promise() noexcept {
+            if (_Myhas_value) {
+                ::std::destroy_at(::std::addressof(_Myvalue));
+            }
+        }
+
+        co_task<_Ty> get_return_object() noexcept;
+
+        template <class _Other = _Ty>
+            requires ::std::is_constructible_v<_Ty, _Other&&>
+        void return_value(_Other&& _Val) {
+            ::std::construct_at(::std::addressof(_Myvalue), ::std::forward<_Other>(_Val));
+            _Myhas_value = true;
+        }
+
+        _Ty _Get_result() {
+            if (this->_Myexception) {
+                ::std::rethrow_exception(this->_Myexception);
+            }
+
+            return ::std::move(_Myvalue);
+        }
+
+    private:
+        union {
+            _Ty _Myvalue; // constructed once the coroutine has returned
+        };
+
+        bool _Myhas_value;
+    };
+
+    template <>
+    class _Co_promise<void> : public _Co_promise_base {
+    public:
+        co_task<void> get_return_object() noexcept;
+
+        void return_void() const noexcept {}
+
+        void _Get_result() const {
+            if (this->_Myexception) {
+                ::std::rethrow_exception(this->_Myexception);
+            }
+        }
+    };
+
+    template <class _Ty = void>
+    class co_task { // lazily started coroutine, runs once awaited and resumes its awaiter when done
+    public:
+        using promise_type = _Co_promise<_Ty>;
+        using value_type   = _Ty;
+
+        co_task() noexcept : _Myhandle() {}
+
+        co_task(co_task&& _Other) noexcept : _Myhandle(::std::exchange(_Other._Myhandle, nullptr)) {}
+
+        ~co_task() noexcept {
+            if (_Myhandle) {
+                _Myhandle.destroy();
+            }
+        }
+
+        co_task& operator=(co_task&& _Other) noexcept {
+            if (this != ::std::addressof(_Other)) {
+                if (_Myhandle) {
+                    _Myhandle.destroy();
+                }
+
+                _Myhandle = ::std::exchange(_Other._Myhandle, nullptr);
+            }
+
+            return *this;
+        }
+
+        co_task(const co_task&)            = delete;
+        co_task& operator=(const co_task&) = delete;
+
+        // checks if the task refers to a coroutine
+        bool valid() const noexcept {
+            return static_cast<bool>(_Myhandle);
+        }
+
+        // checks if the coroutine has finished
+        bool is_ready() const noexcept {
+            return _Myhandle && _Myhandle.done();
+        }
+
+        template <bool _Returns_result>
+        struct _Awaiter { // starts the coroutine and suspends the awaiter until the coroutine finishes
+            ::std::coroutine_handle<promise_type> _Handle;
+
+            bool await_ready() const noexcept {
+                return !_Handle || _Handle.done();
+            }
+
+            ::std::coroutine_handle<> await_suspend(const ::std::coroutine_handle<> _Awaiting) noexcept {
+                _Handle.promise()._Set_continuation(_Awaiting);
+                return _Handle; // symmetric transfer, starts the coroutine
+            }
+
+            decltype(auto) await_resume() const {
+                if constexpr (_Returns_result) {
+                    if (!_Handle) {
+                        throw ::std::future_error(::std::future_errc::no_state);
+                    }
+
+                    return _Handle.promise()._Get_result();
+                }
+            }
+        };
+
+        _Awaiter<true> operator co_await() const noexcept {
+            return _Awaiter<true>{_Myhandle};
+        }
+
+        // returns an awaiter that waits for the coroutine without retrieving its result
+        _Awaiter<false> _When_ready() const noexcept {
+            return _Awaiter<false>{_Myhandle};
+        }
+
+        // returns the result of the finished coroutine, rethrows its exception
+        _Ty _Get_result() const {
+            return _Myhandle.promise()._Get_result();
+        }
+
+    private:
+        friend promise_type;
+
+        explicit co_task(const ::std::coroutine_handle<promise_type> _Handle) noexcept : _Myhandle(_Handle) {}
+
+        ::std::coroutine_handle<promise_type> _Myhandle;
+    };
+
+    template <class _Ty>
+    inline co_task<_Ty> _Co_promise<_Ty>::get_return_object() noexcept {
+        return co_task<_Ty>(::std::coroutine_handle<_Co_promise>::from_promise(*this));
+    }
+
+    inline co_task<void> _Co_promise<void>::get_return_object() noexcept {
+        return co_task<void>(::std::coroutine_handle<_Co_promise>::from_promise(*this));
+    }
+
+    class _Sync_wait_driver { // awaits a task on behalf of a thread that is not a coroutine
+    public:
+        struct promise_type {
+            ::std::atomic<bool> _Done{false};
+
+            _Sync_wait_driver get_return_object() noexcept {
+                return _Sync_wait_driver(::std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+
+            ::std::suspend_always initial_suspend() const noexcept {
+                return {};
+            }
+
+            auto final_suspend() const noexcept {
+                struct _Final_awaiter {
+                    bool await_ready() const noexcept {
+                        return false;
+                    }
+
+                    void await_suspend(const ::std::coroutine_handle<promise_type> _Handle) const noexcept {
+                        _Handle.promise()._Done.store(true, ::std::memory_order_release);
+                        _Handle.promise()._Done.notify_all();
+                    }
+
+                    void await_resume() const noexcept {}
+                };
+
+                return _Final_awaiter{};
+            }
+
+            void return_void() const noexcept {}
+
+            void unhandled_exception() const noexcept {
+                ::std::terminate(); // unreachable, the awaited task stores its own exception
+            }
+        };
+
+        explicit _Sync_wait_driver(const ::std::coroutine_handle<promise_type> _Handle) noexcept : _Myhandle(_Handle) {}
+
+        ~_Sync_wait_driver() noexcept {
+            _Myhandle.destroy();
+        }
+
+        _Sync_wait_driver(const _Sync_wait_driver&)            = delete;
+        _Sync_wait_driver& operator=(const _Sync_wait_driver&) = delete;
+
+        void _Run_and_wait() noexcept {
+            _Myhandle.resume();
+            ::std::atomic<bool>& _Done = _Myhandle.promise()._Done;
+            while (!_Done.load(::std::memory_order_acquire)) {
+                _Done.wait(false, ::std::memory_order_acquire);
+            }
+        }
+
+    private:
+        ::std::coroutine_handle<promise_type> _Myhandle;
+    };
+
+    template <class _Ty>
+    inline _Sync_wait_driver _Make_sync_wait_driver(const co_task<_Ty>& _Task) {
+        co_await _Task._When_ready();
+    }
+
+    // starts the task, blocks the calling thread until it finishes and returns its result
+    template <class _Ty>
+    inline _Ty sync_wait(co_task<_Ty> _Task) {
+        if (!_Task.valid()) {
+            throw ::std::future_error(::std::future_errc::no_state);
+        }
+
+        ::mjx::_Make_sync_wait_driver(_Task)._Run_and_wait();
+        return _Task._Get_result();
+    }
+} // namespace mjx
+
+#endif // _MJSYNC_COROUTINE_HPP_
\ No newline at end of file
@@ -0,0 +1,388 @@
+// future.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _MJSYNC_FUTURE_HPP_
+#define _MJSYNC_FUTURE_HPP_
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mjmem/object_allocator.hpp>
+#include <mjsync/task.hpp>
+#include <mjsync/thread.hpp>
+#include <type_traits>
+#include <utility>
+
+namespace mjx {
+    template <class _Ty>
+    class future;
+
+    class _Future_state_base { // shared state of a future, owned by the future and by the producing task
+    public:
+        using _Schedule_fn = task(*)(void*, const task_descriptor&);
+
+        _Future_state_base(
+            void* const _Scheduler, const _Schedule_fn _Schedule, const task_priority _Priority) noexcept
+            : _Myrefs(2), _Mywaiters(0), _Mynext(nullptr), _Myexception(), _Myscheduler(_Scheduler),
+            _Myschedule(_Schedule), _Mystatus(_Pending), _Mypriority(_Priority) {}
+
+        virtual ~_Future_state_base() noexcept {}
+
+        _Future_state_base(const _Future_state_base&)            = delete;
+        _Future_state_base& operator=(const _Future_state_base&) = delete;
+
+        static void _Invoke(void* const _Arg) {
+            static_cast<_Future_state_base*>(_Arg)->_Run();
+        }
+
+        static void _Abandon(void* const _Arg) noexcept {
+            // drops the producer's reference, a state that has never been satisfied is marked as broken
+            _Future_state_base* const _State = static_cast<_Future_state_base*>(_Arg);
+            if (!_State->_Is_ready()) {
+                _State->_Set_exception(
+                    ::std::make_exception_ptr(::std::future_error(::std::future_errc::broken_promise)));
+            }
+
+            _State->_Release();
+        }
+
+        void _Release() noexcept {
+            if (_Myrefs.fetch_sub(1, ::std::memory_order_acq_rel) == 1) {
+                _Destroy();
+            }
+        }
+
+        bool _Is_ready() const noexcept {
+            return _Mystatus.load(::std::memory_order_acquire) != _Pending;
+        }
+
+        bool _Has_value() const noexcept {
+            return _Mystatus.load(::std::memory_order_acquire) == _Succeeded;
+        }
+
+        bool _Has_failed() const noexcept {
+            return _Mystatus.load(::std::memory_order_acquire) == _Failed;
+        }
+
+        const ::std::exception_ptr& _Get_exception() const noexcept {
+            return _Myexception;
+        }
+
+        void _Wait() noexcept {
+            // the same waiter protocol as the task control block, completion without waiters costs no wake-up
+            _Mywaiters.fetch_add(1, ::std::memory_order_seq_cst);
+            while (_Mystatus.load(::std::memory_order_seq_cst) == _Pending) {
+                _Mystatus.wait(_Pending, ::std::memory_order_seq_cst);
+            }
+
+            _Mywaiters.fetch_sub(1, ::std::memory_order_release);
+        }
+
+        void _Set_exception(::std::exception_ptr _Exception) noexcept {
+            _Myexception = ::std::move(_Exception);
+            _Finish(_Failed);
+        }
+
+        void _Attach_continuation(_Future_state_base* const _Next) noexcept {
+            // Note: _Mynext points to the state itself once the state is complete. Whoever comes second,
+            //       either the completing producer or the attaching consumer, dispatches the continuation.
+            _Future_state_base* _Expected = nullptr;
+            if (!_Mynext.compare_exchange_strong(_Expected, _Next, ::std::memory_order_acq_rel)) {
+                _Next->_Dispatch();
+            }
+        }
+
+        void _Dispatch() noexcept {
+            // schedule the state's producer on the scheduler that runs its antecedent
+            try {
+                const task_descriptor _Desc{&_Invoke, this, _Mypriority, &_Abandon};
+                if (!_Myschedule(_Myscheduler, _Desc).is_registered()) { // the scheduler is inactive
+                    _Abandon(this);
+                }
+            } catch (...) {
+                _Set_exception(::std::current_exception());
+                _Release();
+            }
+        }
+
+        void* _Get_scheduler() const noexcept {
+            return _Myscheduler;
+        }
+
+        _Schedule_fn _Get_schedule_fn() const noexcept {
+            return _Myschedule;
+        }
+
+        task_priority _Get_priority() const noexcept {
+            return _Mypriority;
+        }
+
+    protected:
+        enum _Status_t : unsigned char {
+            _Pending,
+            _Succeeded,
+            _Failed
+        };
+
+        virtual void _Run()               = 0;
+        virtual void _Destroy() noexcept = 0;
+
+        void _Finish(const _Status_t _Status) noexcept {
+            _Mystatus.store(_Status, ::std::memory_order_seq_cst);
+            if (_Mywaiters.load(::std::memory_order_seq_cst) > 0) { // wake only if someone waits
+                _Mystatus.notify_all();
+            }
+
+            _Future_state_base* const _Next = _Mynext.exchange(this, ::std::memory_order_acq_rel);
+            if (_Next) { // a continuation has been attached, schedule it
+                _Next->_Dispatch();
+            }
+        }
+
+    private:
+        // Note: The members are ordered to keep the state small, so that typical callables still fit
+        //       into the inline storage of a task together with the state.
+        ::std::atomic<uint32_t> _Myrefs; // one reference for the future, one for the producer
+        ::std::atomic<uint32_t> _Mywaiters;
+        ::std::atomic<_Future_state_base*> _Mynext; // attached continuation, points to itself once complete
+        ::std::exception_ptr _Myexception;
+        void* _Myscheduler; // type-erased scheduler, used to schedule continuations
+        _Schedule_fn _Myschedule;
+        ::std::atomic<_Status_t> _Mystatus;
+        task_priority _Mypriority;
+    };
+
+    template <class _Ty>
+    class _Future_state : public _Future_state_base { // stores the result inline
+    public:
+        _Future_state(void* const _Scheduler, const _Schedule_fn _Schedule, const task_priority _Priority) noexcept
+            : _Future_state_base(_Scheduler, _Schedule, _Priority) {}
+
+        ~_Future_state() noexcept override {
+            if (this->_Has_value()) {
+                ::std::destroy_at(::std::addressof(_Myvalue));
+            }
+        }
+
+        template <class... _Types>
+        void _Set_value(_Types&&... _Args) {
+            ::std::construct_at(::std::addressof(_Myvalue), ::std::forward<_Types>(_Args)...);
+            _Finish(_Succeeded);
+        }
+
+        _Ty& _Get_value() noexcept {
+            return _Myvalue;
+        }
+
+    private:
+        union {
+            _Ty _Myvalue; // constructed once the state has succeeded
+        };
+    };
+
+    template <>
+    class _Future_state<void> : public _Future_state_base {
+    public:
+        using _Future_state_base::_Future_state_base;
+
+        void _Set_value() noexcept {
+            _Finish(_Succeeded);
+        }
+    };
+
+    template <class _Fn, class _Ty>
+    struct _Continuation_result {
+        using type = ::std::remove_cvref_t<::std::invoke_result_t<_Fn, _Ty&&>>;
+    };
+
+    template <class _Fn>
+    struct _Continuation_result<_Fn, void> {
+        using type = ::std::remove_cvref_t<::std::invoke_result_t<_Fn>>;
+    };
+
+    template <class _Fn, class _Ty>
+    using _Continuation_result_t = typename _Continuation_result<_Fn, _Ty>::type;
+
+    template <class _Ty, class _Fn>
+    class _Continuation_state : public _Future_state<_Continuation_result_t<_Fn, _Ty>> {
+    public:
+        using _Result_t = _Continuation_result_t<_Fn, _Ty>;
+
+        template <class _Fx>
+        _Continuation_state(_Future_state<_Ty>* const _Antecedent, task&& _Antecedent_task, _Fx&& _Func)
+            : _Future_state<_Result_t>(
+                _Antecedent->_Get_scheduler(), _Antecedent->_Get_schedule_fn(), _Antecedent->_Get_priority()),
+            _Myantecedent(_Antecedent), _Myantecedent_task(::std::move(_Antecedent_task)),
+            _Myfunc(::std::forward<_Fx>(_Func)) {}
+
+        ~_Continuation_state() noexcept override {
+            _Myantecedent->_Release();
+        }
+
+    private:
+        void _Run() override {
+            if (_Myantecedent->_Has_failed()) { // propagate the antecedent's exception
+                this->_Set_exception(_Myantecedent->_Get_exception());
+                return;
+            }
+
+            try {
+                if constexpr (::std::is_void_v<_Ty>) {
+                    _Set_result([this] { return ::std::invoke(::std::move(_Myfunc)); });
+                } else {
+                    _Set_result([this] {
+                        return ::std::invoke(::std::move(_Myfunc), ::std::move(_Myantecedent->_Get_value()));
+                    });
+                }
+            } catch (...) {
+                this->_Set_exception(::std::current_exception());
+            }
+        }
+
+        template <class _Fx>
+        void _Set_result(_Fx&& _Producer) {
+            if constexpr (::std::is_void_v<_Result_t>) {
+                _Producer();
+                this->_Set_value();
+            } else {
+                this->_Set_value(_Producer());
+            }
+        }
+
+        void _Destroy() noexcept override {
+            ::mjx::delete_object(this);
+        }
+
+        _Future_state<_Ty>* _Myantecedent; // holds a reference to the antecedent
+        task _Myantecedent_task; // keeps the antecedent's storage alive, released after the reference
+        _Fn _Myfunc;
+    };
+
+    struct _Future_factory {
+        template <class _Ty>
+        static future<_Ty> _Make(_Future_state<_Ty>* const _State, task&& _Task = task{}) noexcept {
+            return future<_Ty>(_State, ::std::move(_Task));
+        }
+
+        template <class _Ty>
+        static void _Pin(future<_Ty>& _Future, task&& _Task) noexcept {
+            _Future._Mytask = ::std::move(_Task);
+        }
+    };
+
+    template <class _Ty>
+    class future { // receives the result of an asynchronous operation
+    public:
+        using value_type = _Ty;
+
+        future() noexcept : _Mystate(nullptr), _Mytask() {}
+
+        future(future&& _Other) noexcept
+            : _Mystate(::std::exchange(_Other._Mystate, nullptr)), _Mytask(::std::move(_Other._Mytask)) {}
+
+        ~future() noexcept {
+            _Reset();
+        }
+
+        future& operator=(future&& _Other) noexcept {
+            if (this != ::std::addressof(_Other)) {
+                _Reset();
+                _Mystate = ::std::exchange(_Other._Mystate, nullptr);
+                _Mytask  = ::std::move(_Other._Mytask);
+            }
+
+            return *this;
+        }
+
+        future(const future&)            = delete;
+        future& operator=(const future&) = delete;
+
+        // checks if the future refers to a shared state
+        bool valid() const noexcept {
+            return _Mystate != nullptr;
+        }
+
+        // checks if the result is available
+        bool is_ready() const noexcept {
+            return _Mystate ? _Mystate->_Is_ready() : false;
+        }
+
+        // waits until the result is available
+        void wait() const noexcept {
+            if (_Mystate) {
+                _Wait_for_result();
+            }
+        }
+
+        // waits for the result and returns it, rethrows the stored exception, invalidates the future
+        _Ty get() {
+            if (!_Mystate) {
+                throw ::std::future_error(::std::future_errc::no_state);
+            }
+
+            _Wait_for_result();
+            struct _Releaser {
+                future* _Self;
+
+                ~_Releaser() noexcept {
+                    _Self->_Reset();
+                }
+            } _Guard{this};
+            if (_Mystate->_Has_failed()) {
+                ::std::rethrow_exception(_Mystate->_Get_exception());
+            }
+
+            if constexpr (!::std::is_void_v<_Ty>) {
+                return ::std::move(_Mystate->_Get_value());
+            }
+        }
+
+        // schedules _Func to run with the result once it is available, invalidates the future
+        template <class _Fn>
+        future<_Continuation_result_t<::std::decay_t<_Fn>, _Ty>> then(_Fn&& _Func) {
+            using _Continuation_t = _Continuation_state<_Ty, ::std::decay_t<_Fn>>;
+            if (!_Mystate) {
+                throw ::std::future_error(::std::future_errc::no_state);
+            }
+
+            _Continuation_t* const _Next =
+                ::mjx::create_object<_Continuation_t>(_Mystate, ::std::move(_Mytask), ::std::forward<_Fn>(_Func));
+            ::std::exchange(_Mystate, nullptr)->_Attach_continuation(_Next); // the continuation now owns the state
+            return _Future_factory::_Make<typename _Continuation_t::_Result_t>(_Next);
+        }
+
+    private:
+        friend _Future_factory;
+
+        future(_Future_state<_Ty>* const _State, task&& _Task) noexcept
+            : _Mystate(_State), _Mytask(::std::move(_Task)) {}
+
+        void _Wait_for_result() const noexcept {
+            // Note: A pool worker that waits for a producer queued behind it would deadlock if it blocked.
+            //       Waiting for the producing task first lets the worker run it, or other tasks meanwhile.
+            //       A canceled producer satisfies the state once it is abandoned, so the status is awaited too.
+            _Mytask.wait_until_done();
+            _Mystate->_Wait();
+        }
+
+        void _Reset() noexcept {
+            // release the state before the task, the state may live in the task's inline storage
+            if (_Mystate) {
+                _Mystate->_Release();
+                _Mystate = nullptr;
+            }
+
+            _Mytask = task{};
+        }
+
+        _Future_state<_Ty>* _Mystate;
+        mutable task _Mytask; // the producing task, pins its inline storage that may hold the state, if any
+    };
+} // namespace mjx
+
+#endif // _MJSYNC_FUTURE_HPP_
\ No newline at end of file
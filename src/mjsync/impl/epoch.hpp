@@ -0,0 +1,89 @@
+// epoch.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _MJSYNC_IMPL_EPOCH_HPP_
+#define _MJSYNC_IMPL_EPOCH_HPP_
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mjsync/impl/platform.hpp>
+
+namespace mjx {
+    namespace mjsync_impl {
+        class _Epoch_domain { // epoch-based reclamation, readers never block and never wait for writers
+        public:
+            _Epoch_domain() noexcept : _Mystripes(), _Myepoch(0) {}
+
+            ~_Epoch_domain() noexcept {}
+
+            _Epoch_domain(const _Epoch_domain&)            = delete;
+            _Epoch_domain& operator=(const _Epoch_domain&) = delete;
+
+            size_t _Enter() noexcept {
+                // Note: Readers are counted per epoch parity in stripes, chosen by the current processor,
+                //       so that concurrent readers rarely write to the same cache line. The epoch is checked
+                //       again after counting, a reader that raced with _Synchronize() retries in the new epoch.
+                const size_t _Stripe = mjsync_impl::_Current_processor_index() % _Stripe_count;
+                for (;;) {
+                    const uint64_t _Epoch           = _Myepoch.load(::std::memory_order_seq_cst);
+                    const size_t _Parity            = static_cast<size_t>(_Epoch & 1);
+                    ::std::atomic<size_t>& _Readers = _Mystripes[_Stripe]._Readers[_Parity];
+                    _Readers.fetch_add(1, ::std::memory_order_seq_cst);
+                    if (_Myepoch.load(::std::memory_order_seq_cst) == _Epoch) {
+                        return (_Stripe << 1) | _Parity;
+                    }
+
+                    _Readers.fetch_sub(1, ::std::memory_order_release);
+                }
+            }
+
+            void _Leave(const size_t _Token) noexcept {
+                _Mystripes[_Token >> 1]._Readers[_Token & 1].fetch_sub(1, ::std::memory_order_release);
+            }
+
+            void _Synchronize() noexcept {
+                // waits until every reader that may still see the replaced data has left, the caller must have
+                // published the new data before and must serialize the calls
+                const uint64_t _Epoch = _Myepoch.fetch_add(1, ::std::memory_order_seq_cst);
+                const size_t _Parity  = static_cast<size_t>(_Epoch & 1);
+                for (_Stripe& _Entry : _Mystripes) {
+                    while (_Entry._Readers[_Parity].load(::std::memory_order_seq_cst) != 0) {
+                        mjsync_impl::_Yield_thread(); // the read-side sections are short
+                    }
+                }
+            }
+
+        private:
+            static constexpr size_t _Stripe_count = 64;
+
+            struct _Stripe {
+                ::std::atomic<size_t> _Readers[2]; // readers in the even and the odd epoch
+                unsigned char _Padding[64 - 2 * sizeof(::std::atomic<size_t>)]; // one stripe per cache line
+            };
+
+            _Stripe _Mystripes[_Stripe_count];
+            ::std::atomic<uint64_t> _Myepoch;
+        };
+
+        class _Epoch_guard { // automatically enters and leaves a read-side section
+        public:
+            explicit _Epoch_guard(_Epoch_domain& _Domain) noexcept : _Mydomain(_Domain), _Mytoken(_Domain._Enter()) {}
+
+            ~_Epoch_guard() noexcept {
+                _Mydomain._Leave(_Mytoken);
+            }
+
+            _Epoch_guard(const _Epoch_guard&)            = delete;
+            _Epoch_guard& operator=(const _Epoch_guard&) = delete;
+
+        private:
+            _Epoch_domain& _Mydomain;
+            const size_t _Mytoken;
+        };
+    } // namespace mjsync_impl
+} // namespace mjx
+
+#endif // _MJSYNC_IMPL_EPOCH_HPP_
\ No newline at end of file
@@ -3,6 +3,7 @@
 // Copyright (c) Mateusz Jandura. All rights reserved.
 // SPDX-License-Identifier: Apache-2.0
 
+#ifdef _WIN32
 #include <mjsync/impl/tinywin.hpp>
 
 int __stdcall DllMain(HMODULE _Module, unsigned long _Reason, void*) {
@@ -15,4 +16,5 @@ int __stdcall DllMain(HMODULE _Module, unsigned long _Reason, void*) {
 #else // ^^^ x64 or x86 ^^^ / vvv not supported architecture vvv
     return 0;
 #endif // defined(_M_X64) || defined(_M_IX86)
-}
\ No newline at end of file
+}
+#endif // _WIN32
\ No newline at end of file
@@ -0,0 +1,83 @@
+// metrics.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _MJSYNC_IMPL_METRICS_HPP_
+#define _MJSYNC_IMPL_METRICS_HPP_
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mjsync/latency_histogram.hpp>
+
+// Note: Define MJSYNC_TASK_METRICS as 1 when building the library to stamp each task at enqueue, at dequeue
+//       and at completion, and to record the queue-wait and run-time latencies per worker. Otherwise
+//       nothing is stamped or recorded and the histograms stay empty. The public types are the same either way.
+#ifndef MJSYNC_TASK_METRICS
+#define MJSYNC_TASK_METRICS 0
+#endif // MJSYNC_TASK_METRICS
+
+namespace mjx {
+    namespace mjsync_impl {
+        inline constexpr bool _Task_metrics_enabled = MJSYNC_TASK_METRICS != 0;
+
+        class _Latency_recorder { // histogram written by a single thread and read by any thread without locking
+        public:
+            _Latency_recorder() noexcept : _Mybuckets(), _Mysum(0), _Mymin(UINT64_MAX), _Mymax(0) {}
+
+            ~_Latency_recorder() noexcept {}
+
+            _Latency_recorder(const _Latency_recorder&)            = delete;
+            _Latency_recorder& operator=(const _Latency_recorder&) = delete;
+
+            void _Record(const latency_histogram::duration _Value) noexcept {
+                // Note: Only the owning worker writes, so a relaxed load and store replace the read-modify-write
+                //       operations, which keeps recording free of locked instructions. The count is not stored,
+                //       the snapshot sums the buckets, so its percentiles always agree with its count.
+                const uint64_t _Nanoseconds = _Value.count() > 0 ? static_cast<uint64_t>(_Value.count()) : 0;
+                _Bump(_Mybuckets[latency_histogram::bucket_index(_Value)], 1);
+                _Bump(_Mysum, _Nanoseconds);
+                if (_Nanoseconds < _Mymin.load(::std::memory_order_relaxed)) {
+                    _Mymin.store(_Nanoseconds, ::std::memory_order_relaxed);
+                }
+
+                if (_Nanoseconds > _Mymax.load(::std::memory_order_relaxed)) {
+                    _Mymax.store(_Nanoseconds, ::std::memory_order_relaxed);
+                }
+            }
+
+            void _Snapshot(latency_histogram& _Target) const noexcept {
+                // adds the recorded samples to the histogram
+                latency_histogram _Copy;
+                for (size_t _Idx = 0; _Idx < latency_histogram::bucket_count; ++_Idx) {
+                    _Copy._Mybuckets[_Idx] = _Mybuckets[_Idx].load(::std::memory_order_relaxed);
+                    _Copy._Mycount        += _Copy._Mybuckets[_Idx];
+                }
+
+                _Copy._Mysum = _Mysum.load(::std::memory_order_relaxed);
+                _Copy._Mymin = _Mymin.load(::std::memory_order_relaxed);
+                _Copy._Mymax = _Mymax.load(::std::memory_order_relaxed);
+                _Target.merge(_Copy);
+            }
+
+        private:
+            static void _Bump(::std::atomic<uint64_t>& _Counter, const uint64_t _Value) noexcept {
+                _Counter.store(_Counter.load(::std::memory_order_relaxed) + _Value, ::std::memory_order_relaxed);
+            }
+
+            ::std::atomic<uint64_t> _Mybuckets[latency_histogram::bucket_count];
+            ::std::atomic<uint64_t> _Mysum; // in nanoseconds
+            ::std::atomic<uint64_t> _Mymin; // in nanoseconds
+            ::std::atomic<uint64_t> _Mymax; // in nanoseconds
+        };
+
+        struct _Task_metrics { // latencies of the tasks run by one worker
+            _Latency_recorder _Queue_wait; // from enqueue to dequeue
+            _Latency_recorder _Run_time; // from dequeue to completion
+        };
+    } // namespace mjsync_impl
+} // namespace mjx
+
+#endif // _MJSYNC_IMPL_METRICS_HPP_
\ No newline at end of file
@@ -0,0 +1,303 @@
+// platform.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _MJSYNC_IMPL_PLATFORM_HPP_
+#define _MJSYNC_IMPL_PLATFORM_HPP_
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mjmem/smart_pointer.hpp>
+#include <mjsync/impl/utils.hpp>
+#include <mjsync/thread.hpp>
+#include <mjsync/topology.hpp>
+#ifdef _WIN32
+#include <mjsync/impl/tinywin.hpp>
+#else // ^^^ _WIN32 ^^^ / vvv !_WIN32 vvv
+#include <cerrno>
+#include <climits>
+#include <ctime>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif // _WIN32
+
+// Note: Every call into the operating system goes through this header, so that the rest of the library
+//       is shared by all platforms. Windows uses the Win32 API, Linux uses pthreads and futexes.
+
+#ifdef _WIN32
+#define _MJSYNC_THREAD_CALL __stdcall
+#else // ^^^ _WIN32 ^^^ / vvv !_WIN32 vvv
+#define _MJSYNC_THREAD_CALL
+#endif // _WIN32
+
+namespace mjx {
+    namespace mjsync_impl {
+        using _Thread_routine_t = unsigned long(_MJSYNC_THREAD_CALL*)(void*);
+
+        // processors per processor group, Linux numbers its processors contiguously and is split the same way
+        inline constexpr size_t _Group_width = sizeof(void*) * 8;
+
+        inline void _Pause_processor() noexcept {
+            // hints the processor that the thread is spinning
+#ifdef _WIN32
+            ::YieldProcessor();
+#elif defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+            asm volatile("yield" ::: "memory");
+#else // ^^^ known architecture ^^^ / vvv unknown architecture vvv
+            ::std::atomic_signal_fence(::std::memory_order_seq_cst);
+#endif // _WIN32
+        }
+
+        inline void _Yield_thread() noexcept {
+            // gives up the rest of the time slice
+#ifdef _WIN32
+            ::SwitchToThread();
+#else // ^^^ _WIN32 ^^^ / vvv !_WIN32 vvv
+            ::sched_yield();
+#endif // _WIN32
+        }
+
+        inline void _Sleep_thread(const uintmax_t _Milliseconds) noexcept {
+#ifdef _WIN32
+            ::Sleep(static_cast<unsigned long>(_Milliseconds));
+#else // ^^^ _WIN32 ^^^ / vvv !_WIN32 vvv
+            timespec _Time;
+            _Time.tv_sec  = static_cast<time_t>(_Milliseconds / 1000);
+            _Time.tv_nsec = static_cast<long>(_Milliseconds % 1000) * 1'000'000;
+            while (::clock_nanosleep(CLOCK_MONOTONIC, 0, &_Time, &_Time) == EINTR) { // resume after a signal
+            }
+#endif // _WIN32
+        }
+
+        inline thread::id _Current_thread_id() noexcept {
+#ifdef _WIN32
+            return static_cast<thread::id>(::GetCurrentThreadId());
+#else // ^^^ _WIN32 ^^^ / vvv !_WIN32 vvv
+            static thread_local const thread::id _Id = static_cast<thread::id>(::syscall(SYS_gettid));
+            return _Id;
+#endif // _WIN32
+        }
+
+        inline void _Current_processor(uint16_t& _Group, uint8_t& _Number) noexcept {
+            // returns the processor that runs the calling thread
+#ifdef _WIN32
+            PROCESSOR_NUMBER _Proc = {0};
+            ::GetCurrentProcessorNumberEx(&_Proc);
+            _Group  = _Proc.Group;
+            _Number = _Proc.Number;
+#else // ^^^ _WIN32 ^^^ / vvv !_WIN32 vvv
+            const int _Cpu = ::sched_getcpu();
+            const size_t _Idx = _Cpu >= 0 ? static_cast<size_t>(_Cpu) : 0;
+            _Group  = static_cast<uint16_t>(_Idx / _Group_width);
+            _Number = static_cast<uint8_t>(_Idx % _Group_width);
+#endif // _WIN32
+        }
+
+        inline size_t _Current_processor_index() noexcept {
+            // cheaper than _Current_processor(), unique within the processor group
+#ifdef _WIN32
+            return static_cast<size_t>(::GetCurrentProcessorNumber());
+#else // ^^^ _WIN32 ^^^ / vvv !_WIN32 vvv
+            const int _Cpu = ::sched_getcpu();
+            return _Cpu >= 0 ? static_cast<size_t>(_Cpu) : 0;
+#endif // _WIN32
+        }
+
+        inline size_t _Hardware_concurrency() noexcept {
+#ifdef _WIN32
+            SYSTEM_INFO _Info = {0};
+            ::GetSystemInfo(&_Info);
+            return static_cast<size_t>(_Info.dwNumberOfProcessors);
+#else // ^^^ _WIN32 ^^^ / vvv !_WIN32 vvv
+            const long _Count = ::sysconf(_SC_NPROCESSORS_ONLN);
+            return _Count > 0 ? static_cast<size_t>(_Count) : 1;
+#endif // _WIN32
+        }
+
+#ifndef _WIN32
+        inline long _Futex_wait(
+            const void* const _Address, const uint32_t _Expected, const timespec* const _Timeout) noexcept {
+            // sleeps while the word equals _Expected, returns zero once woken, otherwise sets errno
+            return ::syscall(SYS_futex, _Address, FUTEX_WAIT_PRIVATE, _Expected, _Timeout, nullptr, 0);
+        }
+
+        inline void _Futex_wake(const void* const _Address, const int _Count) noexcept {
+            ::syscall(SYS_futex, _Address, FUTEX_WAKE_PRIVATE, _Count, nullptr, nullptr, 0);
+        }
+
+        struct _Thread_start { // passed to a new thread, lives on the stack of the creating thread
+            _Thread_routine_t _Routine;
+            void* _Arg;
+            ::std::atomic<thread::id> _Id; // zero until the new thread publishes its ID
+        };
+
+        inline void* _Thread_entry(void* const _Data) noexcept {
+            // Note: The creating thread waits until the ID is published, so the start block must not be touched
+            //       afterwards. The ID is the kernel's thread ID, as reported by current_thread_id().
+            _Thread_start* const _Start     = static_cast<_Thread_start*>(_Data);
+            const _Thread_routine_t _Routine = _Start->_Routine;
+            void* const _Arg                 = _Start->_Arg;
+            _Start->_Id.store(_Current_thread_id(), ::std::memory_order_release);
+            _Routine(_Arg);
+            return nullptr;
+        }
+#endif // _WIN32
+
+        inline bool _Create_thread(
+            const _Thread_routine_t _Routine, void* const _Arg, void*& _Handle, thread::id& _Id) noexcept {
+            // starts a new thread, returns its handle and ID
+#ifdef _WIN32
+            unsigned long _Native_id = 0;
+            _Handle = ::CreateThread(nullptr, 0, _Routine, _Arg, 0, &_Native_id);
+            _Id     = static_cast<thread::id>(_Native_id);
+            return _Handle != nullptr;
+#else // ^^^ _WIN32 ^^^ / vvv !_WIN32 vvv
+            static_assert(sizeof(pthread_t) <= sizeof(void*), "pthread_t must fit in the handle");
+            _Thread_start _Start{_Routine, _Arg, 0};
+            pthread_t _Native;
+            if (::pthread_create(&_Native, nullptr, &_Thread_entry, &_Start) != 0) {
+                _Handle = nullptr;
+                return false;
+            }
+
+            thread::id _New_id;
+            while ((_New_id = _Start._Id.load(::std::memory_order_acquire)) == 0) { // the ID is published first
+                ::sched_yield();
+            }
+
+            _Handle = reinterpret_cast<void*>(_Native);
+            _Id     = _New_id;
+            return true;
+#endif // _WIN32
+        }
+
+        inline void _Close_thread(void* const _Handle) noexcept {
+            // releases the handle of a thread that has finished its routine
+#ifdef _WIN32
+            ::CloseHandle(_Handle);
+#else // ^^^ _WIN32 ^^^ / vvv !_WIN32 vvv
+            if (!_Handle) {
+                return;
+            }
+
+            // Note: A pthread must be joined or detached to release its resources. The routine has already
+            //       returned or is about to, so joining does not block for long. A thread cannot join itself,
+            //       which happens if a task destroys the thread that runs it.
+            const pthread_t _Native = reinterpret_cast<pthread_t>(_Handle);
+            if (::pthread_equal(_Native, ::pthread_self())) {
+                ::pthread_detach(_Native);
+            } else {
+                ::pthread_join(_Native, nullptr);
+            }
+#endif // _WIN32
+        }
+
+#ifdef _WIN32
+        inline bool _Set_thread_name_preferred(void* const _Handle, const char* const _Name) noexcept {
+            // set the thread name by using SetThreadDescription()
+            using _Fn_t        = long(__stdcall*)(void*, const wchar_t*);
+            static _Fn_t _Func = []() noexcept -> _Fn_t { // load it once
+                const HMODULE _Module = ::GetModuleHandleW(L"Kernel32");
+                if (!_Module) [[unlikely]] { // module not loaded, break
+                    return nullptr;
+                }
+
+                // Note: The SetThreadDescription() function was introducated in Windows 10, version 1607.
+                //       While it's possible to check the Windows version to determine availibility,
+                //       a more robust approach is to attempt to load the function dynamically from
+                //       the Kernel32.dll library. If the function is present, its signature will be available,
+                //       allowing successful loading. Otherwise, GetProcAddress() will return a null-pointer.
+                return reinterpret_cast<_Fn_t>(::GetProcAddress(_Module, "SetThreadDescription"));
+            }();
+            if (!_Func) { // function not loaded, break
+                return false;
+            }
+
+            try {
+                // call within a try-catch block to handle potential allocation failure gracefully
+                const size_t _Size = ::strlen(_Name);
+                auto _Widen        = ::mjx::make_unique_smart_array<wchar_t>(_Size + 1);
+                mjsync_impl::_Narrow_to_widen(_Name, _Name + _Size, _Widen.get());
+                return SUCCEEDED(_Func(_Handle, _Widen.get()));
+            } catch (...) {
+                return false;
+            }
+        }
+
+        struct alignas(8) _Thread_name_info {
+            unsigned long _Type;
+            const char* _Name;
+            unsigned long _Thread_id;
+            unsigned long _Flags;
+        };
+
+        inline bool _Set_thread_name_fallback(void* const _Handle, const char* const _Name) noexcept {
+            // set the thread name by throwing an exception
+            _Thread_name_info _Info;
+            _Info._Type      = 0x1000; // must be 0x1000
+            _Info._Name      = _Name;
+            _Info._Thread_id = ::GetThreadId(_Handle);
+            _Info._Flags     = 0; // must be zero
+            __try {
+                // communicate with debugger by throwing a specially-configured exception
+                constexpr unsigned long _Code = 0x406D'1388;
+                ::RaiseException(_Code, 0, sizeof(_Thread_name_info) / sizeof(ULONG_PTR),
+                    reinterpret_cast<const ULONG_PTR*>(&_Info));
+                return false;
+            } __except (EXCEPTION_EXECUTE_HANDLER) {
+                return true; // expected behavior, treat it as a success
+            }
+        }
+#endif // _WIN32
+
+        inline bool _Set_thread_name(void* const _Handle, const char* const _Name) noexcept {
+#ifdef _WIN32
+            if (_Set_thread_name_preferred(_Handle, _Name)) { // preferred solution succeeded
+                return true;
+            }
+
+            // preferred solution failed, use fallback solution
+            return _Set_thread_name_fallback(_Handle, _Name);
+#else // ^^^ _WIN32 ^^^ / vvv !_WIN32 vvv
+            // Linux limits the name to 15 characters, the longer ones are truncated rather than rejected
+            char _Short[16];
+            ::strncpy(_Short, _Name, sizeof(_Short) - 1);
+            _Short[sizeof(_Short) - 1] = '\0';
+            return ::pthread_setname_np(reinterpret_cast<pthread_t>(_Handle), _Short) == 0;
+#endif // _WIN32
+        }
+
+        inline bool _Set_thread_affinity(void* const _Handle, const processor_info& _Proc) noexcept {
+            if (_Proc.number >= _Group_width) {
+                return false;
+            }
+
+#ifdef _WIN32
+            GROUP_AFFINITY _Affinity = {0};
+            _Affinity.Mask           = ULONG_PTR{1} << _Proc.number;
+            _Affinity.Group          = _Proc.group;
+            return ::SetThreadGroupAffinity(_Handle, &_Affinity, nullptr) != 0;
+#else // ^^^ _WIN32 ^^^ / vvv !_WIN32 vvv
+            const size_t _Cpu = static_cast<size_t>(_Proc.group) * _Group_width + _Proc.number;
+            if (_Cpu >= CPU_SETSIZE) {
+                return false;
+            }
+
+            cpu_set_t _Set;
+            CPU_ZERO(&_Set);
+            CPU_SET(_Cpu, &_Set);
+            return ::pthread_setaffinity_np(reinterpret_cast<pthread_t>(_Handle), sizeof(_Set), &_Set) == 0;
+#endif // _WIN32
+        }
+    } // namespace mjsync_impl
+} // namespace mjx
+
+#endif // _MJSYNC_IMPL_PLATFORM_HPP_
\ No newline at end of file
@@ -0,0 +1,114 @@
+// srwlock.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _MJSYNC_IMPL_SRWLOCK_HPP_
+#define _MJSYNC_IMPL_SRWLOCK_HPP_
+#ifndef _WIN32
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <mjsync/impl/platform.hpp>
+
+namespace mjx {
+    namespace mjsync_impl {
+        class _Futex_rwlock { // reader/writer lock on a single 32-bit word, replaces SRWLOCK on Linux
+        public:
+            // Note: The low bits count the readers, the top bit marks the writer. The waiters bit is set
+            //       by every thread that goes to sleep and is cleared only by the thread that wakes all
+            //       of them, so that no wake-up is lost. Readers do not enter while it is set, which keeps
+            //       a stream of readers from starving a waiting writer.
+            static void _Lock_exclusive(uint32_t& _Word) noexcept {
+                ::std::atomic_ref<uint32_t> _Ref(_Word);
+                uint32_t _Expected = 0;
+                if (_Ref.compare_exchange_strong(
+                        _Expected, _Writer, ::std::memory_order_acquire, ::std::memory_order_relaxed)) {
+                    return; // uncontended
+                }
+
+                for (uint32_t _Round = 0;; ++_Round) {
+                    uint32_t _State = _Ref.load(::std::memory_order_relaxed);
+                    if ((_State & ~_Waiters) == 0) { // free, keep the waiters bit for the unlock
+                        if (_Ref.compare_exchange_weak(_State, _State | _Writer, ::std::memory_order_acquire,
+                                ::std::memory_order_relaxed)) {
+                            return;
+                        }
+
+                        continue;
+                    }
+
+                    if (_Round < _Spin_rounds) {
+                        mjsync_impl::_Pause_processor();
+                        continue;
+                    }
+
+                    _Sleep(_Ref, _Word, _State);
+                }
+            }
+
+            static void _Lock_shared(uint32_t& _Word) noexcept {
+                ::std::atomic_ref<uint32_t> _Ref(_Word);
+                for (uint32_t _Round = 0;; ++_Round) {
+                    uint32_t _State = _Ref.load(::std::memory_order_relaxed);
+                    if ((_State & (_Writer | _Waiters)) == 0) {
+                        if (_Ref.compare_exchange_weak(
+                                _State, _State + 1, ::std::memory_order_acquire, ::std::memory_order_relaxed)) {
+                            return;
+                        }
+
+                        continue;
+                    }
+
+                    if (_Round < _Spin_rounds) {
+                        mjsync_impl::_Pause_processor();
+                        continue;
+                    }
+
+                    _Sleep(_Ref, _Word, _State);
+                }
+            }
+
+            static void _Unlock_exclusive(uint32_t& _Word) noexcept {
+                ::std::atomic_ref<uint32_t> _Ref(_Word);
+                if (_Ref.exchange(0, ::std::memory_order_release) & _Waiters) { // no readers while held
+                    mjsync_impl::_Futex_wake(&_Word, INT_MAX);
+                }
+            }
+
+            static void _Unlock_shared(uint32_t& _Word) noexcept {
+                ::std::atomic_ref<uint32_t> _Ref(_Word);
+                const uint32_t _State = _Ref.fetch_sub(1, ::std::memory_order_release);
+                if ((_State & _Readers) == 1 && (_State & _Waiters)) { // the last reader, wake the sleepers
+                    // the CAS fails only if a writer took the lock, its unlock wakes them instead
+                    uint32_t _Expected = _Waiters;
+                    if (_Ref.compare_exchange_strong(_Expected, 0, ::std::memory_order_relaxed)) {
+                        mjsync_impl::_Futex_wake(&_Word, INT_MAX);
+                    }
+                }
+            }
+
+        private:
+            static constexpr uint32_t _Writer      = uint32_t{1} << 31;
+            static constexpr uint32_t _Waiters     = uint32_t{1} << 30;
+            static constexpr uint32_t _Readers     = _Waiters - 1;
+            static constexpr uint32_t _Spin_rounds = 64; // the critical sections are expected to be short
+
+            static void _Sleep(::std::atomic_ref<uint32_t>& _Ref, uint32_t& _Word, uint32_t _State) noexcept {
+                // announces the waiter, then sleeps unless the word changed in the meantime
+                if (!(_State & _Waiters)) {
+                    if (!_Ref.compare_exchange_strong(
+                            _State, _State | _Waiters, ::std::memory_order_relaxed, ::std::memory_order_relaxed)) {
+                        return; // changed, retry
+                    }
+                }
+
+                mjsync_impl::_Futex_wait(&_Word, _State | _Waiters, nullptr);
+            }
+        };
+    } // namespace mjsync_impl
+} // namespace mjx
+#endif // _WIN32
+
+#endif // _MJSYNC_IMPL_SRWLOCK_HPP_
\ No newline at end of file
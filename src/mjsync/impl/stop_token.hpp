@@ -0,0 +1,139 @@
+// stop_token.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _MJSYNC_IMPL_STOP_TOKEN_HPP_
+#define _MJSYNC_IMPL_STOP_TOKEN_HPP_
+#include <atomic>
+#include <cstdint>
+#include <mjmem/object_allocator.hpp>
+#include <mjsync/impl/platform.hpp>
+#include <mjsync/srwlock.hpp>
+#include <mjsync/stop_token.hpp>
+
+namespace mjx {
+    namespace mjsync_impl {
+        class _Stop_state { // shared by a stop source, its tokens and the registered callbacks
+        public:
+            _Stop_state() noexcept
+                : _Mystopped(false), _Myrefs(1), _Myhead(nullptr), _Myrunning(nullptr), _Myinvoker(0), _Mylock() {}
+
+            ~_Stop_state() noexcept {}
+
+            _Stop_state(const _Stop_state&)            = delete;
+            _Stop_state& operator=(const _Stop_state&) = delete;
+
+            static void _Add_ref(_Stop_state* const _State) noexcept {
+                if (_State) {
+                    _State->_Myrefs.fetch_add(1, ::std::memory_order_relaxed);
+                }
+            }
+
+            static void _Release(_Stop_state* const _State) noexcept {
+                if (_State && _State->_Myrefs.fetch_sub(1, ::std::memory_order_acq_rel) == 1) {
+                    ::mjx::delete_object(_State);
+                }
+            }
+
+            bool _Stop_requested() const noexcept {
+                return _Mystopped.load(::std::memory_order_relaxed);
+            }
+
+            bool _Request_stop() noexcept {
+                // Note: The callbacks are invoked by the requesting thread without the lock held, so that
+                //       a callback may register or unregister other callbacks. The callback being invoked
+                //       is remembered, its destructor waits for it unless called from the callback itself.
+                lock_guard _Guard(_Mylock);
+                if (_Mystopped.load(::std::memory_order_relaxed)) { // already requested
+                    return false;
+                }
+
+                _Mystopped.store(true, ::std::memory_order_release);
+                _Myinvoker = mjsync_impl::_Current_thread_id();
+                while (_Myhead) {
+                    stop_callback* const _Callback = _Myhead;
+                    _Unlink(_Callback);
+                    _Myrunning = _Callback;
+                    _Mylock.unlock();
+                    _Callback->_Mycallback(_Callback->_Myarg);
+                    _Mylock.lock();
+                    if (_Myrunning) { // not destroyed by the callback itself
+                        _Myrunning = nullptr;
+                        _Callback->_Mydone.store(true, ::std::memory_order_release);
+                        _Callback->_Mydone.notify_all();
+                    }
+                }
+
+                return true;
+            }
+
+            bool _Register(stop_callback* const _Callback) noexcept {
+                // fails if a stop has already been requested, the caller then invokes the callback itself
+                lock_guard _Guard(_Mylock);
+                if (_Mystopped.load(::std::memory_order_relaxed)) {
+                    return false;
+                }
+
+                _Callback->_Myprev = nullptr;
+                _Callback->_Mynext = _Myhead;
+                if (_Myhead) {
+                    _Myhead->_Myprev = _Callback;
+                }
+
+                _Myhead = _Callback;
+                return true;
+            }
+
+            void _Unregister(stop_callback* const _Callback) noexcept {
+                {
+                    lock_guard _Guard(_Mylock);
+                    if (_Callback->_Myprev || _Myhead == _Callback) { // still registered, never invoked
+                        _Unlink(_Callback);
+                        return;
+                    }
+
+                    if (_Myrunning != _Callback) { // already invoked
+                        return;
+                    }
+
+                    if (_Myinvoker == mjsync_impl::_Current_thread_id()) { // destroyed by the callback itself
+                        _Myrunning = nullptr;
+                        return;
+                    }
+                }
+
+                // invoked by another thread, which notifies under the lock, so once the lock is acquired,
+                // it no longer touches the callback
+                _Callback->_Mydone.wait(false, ::std::memory_order_acquire);
+                lock_guard _Guard(_Mylock);
+            }
+
+        private:
+            void _Unlink(stop_callback* const _Callback) noexcept {
+                if (_Callback->_Myprev) {
+                    _Callback->_Myprev->_Mynext = _Callback->_Mynext;
+                } else {
+                    _Myhead = _Callback->_Mynext;
+                }
+
+                if (_Callback->_Mynext) {
+                    _Callback->_Mynext->_Myprev = _Callback->_Myprev;
+                }
+
+                _Callback->_Myprev = nullptr;
+                _Callback->_Mynext = nullptr;
+            }
+
+            ::std::atomic<bool> _Mystopped;
+            ::std::atomic<uint32_t> _Myrefs; // one reference per source, token and registered callback
+            stop_callback* _Myhead; // registered callbacks, not invoked yet
+            stop_callback* _Myrunning; // callback being invoked, if any
+            thread::id _Myinvoker; // ID of the thread that requested the stop
+            shared_lock _Mylock;
+        };
+    } // namespace mjsync_impl
+} // namespace mjx
+
+#endif // _MJSYNC_IMPL_STOP_TOKEN_HPP_
\ No newline at end of file
@@ -6,6 +6,7 @@
 #pragma once
 #ifndef _MJSYNC_IMPL_TASK_HPP_
 #define _MJSYNC_IMPL_TASK_HPP_
+#include <mjsync/impl/task_table.hpp>
 #include <mjsync/impl/thread.hpp>
 #include <mjsync/task.hpp>
 
@@ -13,8 +14,7 @@ namespace mjx {
     namespace mjsync_impl {
         class _Task_proxy { // proxy class for task-thread linkage
         public:
-            _Task_proxy(const task::id _Id, _Thread_impl* const _Thread) noexcept
-                : _Mytask(_Thread ? _Thread->_Find_task(_Id) : nullptr) {}
+            explicit _Task_proxy(const task::id _Id) noexcept : _Mytask(_Get_task_table()._Find(_Id)) {}
 
             ~_Task_proxy() noexcept {}
 
@@ -35,12 +35,14 @@ namespace mjx {
                     return _Result_t::task_not_registered;
                 }
 
-                if (_Mytask->_State.load(::std::memory_order_acquire) == task_state::canceled) {
-                    return _Result_t::already_canceled;
+                if (_Mytask->_Cancel_pending()) {
+                    return _Result_t::success;
                 }
 
-                _Mytask->_State.store(task_state::canceled, ::std::memory_order_release);
-                return _Result_t::success;
+                // Note: Only a task that has not started can be canceled, the worker that dequeues it
+                //       skips it. A running or finished task is left as it is.
+                return _Mytask->_State.load(::std::memory_order_acquire) == task_state::canceled
+                    ? _Result_t::already_canceled : _Result_t::already_started;
             }
 
             void _Wait_until_done() noexcept {
@@ -48,8 +50,12 @@ namespace mjx {
                     switch (_Mytask->_State.load(::std::memory_order_acquire)) {
                     case task_state::enqueued:
                     case task_state::running:
-                        // worth waiting, do it
-                        _Mytask->_Completion_event.wait_and_reset();
+                        // worth waiting, a worker runs the task itself or other tasks first
+                        if (!_Thread_impl::_Run_inline(_Mytask)) {
+                            _Thread_impl::_Help_until([this]() noexcept { return !_Mytask->_Is_pending(); });
+                        }
+
+                        _Mytask->_Wait();
                         break;
                     default:
                         // avoid infinite wait, don't wait
@@ -58,6 +64,14 @@ namespace mjx {
                 }
             }
 
+            void _Release() noexcept {
+                // drop the reference held by the task handle
+                if (_Mytask) {
+                    _Get_task_table()._Release(_Mytask);
+                    _Mytask = nullptr;
+                }
+            }
+
         private:
             _Queued_task* _Mytask;
         };
@@ -0,0 +1,296 @@
+// task_graph.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _MJSYNC_IMPL_TASK_GRAPH_HPP_
+#define _MJSYNC_IMPL_TASK_GRAPH_HPP_
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <future>
+#include <mjmem/object_allocator.hpp>
+#include <mjmem/smart_pointer.hpp>
+#include <mjsync/impl/thread.hpp>
+#include <mjsync/impl/utils.hpp>
+#include <mjsync/task.hpp>
+#include <mjsync/task_graph.hpp>
+#include <mjsync/thread.hpp>
+#include <utility>
+
+namespace mjx {
+    namespace mjsync_impl {
+        class _Graph_state;
+
+        struct _Graph_node {
+            _Graph_state* _Owner;
+            _Graph_callable* _Func;
+            size_t _Index;
+            task_priority _Priority;
+            bool _Started; // set once the node's task begins, reset before each run
+            size_t _Predecessors; // number of incoming edges
+            ::std::atomic<size_t> _Pending; // predecessors that have not finished in the current run
+            _Graph_node** _Successors;
+            size_t _Successor_count;
+            size_t _Successor_capacity;
+            _Graph_node* _Next_skipped; // next skipped node that waits to be completed
+
+            _Graph_node(_Graph_state* const _Owner, _Graph_callable* const _Func, const size_t _Index,
+                const task_priority _Priority) noexcept
+                : _Owner(_Owner), _Func(_Func), _Index(_Index), _Priority(_Priority), _Started(false),
+                _Predecessors(0), _Pending(0), _Successors(nullptr), _Successor_count(0), _Successor_capacity(0),
+                _Next_skipped(nullptr) {}
+
+            ~_Graph_node() noexcept {
+                _Func->_Destroy();
+                ::mjx::delete_object_array(_Successors, _Successor_capacity);
+            }
+
+            _Graph_node(const _Graph_node&)            = delete;
+            _Graph_node& operator=(const _Graph_node&) = delete;
+        };
+
+        class _Graph_state { // nodes and edges of a task graph, along with the state of the current run
+        public:
+            using _Schedule_fn = task(*)(void*, const task_descriptor&);
+
+            _Graph_state() noexcept
+                : _Mynodes(nullptr), _Mysize(0), _Mycapacity(0), _Myscheduler(nullptr), _Myschedule(nullptr),
+                _Myrefs(1), _Myremaining(0), _Myrunning(false), _Myfailing(false), _Myfailed(false), _Myexception() {}
+
+            ~_Graph_state() noexcept {
+                for (size_t _Idx = 0; _Idx < _Mysize; ++_Idx) {
+                    ::mjx::delete_object(_Mynodes[_Idx]);
+                }
+
+                ::mjx::delete_object_array(_Mynodes, _Mycapacity);
+            }
+
+            _Graph_state(const _Graph_state&)            = delete;
+            _Graph_state& operator=(const _Graph_state&) = delete;
+
+            static void _Release_state(_Graph_state* const _State) noexcept {
+                // the owner and the completing nodes hold a reference, the last one destroys the state
+                if (_State->_Myrefs.fetch_sub(1, ::std::memory_order_acq_rel) == 1) {
+                    ::mjx::delete_object(_State);
+                }
+            }
+
+            size_t _Size() const noexcept {
+                return _Mysize;
+            }
+
+            bool _Is_running() const noexcept {
+                return _Myrunning.load(::std::memory_order_acquire);
+            }
+
+            size_t _Add_node(_Graph_callable* const _Callable, const task_priority _Priority) {
+                try {
+                    mjsync_impl::_Reserve_one_more(_Mynodes, _Mysize, _Mycapacity);
+                    _Mynodes[_Mysize] = ::mjx::create_object<_Graph_node>(this, _Callable, _Mysize, _Priority);
+                } catch (...) {
+                    _Callable->_Destroy();
+                    throw;
+                }
+
+                return _Mysize++;
+            }
+
+            bool _Add_edge(const size_t _Before, const size_t _After) {
+                if (_Before >= _Mysize || _After >= _Mysize || _Before == _After) { // invalid edge
+                    return false;
+                }
+
+                _Graph_node* const _From = _Mynodes[_Before];
+                _Graph_node* const _To   = _Mynodes[_After];
+                if (::std::find(_From->_Successors, _From->_Successors + _From->_Successor_count, _To)
+                    != _From->_Successors + _From->_Successor_count) { // the edge already exists
+                    return false;
+                }
+
+                if (_Is_reachable(_To, _From)) { // the edge would close a cycle
+                    return false;
+                }
+
+                mjsync_impl::_Reserve_one_more(_From->_Successors, _From->_Successor_count, _From->_Successor_capacity);
+                _From->_Successors[_From->_Successor_count++] = _To;
+                ++_To->_Predecessors;
+                return true;
+            }
+
+            bool _Run(void* const _Scheduler, const _Schedule_fn _Schedule) {
+                bool _Expected = false;
+                if (!_Myrunning.compare_exchange_strong(_Expected, true, ::std::memory_order_acq_rel)) {
+                    return false; // already running
+                }
+
+                _Myscheduler = _Scheduler;
+                _Myschedule  = _Schedule;
+                _Myfailing.store(false, ::std::memory_order_relaxed);
+                _Myfailed.store(false, ::std::memory_order_relaxed);
+                _Myexception = nullptr;
+                for (size_t _Idx = 0; _Idx < _Mysize; ++_Idx) { // reset the counters, nothing is allocated
+                    _Graph_node* const _Node = _Mynodes[_Idx];
+                    _Node->_Started          = false;
+                    _Node->_Pending.store(_Node->_Predecessors, ::std::memory_order_relaxed);
+                }
+
+                // Note: There is no coordinator. Each node releases its successors once it is done and the last
+                //       node wakes up this thread. The edges are read-only while running, so the roots
+                //       can be dispatched while the nodes released by them are already running.
+                _Myremaining.store(_Mysize, ::std::memory_order_release);
+                for (size_t _Idx = 0; _Idx < _Mysize; ++_Idx) {
+                    if (_Mynodes[_Idx]->_Predecessors == 0) { // root node, ready to run
+                        _Dispatch(_Mynodes[_Idx]);
+                    }
+                }
+
+                _Thread_impl::_Help_until( // a worker runs other tasks until the nodes finish
+                    [this]() noexcept { return _Myremaining.load(::std::memory_order_acquire) == 0; });
+                for (;;) {
+                    const size_t _Count = _Myremaining.load(::std::memory_order_acquire);
+                    if (_Count == 0) {
+                        break;
+                    }
+
+                    _Myremaining.wait(_Count, ::std::memory_order_acquire);
+                }
+
+                const ::std::exception_ptr _Exception = ::std::move(_Myexception);
+                _Myrunning.store(false, ::std::memory_order_release);
+                if (_Exception) {
+                    ::std::rethrow_exception(_Exception);
+                }
+
+                return true;
+            }
+
+        private:
+            bool _Is_reachable(_Graph_node* const _From, _Graph_node* const _To) const {
+                // depth-first search, each node is pushed at most once
+                unique_smart_array<bool> _Visited = ::mjx::make_unique_smart_array<bool>(_Mysize);
+                unique_smart_array<_Graph_node*> _Stack = ::mjx::make_unique_smart_array<_Graph_node*>(_Mysize);
+                ::std::fill(_Visited.get(), _Visited.get() + _Mysize, false);
+                size_t _Top                    = 0;
+                _Stack.get()[_Top++]           = _From;
+                _Visited.get()[_From->_Index] = true;
+                while (_Top > 0) {
+                    _Graph_node* const _Node = _Stack.get()[--_Top];
+                    if (_Node == _To) {
+                        return true;
+                    }
+
+                    for (size_t _Idx = 0; _Idx < _Node->_Successor_count; ++_Idx) {
+                        _Graph_node* const _Next = _Node->_Successors[_Idx];
+                        if (!_Visited.get()[_Next->_Index]) {
+                            _Visited.get()[_Next->_Index] = true;
+                            _Stack.get()[_Top++]          = _Next;
+                        }
+                    }
+                }
+
+                return false;
+            }
+
+            static void _Run_node(void* const _Arg) noexcept {
+                _Graph_node* const _Node = static_cast<_Graph_node*>(_Arg);
+                _Node->_Started          = true;
+                if (!_Node->_Owner->_Myfailed.load(::std::memory_order_relaxed)) {
+                    try {
+                        _Node->_Func->_Invoke();
+                    } catch (...) {
+                        _Node->_Owner->_Fail(::std::current_exception());
+                    }
+                }
+            }
+
+            static void _Finish_node(void* const _Arg) noexcept {
+                // called once the scheduler is done with the node, whether it ran or has been canceled
+                _Graph_node* const _Node = static_cast<_Graph_node*>(_Arg);
+                if (!_Node->_Started) { // canceled, the run is incomplete
+                    _Node->_Owner->_Fail(
+                        ::std::make_exception_ptr(::std::future_error(::std::future_errc::broken_promise)));
+                }
+
+                _Node->_Owner->_Complete(_Node);
+            }
+
+            void _Fail(::std::exception_ptr _Exception) noexcept {
+                // only the first exception is kept, the remaining nodes are skipped
+                bool _Expected = false;
+                if (_Myfailing.compare_exchange_strong(_Expected, true, ::std::memory_order_acq_rel)) {
+                    _Myexception = ::std::move(_Exception);
+                    _Myfailed.store(true, ::std::memory_order_release);
+                }
+            }
+
+            bool _Try_dispatch(_Graph_node* const _Node) noexcept {
+                // schedules the node, returns false if it has been skipped
+                if (!_Myfailed.load(::std::memory_order_relaxed)) {
+                    try {
+                        const task_descriptor _Desc{&_Run_node, _Node, _Node->_Priority, &_Finish_node};
+                        if (_Myschedule(_Myscheduler, _Desc).is_registered()) {
+                            return true;
+                        }
+
+                        _Fail(::std::make_exception_ptr(::std::future_error(::std::future_errc::broken_promise)));
+                    } catch (...) {
+                        _Fail(::std::current_exception());
+                    }
+                }
+
+                return false;
+            }
+
+            void _Dispatch(_Graph_node* const _Node) noexcept {
+                if (!_Try_dispatch(_Node)) { // skipped, its successors must be released anyway
+                    _Complete(_Node);
+                }
+            }
+
+            void _Complete(_Graph_node* const _Node) noexcept {
+                // Note: The successors are released before the node is counted, so the run cannot end prematurely.
+                //       A skipped successor is completed by this thread as well. The skipped nodes are kept
+                //       on a worklist, a failure early in a long chain would overflow the stack otherwise.
+                //       Each node is completed once per run, so its link is free to use. Once the last node
+                //       is counted, _Run() may return and the owner may release the state, the reference
+                //       keeps it alive until the notification is done.
+                _Myrefs.fetch_add(1, ::std::memory_order_relaxed);
+                _Graph_node* _Worklist = _Node;
+                _Node->_Next_skipped   = nullptr;
+                while (_Worklist) {
+                    _Graph_node* const _Current = ::std::exchange(_Worklist, _Worklist->_Next_skipped);
+                    for (size_t _Idx = 0; _Idx < _Current->_Successor_count; ++_Idx) {
+                        _Graph_node* const _Next = _Current->_Successors[_Idx];
+                        if (_Next->_Pending.fetch_sub(1, ::std::memory_order_acq_rel) == 1 // the last predecessor
+                            && !_Try_dispatch(_Next)) {
+                            _Next->_Next_skipped = ::std::exchange(_Worklist, _Next);
+                        }
+                    }
+
+                    if (_Myremaining.fetch_sub(1, ::std::memory_order_acq_rel) == 1) { // the last node
+                        _Myremaining.notify_all();
+                    }
+                }
+
+                _Release_state(this);
+            }
+
+            _Graph_node** _Mynodes;
+            size_t _Mysize;
+            size_t _Mycapacity;
+            void* _Myscheduler;
+            _Schedule_fn _Myschedule;
+            ::std::atomic<size_t> _Myrefs; // the owner and the threads that are completing nodes
+            ::std::atomic<size_t> _Myremaining; // nodes that have not finished in the current run
+            ::std::atomic<bool> _Myrunning;
+            ::std::atomic<bool> _Myfailing; // set by the first failing node
+            ::std::atomic<bool> _Myfailed; // set once _Myexception is stored
+            ::std::exception_ptr _Myexception;
+        };
+    } // namespace mjsync_impl
+} // namespace mjx
+
+#endif // _MJSYNC_IMPL_TASK_GRAPH_HPP_
\ No newline at end of file
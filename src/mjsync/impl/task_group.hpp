@@ -0,0 +1,213 @@
+// task_group.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _MJSYNC_IMPL_TASK_GROUP_HPP_
+#define _MJSYNC_IMPL_TASK_GROUP_HPP_
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mjmem/object_allocator.hpp>
+#include <mjmem/smart_pointer.hpp>
+#include <mjsync/impl/thread.hpp>
+#include <mjsync/stop_token.hpp>
+#include <mjsync/task.hpp>
+#include <mjsync/task_group.hpp>
+#include <mjsync/thread.hpp>
+#include <new>
+
+namespace mjx {
+    namespace mjsync_impl {
+        class _Group_state { // members of a task group, counted by a single atomic counter
+        public:
+            using _Schedule_fn = task(*)(void*, const task_descriptor&);
+
+            _Group_state()
+                : _Myrefs(1), _Mypending(0), _Myunclaimed(nullptr), _Myfailed(nullptr), _Mycanceled(false),
+                _Mysource() {}
+
+            ~_Group_state() noexcept {
+                _Help(); // the owner has waited, nothing is left but the references
+                _Release_failed(_Myfailed.exchange(nullptr, ::std::memory_order_acquire));
+            }
+
+            _Group_state(const _Group_state&)            = delete;
+            _Group_state& operator=(const _Group_state&) = delete;
+
+            static void _Release_state(_Group_state* const _State) noexcept {
+                // the owner and the completing members hold a reference, the last one destroys the state
+                if (_State->_Myrefs.fetch_sub(1, ::std::memory_order_acq_rel) == 1) {
+                    ::mjx::delete_object(_State);
+                }
+            }
+
+            size_t _Pending() const noexcept {
+                return _Mypending.load(::std::memory_order_relaxed);
+            }
+
+            bool _Is_canceled() const noexcept {
+                return _Mycanceled.load(::std::memory_order_relaxed);
+            }
+
+            stop_token _Get_token() const noexcept {
+                return _Mysource.get_token();
+            }
+
+            void _Run(void* const _Scheduler, const _Schedule_fn _Schedule, _Group_task* const _Task,
+                const task_priority _Priority) noexcept {
+                // Note: The member is counted and listed before it is scheduled, so a waiter can neither miss it
+                //       nor wait for it in vain. If scheduling fails, the member stays in the list and the waiter
+                //       runs it, the group never loses a member.
+                _Task->_Group = this;
+                _Mypending.fetch_add(1, ::std::memory_order_relaxed);
+                _Task->_Next = _Myunclaimed.load(::std::memory_order_relaxed);
+                while (!_Myunclaimed.compare_exchange_weak(
+                    _Task->_Next, _Task, ::std::memory_order_release, ::std::memory_order_relaxed)) {}
+
+                try {
+                    const task_descriptor _Desc{&_Execute, _Task, _Priority, &_Drop};
+                    if (_Schedule(_Scheduler, _Desc).is_registered()) {
+                        return;
+                    }
+                } catch (...) {
+                }
+
+                _Release(_Task); // the scheduler has not taken the member
+            }
+
+            void _Wait() {
+                _Help();
+                _Thread_impl::_Help_until( // a worker runs other tasks until the running members finish
+                    [this]() noexcept { return _Mypending.load(::std::memory_order_acquire) == 0; });
+                for (;;) {
+                    const size_t _Count = _Mypending.load(::std::memory_order_acquire);
+                    if (_Count == 0) {
+                        break;
+                    }
+
+                    _Mypending.wait(_Count, ::std::memory_order_acquire);
+                }
+
+                _Group_task* const _Failed = _Myfailed.exchange(nullptr, ::std::memory_order_acquire);
+                if (!_Failed) {
+                    return;
+                }
+
+                // the exceptions are copied, the failed members are released in any case
+                size_t _Count = 0;
+                for (_Group_task* _Task = _Failed; _Task; _Task = _Task->_Next_failed) {
+                    ++_Count;
+                }
+
+                smart_array<::std::exception_ptr> _Exceptions;
+                try {
+                    _Exceptions = ::mjx::make_smart_array<::std::exception_ptr>(_Count);
+                } catch (...) {
+                    _Release_failed(_Failed);
+                    throw;
+                }
+
+                size_t _Idx = 0;
+                for (_Group_task* _Task = _Failed; _Task; _Task = _Task->_Next_failed) { // the storage is raw
+                    ::new (static_cast<void*>(_Exceptions.get() + _Idx++)) ::std::exception_ptr(_Task->_Exception);
+                }
+
+                _Release_failed(_Failed);
+                throw task_group_error(_Exceptions, _Count);
+            }
+
+            void _Cancel() noexcept {
+                // the members that have not started yet complete without running
+                _Mycanceled.store(true, ::std::memory_order_relaxed);
+                _Mysource.request_stop();
+                _Help();
+            }
+
+        private:
+            static void _Execute(void* const _Arg) noexcept {
+                _Group_task* const _Task = static_cast<_Group_task*>(_Arg);
+                if (_Claim(_Task)) {
+                    _Task->_Group->_Complete(_Task);
+                }
+            }
+
+            static void _Drop(void* const _Arg) noexcept {
+                // called once the scheduler is done with the member, whether it ran or has been canceled
+                _Release(static_cast<_Group_task*>(_Arg));
+            }
+
+            static bool _Claim(_Group_task* const _Task) noexcept {
+                // exactly one thread runs the member, the load avoids a write to an already claimed one
+                return !_Task->_Claimed.load(::std::memory_order_relaxed)
+                    && !_Task->_Claimed.exchange(true, ::std::memory_order_acquire);
+            }
+
+            static void _Release(_Group_task* const _Task) noexcept {
+                if (_Task->_Refs.fetch_sub(1, ::std::memory_order_acq_rel) == 1) {
+                    _Task->_Destroy();
+                }
+            }
+
+            static void _Release_failed(_Group_task* _List) noexcept {
+                for (_Group_task* _Next; _List; _List = _Next) {
+                    _Next = _List->_Next_failed;
+                    _Release(_List);
+                }
+            }
+
+            void _Help() noexcept {
+                // takes the whole list at once, the members that no worker has claimed yet run on this thread,
+                // the members may add new ones meanwhile
+                for (;;) {
+                    _Group_task* _List = _Myunclaimed.exchange(nullptr, ::std::memory_order_acquire);
+                    if (!_List) {
+                        break;
+                    }
+
+                    for (_Group_task* _Next; _List; _List = _Next) {
+                        _Next = _List->_Next;
+                        if (_Claim(_List)) {
+                            _Complete(_List);
+                        }
+
+                        _Release(_List);
+                    }
+                }
+            }
+
+            void _Complete(_Group_task* const _Task) noexcept {
+                if (!_Mycanceled.load(::std::memory_order_relaxed)) {
+                    try {
+                        _Task->_Invoke();
+                    } catch (...) { // keep the member until a waiter collects its exception
+                        _Task->_Exception = ::std::current_exception();
+                        _Task->_Refs.fetch_add(1, ::std::memory_order_relaxed);
+                        _Task->_Next_failed = _Myfailed.load(::std::memory_order_relaxed);
+                        while (!_Myfailed.compare_exchange_weak(_Task->_Next_failed, _Task,
+                            ::std::memory_order_release, ::std::memory_order_relaxed)) {}
+                    }
+                }
+
+                // Note: Once the counter reaches zero, the waiter may return and the owner may release the state.
+                //       The reference keeps the state alive until the notification is done.
+                _Myrefs.fetch_add(1, ::std::memory_order_relaxed);
+                if (_Mypending.fetch_sub(1, ::std::memory_order_acq_rel) == 1) { // the last member
+                    _Mypending.notify_all();
+                }
+
+                _Release_state(this);
+            }
+
+            ::std::atomic<size_t> _Myrefs; // the owner and the members that are completing
+            ::std::atomic<size_t> _Mypending; // members that have not finished yet
+            ::std::atomic<_Group_task*> _Myunclaimed; // members that may not have been claimed, pushed only
+            ::std::atomic<_Group_task*> _Myfailed; // members that have failed, pushed only
+            ::std::atomic<bool> _Mycanceled;
+            stop_source _Mysource; // stopped once the group is canceled
+        };
+    } // namespace mjsync_impl
+} // namespace mjx
+
+#endif // _MJSYNC_IMPL_TASK_GROUP_HPP_
\ No newline at end of file
@@ -0,0 +1,308 @@
+// task_table.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _MJSYNC_IMPL_TASK_TABLE_HPP_
+#define _MJSYNC_IMPL_TASK_TABLE_HPP_
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mjmem/exception.hpp>
+#include <mjmem/object_allocator.hpp>
+#include <mjsync/impl/metrics.hpp>
+#include <mjsync/srwlock.hpp>
+#include <mjsync/task.hpp>
+#include <mjsync/thread.hpp>
+#include <new>
+
+namespace mjx {
+    namespace mjsync_impl {
+        class _Queued_task { // task control block, lives in a slot of the task table
+        public:
+            _Queued_task* _Next; // next task in the owning queue, guarded by the queue's lock
+            _Queued_task* _Child; // first child in the owning queue's deadline heap, guarded by the queue's lock
+            ::std::atomic<task_state> _State; // also serves as the completion signal
+            ::std::atomic<uint32_t> _Waiters; // number of threads waiting for the completion
+            ::std::atomic<uint32_t> _Refs; // the handle, the queue and a worker that runs the task inline
+            ::std::atomic<uint32_t> _Generation; // incremented each time the slot is released
+            ::std::atomic<uint32_t> _Next_free; // next free slot index (biased by one), zero terminates
+            const uint32_t _Index; // immutable slot index
+            task_priority _Priority;
+            thread::callable _Callable;
+            void* _Arg;
+            void (*_Deleter)(void*); // releases _Arg once the task has run or has been canceled, optional
+            ::std::chrono::steady_clock::time_point _Deadline; // zero if the task has no deadline
+            const char* _Label; // names the task in traces, optional
+            ::std::chrono::steady_clock::time_point _Enqueued; // stamped if aged or if metrics are on, else zero
+#if MJSYNC_TASK_METRICS
+            ::std::chrono::steady_clock::time_point _Dequeued; // stamped once the task starts
+            ::std::chrono::steady_clock::time_point _Completed; // stamped once the task finishes
+#endif // MJSYNC_TASK_METRICS
+            alignas(task::inline_storage_alignment) unsigned char _Storage[task::inline_storage_size];
+
+            explicit _Queued_task(const uint32_t _Index) noexcept : _Next(nullptr), _Child(nullptr),
+                _State(task_state::none), _Waiters(0), _Refs(0), _Generation(1), _Next_free(0), _Index(_Index),
+                _Priority(task_priority::none), _Callable(nullptr), _Arg(nullptr), _Deleter(nullptr), _Deadline(),
+                _Label(nullptr), _Enqueued() {}
+
+            ~_Queued_task() noexcept {}
+
+            _Queued_task()                               = delete;
+            _Queued_task(const _Queued_task&)            = delete;
+            _Queued_task& operator=(const _Queued_task&) = delete;
+
+            task::id _Get_id() const noexcept {
+                // the upper half holds the generation, the lower half holds the biased slot index
+                return (static_cast<task::id>(_Generation.load(::std::memory_order_relaxed)) << 32)
+                    | (static_cast<task::id>(_Index) + 1);
+            }
+
+            bool _Is_pending() const noexcept {
+                const task_state _Current = _State.load(::std::memory_order_acquire);
+                return _Current == task_state::enqueued || _Current == task_state::running;
+            }
+
+            bool _Claim() noexcept {
+                // only one thread starts the task, either the one that dequeued it or a worker that waits for it
+                task_state _Expected = task_state::enqueued;
+                return _State.compare_exchange_strong(
+                    _Expected, task_state::running, ::std::memory_order_acq_rel, ::std::memory_order_relaxed);
+            }
+
+            void _Execute() noexcept {
+                // the task must have been claimed
+                try {
+                    _Callable(_Arg);
+                    _Complete(task_state::done);
+                } catch (...) {
+                    _Complete(task_state::interrupted);
+                }
+            }
+
+            bool _Cancel_pending() noexcept {
+                // cancel the task if it has not started yet, returns false if it has started or is already done
+                task_state _Expected = task_state::enqueued;
+                if (!_State.compare_exchange_strong(_Expected, task_state::canceled, ::std::memory_order_seq_cst)) {
+                    return false;
+                }
+
+                if (_Waiters.load(::std::memory_order_seq_cst) > 0) { // wake the threads that wait for it
+                    _State.notify_all();
+                }
+
+                return true;
+            }
+
+            void _Wait() noexcept {
+                // Note: The waiter registers itself before checking the state, while the completing thread
+                //       publishes the state before checking for waiters. With sequentially consistent ordering
+                //       at least one side observes the other, so the wake-up cannot be lost. If nobody waits,
+                //       the completion costs no wake-up call at all.
+                _Waiters.fetch_add(1, ::std::memory_order_seq_cst);
+                for (;;) {
+                    const task_state _Current = _State.load(::std::memory_order_seq_cst);
+                    if (_Current != task_state::enqueued && _Current != task_state::running) {
+                        break; // completed or canceled
+                    }
+
+                    _State.wait(_Current, ::std::memory_order_seq_cst);
+                }
+
+                _Waiters.fetch_sub(1, ::std::memory_order_release);
+            }
+
+        private:
+            void _Complete(const task_state _New_state) noexcept {
+                _State.store(_New_state, ::std::memory_order_seq_cst);
+                if (_Waiters.load(::std::memory_order_seq_cst) > 0) { // wake only if someone waits
+                    _State.notify_all();
+                }
+            }
+        };
+
+        class _Task_table { // generational slot table that owns all scheduled tasks
+        public:
+            _Task_table() noexcept : _Mysegments(), _Myunused(0), _Myfree(0), _Mylock() {}
+
+            ~_Task_table() noexcept {
+                for (size_t _Idx = 0; _Idx < _Max_segments; ++_Idx) {
+                    _Queued_task* const _Segment = _Mysegments[_Idx].load(::std::memory_order_relaxed);
+                    if (_Segment) {
+                        ::mjx::delete_object_array(_Segment, _Segment_size(_Idx));
+                    }
+                }
+            }
+
+            _Task_table(const _Task_table&)            = delete;
+            _Task_table& operator=(const _Task_table&) = delete;
+
+            _Queued_task* _Acquire(const task_descriptor& _Desc) {
+                // take a free slot and initialize it, the caller receives both the handle and executor references
+                _Queued_task* const _Task = _Pop_free_slot();
+                _Task->_Next              = nullptr;
+                _Task->_Child             = nullptr;
+                _Task->_State.store(task_state::enqueued, ::std::memory_order_relaxed);
+                _Task->_Waiters.store(0, ::std::memory_order_relaxed);
+                _Task->_Refs.store(2, ::std::memory_order_relaxed);
+                _Task->_Priority = _Desc.priority;
+                _Task->_Callable = _Desc.callable;
+                _Task->_Arg      = _Desc.arg;
+                _Task->_Deleter  = _Desc.deleter;
+                _Task->_Deadline = _Desc.deadline;
+                _Task->_Label    = _Desc.label;
+                _Task->_Enqueued = ::std::chrono::steady_clock::time_point{};
+                if (_Desc.emplace) { // construct the argument in the slot, avoids a separate allocation
+                    try {
+                        _Task->_Arg = _Desc.emplace(_Task->_Storage, _Desc.arg);
+                    } catch (...) {
+                        _Task->_Deleter = nullptr; // nothing has been constructed
+                        _Push_free_slot(_Task);
+                        throw;
+                    }
+                }
+
+                return _Task;
+            }
+
+            void _Release(_Queued_task* const _Task) noexcept {
+                // drop one reference, the last one invalidates all IDs of the slot and recycles it
+                if (_Task->_Refs.fetch_sub(1, ::std::memory_order_acq_rel) != 1) {
+                    return;
+                }
+
+                _Task->_Generation.fetch_add(1, ::std::memory_order_release);
+                _Push_free_slot(_Task);
+            }
+
+            void _Retire(_Queued_task* const _Task) noexcept {
+                // the thread that claimed the task is done with it, release its argument and drop its reference
+                if (_Task->_Deleter) {
+                    _Task->_Deleter(_Task->_Arg);
+                    _Task->_Deleter = nullptr;
+                }
+
+                _Release(_Task);
+            }
+
+            void _Drop_unclaimed(_Queued_task* const _Task) noexcept {
+                // Note: The queue that held the task could not claim it. Either it has been canceled and never runs,
+                //       then its argument is released here, or a waiting worker has claimed it and retires it
+                //       once the callable returns, the argument must stay alive until then.
+                if (_Task->_State.load(::std::memory_order_acquire) == task_state::canceled) {
+                    _Retire(_Task);
+                } else {
+                    _Release(_Task);
+                }
+            }
+
+            _Queued_task* _Find(const task::id _Id) const noexcept {
+                // O(1) lookup, fails if the slot has been recycled since the ID was issued
+                const uint32_t _Biased_index = static_cast<uint32_t>(_Id);
+                if (_Biased_index == 0 || _Biased_index > _Myunused.load(::std::memory_order_acquire)) {
+                    return nullptr;
+                }
+
+                _Queued_task* const _Task = _Slot_at(_Biased_index - 1);
+                if (!_Task || _Task->_Generation.load(::std::memory_order_acquire) != (_Id >> 32)) {
+                    return nullptr;
+                }
+
+                return _Task;
+            }
+
+        private:
+            static constexpr uint32_t _Base_shift  = 10; // the first segment holds 1024 slots
+            static constexpr size_t _Max_segments = 22; // segment N holds 1024 << N slots, about 4G in total
+
+            static constexpr size_t _Segment_size(const size_t _Segment) noexcept {
+                return size_t{1} << (_Segment + _Base_shift);
+            }
+
+            static void _Locate(const uint32_t _Index, size_t& _Segment, size_t& _Offset) noexcept {
+                const uint64_t _Biased = static_cast<uint64_t>(_Index) + (uint64_t{1} << _Base_shift);
+                _Segment               = static_cast<size_t>(::std::bit_width(_Biased)) - 1 - _Base_shift;
+                _Offset                = static_cast<size_t>(_Biased - (uint64_t{1} << (_Segment + _Base_shift)));
+            }
+
+            static constexpr uint64_t _Make_head(const uint64_t _Old_head, const uint32_t _Biased_index) noexcept {
+                // the upper half is a tag that changes with every update, preventing the ABA problem
+                return (((_Old_head >> 32) + 1) << 32) | _Biased_index;
+            }
+
+            _Queued_task* _Slot_at(const uint32_t _Index) const noexcept {
+                size_t _Segment;
+                size_t _Offset;
+                _Locate(_Index, _Segment, _Offset);
+                _Queued_task* const _Base = _Mysegments[_Segment].load(::std::memory_order_acquire);
+                return _Base ? _Base + _Offset : nullptr;
+            }
+
+            void _Push_free_slot(_Queued_task* const _Task) noexcept {
+                _Task->_Callable = nullptr;
+                _Task->_Arg      = nullptr;
+                uint64_t _Head   = _Myfree.load(::std::memory_order_relaxed);
+                uint64_t _New_head;
+                do {
+                    _Task->_Next_free.store(static_cast<uint32_t>(_Head), ::std::memory_order_relaxed);
+                    _New_head = _Make_head(_Head, _Task->_Index + 1);
+                } while (!_Myfree.compare_exchange_weak(
+                    _Head, _New_head, ::std::memory_order_release, ::std::memory_order_relaxed));
+            }
+
+            _Queued_task* _Pop_free_slot() {
+                uint64_t _Head = _Myfree.load(::std::memory_order_acquire);
+                while (static_cast<uint32_t>(_Head) != 0) {
+                    // Note: Slots are never deallocated, so reading the next index of a slot that another thread
+                    //       has just popped is safe. A stale value is rejected by the tagged compare-exchange.
+                    _Queued_task* const _Task = _Slot_at(static_cast<uint32_t>(_Head) - 1);
+                    const uint64_t _New_head  =
+                        _Make_head(_Head, _Task->_Next_free.load(::std::memory_order_relaxed));
+                    if (_Myfree.compare_exchange_weak(
+                        _Head, _New_head, ::std::memory_order_acquire, ::std::memory_order_acquire)) {
+                        return _Task;
+                    }
+                }
+
+                return _Take_unused_slot(); // no free slots, take a fresh one
+            }
+
+            _Queued_task* _Take_unused_slot() {
+                lock_guard _Guard(_Mylock);
+                const uint32_t _Index = _Myunused.load(::std::memory_order_relaxed);
+                size_t _Segment;
+                size_t _Offset;
+                _Locate(_Index, _Segment, _Offset);
+                if (_Segment >= _Max_segments) { // all slots are in use
+                    ::mjx::allocation_limit_exceeded::raise();
+                }
+
+                if (_Offset == 0) { // first slot of a new segment, allocate it
+                    const size_t _Size         = _Segment_size(_Segment);
+                    _Queued_task* const _Slots = ::mjx::allocate_object_array<_Queued_task>(_Size);
+                    for (size_t _Idx = 0; _Idx < _Size; ++_Idx) {
+                        ::new (static_cast<void*>(_Slots + _Idx)) _Queued_task(_Index + static_cast<uint32_t>(_Idx));
+                    }
+
+                    _Mysegments[_Segment].store(_Slots, ::std::memory_order_release);
+                }
+
+                _Myunused.store(_Index + 1, ::std::memory_order_release);
+                return _Mysegments[_Segment].load(::std::memory_order_relaxed) + _Offset;
+            }
+
+            ::std::atomic<_Queued_task*> _Mysegments[_Max_segments];
+            ::std::atomic<uint32_t> _Myunused; // number of slots that have ever been handed out
+            ::std::atomic<uint64_t> _Myfree; // tagged head of the free list (tag | biased slot index)
+            shared_lock _Mylock; // serializes taking unused slots
+        };
+
+        // returns the process-wide task table
+        _Task_table& _Get_task_table() noexcept;
+    } // namespace mjsync_impl
+} // namespace mjx
+
+#endif // _MJSYNC_IMPL_TASK_TABLE_HPP_
\ No newline at end of file
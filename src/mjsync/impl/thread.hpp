@@ -7,10 +7,17 @@
 #ifndef _MJSYNC_IMPL_THREAD_HPP_
 #define _MJSYNC_IMPL_THREAD_HPP_
 #include <atomic>
+#include <bit>
+#include <chrono>
+#include <climits>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <mjmem/object_allocator.hpp>
 #include <mjmem/smart_pointer.hpp>
-#include <mjsync/impl/tinywin.hpp>
+#include <mjsync/impl/platform.hpp>
+#include <mjsync/impl/task_table.hpp>
+#include <mjsync/impl/trace.hpp>
 #include <mjsync/impl/utils.hpp>
 #include <mjsync/srwlock.hpp>
 #include <mjsync/thread.hpp>
@@ -19,78 +26,85 @@
 
 namespace mjx {
     namespace mjsync_impl {
-        class _Queued_task {
-        public:
-            task::id _Id;
-            ::std::atomic<task_state> _State;
-            waitable_event _Completion_event;
-            task_priority _Priority;
-            thread::callable _Callable;
-            void* _Arg;
+        using _Level_mask = unsigned char; // one bit per priority level
+
+        inline constexpr size_t _Level_count = static_cast<size_t>(task_priority::real_time) + 1;
+
+        static_assert(_Level_count <= sizeof(_Level_mask) * CHAR_BIT, "priority levels must fit in the mask");
+
+        constexpr size_t _Level_of(const task_priority _Priority) noexcept {
+            return static_cast<size_t>(_Priority) < _Level_count ? static_cast<size_t>(_Priority) : 0;
+        }
+
+        struct _Task_chain { // singly-linked list of tasks
+            _Queued_task* _Head = nullptr;
+            _Queued_task* _Tail = nullptr;
+        };
 
-            _Queued_task() noexcept : _Id(0), _State(task_state::canceled), _Completion_event(),
-                _Priority(task_priority::idle), _Callable(nullptr), _Arg(nullptr) {}
-        
-            _Queued_task(_Queued_task&& _Other) noexcept {
-                _Steal_data(_Other);
+        inline void _Cancel_task_list(_Queued_task* _List) noexcept {
+            // cancel tasks that will never run and drop the executor's references to them
+            _Task_table& _Table = mjsync_impl::_Get_task_table();
+            for (_Queued_task* _Next; _List != nullptr; _List = _Next) {
+                _Next = _List->_Next;
+                _List->_Cancel_pending();
+                _Table._Drop_unclaimed(_List);
             }
+        }
 
-            _Queued_task(const task::id _Id, const thread::callable _Callable,
-                void* const _Arg, const task_priority _Priority) noexcept
-                : _Id(_Id), _State(task_state::enqueued), _Completion_event(), _Priority(_Priority),
-                _Callable(_Callable), _Arg(_Arg) {}
+        class _Task_batch { // tasks grouped by priority level, spliced into a queue at once
+        public:
+            _Task_batch() noexcept : _Mychains(), _Mymask(0), _Mysize(0) {}
 
-            ~_Queued_task() noexcept {}
+            ~_Task_batch() noexcept {}
 
-            _Queued_task& operator=(_Queued_task&& _Other) noexcept {
-                if (this != &_Other) {
-                    _Steal_data(_Other);
-                }
+            _Task_batch(const _Task_batch&)            = delete;
+            _Task_batch& operator=(const _Task_batch&) = delete;
 
-                return *this;
+            size_t _Size() const noexcept {
+                return _Mysize;
             }
 
-            _Queued_task(const _Queued_task&)            = delete;
-            _Queued_task& operator=(const _Queued_task&) = delete;
+            void _Push(_Queued_task* const _Task) noexcept {
+                const size_t _Level = _Level_of(_Task->_Priority);
+                _Task_chain& _Chain = _Mychains[_Level];
+                if (_Chain._Tail) {
+                    _Chain._Tail->_Next = _Task;
+                } else {
+                    _Chain._Head = _Task;
+                    _Mymask     |= static_cast<_Level_mask>(1u << _Level);
+                }
 
-            bool _Should_execute() const noexcept {
-                return _State.load(::std::memory_order_acquire) == task_state::enqueued;
+                _Chain._Tail = _Task;
+                ++_Mysize;
             }
 
-            void _Execute() noexcept {
-                _Set_state(task_state::running);
-                try {
-                    _Callable(_Arg);
-                    _Set_state(task_state::done);
-                } catch (...) {
-                    _Set_state(task_state::interrupted);
+            void _Cancel_all() noexcept {
+                for (_Task_chain& _Chain : _Mychains) {
+                    if (_Chain._Head) {
+                        _Chain._Tail->_Next = nullptr;
+                        mjsync_impl::_Cancel_task_list(_Chain._Head);
+                        _Chain = _Task_chain{};
+                    }
                 }
 
-                _Completion_event.notify(); // notify regardless of the task result
+                _Mymask = 0;
+                _Mysize = 0;
             }
 
         private:
-            void _Set_state(const task_state _New_state) noexcept {
-                _State.store(_New_state, ::std::memory_order_release);
-            }
-
-            void _Steal_data(_Queued_task& _Other) noexcept {
-                _Id               = _Other._Id;
-                _State            = _Other._State.exchange(task_state::canceled, ::std::memory_order_relaxed);
-                _Completion_event = ::std::move(_Other._Completion_event);
-                _Priority         = _Other._Priority;
-                _Callable         = _Other._Callable;
-                _Arg              = _Other._Arg;
-                _Other._Id        = task::invalid_id;
-                _Other._Priority  = task_priority::idle;
-                _Other._Callable  = nullptr;
-                _Other._Arg       = nullptr;
-            }
+            friend class _Task_queue;
+
+            _Task_chain _Mychains[_Level_count];
+            _Level_mask _Mymask; // bit N is set if the chain N is non-empty
+            size_t _Mysize;
         };
 
-        class _Task_queue { // singly-linked priority queue
+        class _Task_queue { // bucketed priority queue, one intrusive FIFO list per priority level and a deadline heap
         public:
-            _Task_queue() noexcept : _Myhead(nullptr), _Mytail(nullptr), _Mysize(0), _Mylock() {}
+            using _Clock = ::std::chrono::steady_clock;
+
+            _Task_queue() noexcept : _Mybuckets(), _Mymask(0), _Myheap(nullptr), _Myheap_size(0), _Mysize(0),
+                _Mydequeued(0), _Mymode(scheduling_mode::strict_priority), _Myaging(), _Mylock() {}
 
             ~_Task_queue() noexcept {
                 _Clear();
@@ -109,148 +123,460 @@ namespace mjx {
                 return _Mysize;
             }
 
-            void _Clear() noexcept {
+            void _Sample(size_t& _Size, uint64_t& _Dequeued) const noexcept {
+                // reads the size and the number of dequeued tasks at once, the latter tells if the queue progresses
+                shared_lock_guard _Guard(_Mylock);
+                _Size     = _Mysize;
+                _Dequeued = _Mydequeued;
+            }
+
+            thread::scheduling_policy _Policy() const noexcept {
+                shared_lock_guard _Guard(_Mylock);
+                return thread::scheduling_policy{_Mymode.load(::std::memory_order_relaxed),
+                    ::std::chrono::duration_cast<::std::chrono::milliseconds>(_Myaging)};
+            }
+
+            void _Set_policy(const thread::scheduling_policy& _Policy) noexcept {
+                // the deadline heap is drained into the buckets once the earliest-deadline-first mode is left
                 lock_guard _Guard(_Mylock);
-                if (_Myhead) {
-                    for (_Queue_node* _Node = _Myhead, *_Next; _Node != nullptr; _Node = _Next) {
-                        _Next = _Node->_Next;
-                        ::mjx::delete_object(_Node);
+                _Mymode.store(_Policy.mode, ::std::memory_order_relaxed);
+                _Myaging = _Policy.aging_interval;
+                if (_Policy.mode != scheduling_mode::earliest_deadline_first) {
+                    while (_Myheap) {
+                        _Append(_Pop_earliest());
                     }
                 }
             }
 
-            _Queued_task* _Find(const task::id _Id) noexcept {
-                if (!_Myhead) { // empty queue, break
-                    return nullptr;
+            void _Take_all(_Task_batch& _Batch) noexcept {
+                // move all pending tasks to the batch, keeps their priorities and order
+                lock_guard _Guard(_Mylock);
+                for (size_t _Level = 0; _Level < _Level_count; ++_Level) {
+                    _Task_chain& _Entry = _Mybuckets[_Level];
+                    if (_Entry._Head) {
+                        _Batch._Mychains[_Level] = _Entry;
+                        _Entry                   = _Task_chain{};
+                    }
+                }
+
+                _Batch._Mymask = _Mymask;
+                _Batch._Mysize = _Mysize - _Myheap_size;
+                _Mymask        = 0;
+                _Mysize        = 0;
+                while (_Myheap) { // by deadline, a queue in the earliest-deadline-first mode restores the order
+                    _Batch._Push(_Pop_earliest());
                 }
+            }
+
+            void _Clear() noexcept {
+                // cancel all pending tasks and drop the queue's references to them
+                _Queued_task* _List = nullptr;
+                {
+                    lock_guard _Guard(_Mylock);
+                    while (_Myheap) {
+                        _Queued_task* const _Task = _Pop_earliest();
+                        _Task->_Next              = _List;
+                        _List                     = _Task;
+                    }
 
-                for (_Queue_node* _Node = _Myhead; _Node != nullptr; _Node = _Node->_Next) {
-                    if (_Node->_Task._Id == _Id) { // task found
-                        return &_Node->_Task;
+                    for (_Task_chain& _Entry : _Mybuckets) {
+                        if (_Entry._Head) { // move the whole bucket to the local list
+                            _Entry._Tail->_Next = _List;
+                            _List               = _Entry._Head;
+                            _Entry._Head        = nullptr;
+                            _Entry._Tail        = nullptr;
+                        }
                     }
+
+                    _Mymask = 0;
+                    _Mysize = 0;
                 }
 
-                return nullptr; // not found
+                mjsync_impl::_Cancel_task_list(_List);
             }
 
-            void _Enqueue(_Queued_task&& _Task) {
-                _Queue_node* const _New_node = ::mjx::create_object<_Queue_node>(::std::move(_Task));
+            void _Enqueue(_Queued_task* const _Task) noexcept {
+                if (_Needs_stamp()) { // read the clock unlocked
+                    _Stamp(_Task, _Clock::now());
+                }
+
                 lock_guard _Guard(_Mylock);
-                if (!_Myhead) { // insert the first node
-                    _Myhead = _New_node;
-                    _Mytail = _New_node;
-                    _Mysize = 1;
-                } else { // insert the next node
-                    if (_Task._Priority == task_priority::idle) { // always at the end of the queue
-                        _Mytail->_Next = _New_node;
-                        _Mytail        = _New_node;
-                        ++_Mysize;
-                        return;
+                _Insert(_Task);
+                ++_Mysize;
+            }
+
+            void _Enqueue(_Task_batch& _Batch) noexcept {
+                // splice each non-empty chain of the batch, O(levels) under a single lock acquisition,
+                // only the earliest-deadline-first mode must visit the tasks to sort out the ones with a deadline
+                if (_Needs_stamp()) {
+                    const _Clock::time_point _Now = _Clock::now();
+                    for (const _Task_chain& _Chain : _Batch._Mychains) {
+                        for (_Queued_task* _Task = _Chain._Head; _Task; _Task = _Task->_Next) {
+                            _Stamp(_Task, _Now);
+                        }
                     }
+                }
 
-                    if (_Myhead->_Task._Priority < _Task._Priority) { // insert before the head
-                        _New_node->_Next = _Myhead;
-                        _Myhead          = _New_node;
-                    } else { // insert after the head
-                        _Queue_node* _Node = _Myhead->_Next; // skip head, already checked
-                        _Queue_node* _Prev = _Myhead;
-                        while (_Node && _Node->_Task._Priority >= _Task._Priority) {
-                            _Prev = _Node;
-                            _Node = _Node->_Next;
+                lock_guard _Guard(_Mylock);
+                if (_Mymode.load(::std::memory_order_relaxed) == scheduling_mode::earliest_deadline_first) {
+                    for (_Task_chain& _Chain : _Batch._Mychains) {
+                        for (_Queued_task* _Next; _Chain._Head; _Chain._Head = _Next) {
+                            _Next = _Chain._Head->_Next;
+                            _Insert(_Chain._Head);
                         }
 
-                        _Prev->_Next     = _New_node;
-                        _New_node->_Next = _Node;
-                        if (!_Node) { // insert after the tail
-                            _Mytail = _New_node;
+                        _Chain._Tail = nullptr;
+                    }
+                } else {
+                    for (size_t _Level = 0; _Level < _Level_count; ++_Level) {
+                        _Task_chain& _Chain = _Batch._Mychains[_Level];
+                        if (!_Chain._Head) {
+                            continue;
                         }
+
+                        _Task_chain& _Entry = _Mybuckets[_Level];
+                        if (_Entry._Tail) {
+                            _Entry._Tail->_Next = _Chain._Head;
+                        } else {
+                            _Entry._Head = _Chain._Head;
+                        }
+
+                        _Entry._Tail = _Chain._Tail;
+                        _Chain       = _Task_chain{};
                     }
 
-                    ++_Mysize;
+                    _Mymask |= _Batch._Mymask;
                 }
+
+                _Mysize       += _Batch._Mysize;
+                _Batch._Mymask = 0;
+                _Batch._Mysize = 0;
             }
 
-            _Queued_task _Steal() noexcept {
+            _Queued_task* _Steal() noexcept {
+                // unlink the next task, the caller takes over the queue's reference
                 lock_guard _Guard(_Mylock);
-                if (!_Myhead) { // nothing to steal, break
-                    return _Queued_task{};
+                _Queued_task* _Task;
+                if (_Myheap) { // the earliest deadline goes first
+                    _Task = _Pop_earliest();
+                } else if (_Mymask != 0) {
+                    _Task = _Pop_head(_Select_level());
+                } else { // nothing to steal, break
+                    return nullptr;
                 }
 
-                _Queue_node* _Head = _Myhead;
-                _Queued_task _Task = static_cast<_Queued_task&&>(_Head->_Task);
-                _Myhead            = _Head->_Next;
-                ::mjx::delete_object(_Head);
+                _Task->_Next = nullptr;
                 --_Mysize;
+                ++_Mydequeued;
                 return _Task;
             }
 
         private:
-            struct _Queue_node {
-                _Queue_node* _Next = nullptr;
-                _Queued_task _Task;
+            bool _Needs_stamp() const noexcept {
+                // the enqueue time is needed to age the tasks and to measure their queue wait
+                return _Task_metrics_enabled || _Mymode.load(::std::memory_order_relaxed) == scheduling_mode::aging;
+            }
 
-                explicit _Queue_node(_Queued_task&& _Task) noexcept
-                    : _Next(nullptr), _Task(::std::move(_Task)) {}
-            };
+            static void _Stamp(_Queued_task* const _Task, const _Clock::time_point _Now) noexcept {
+                // tasks that are moved between queues keep their original time
+                if (_Task->_Enqueued == _Clock::time_point{}) {
+                    _Task->_Enqueued = _Now;
+                }
+            }
 
-            void _Reset() noexcept {
-                _Myhead = nullptr;
-                _Mytail = nullptr;
-                _Mysize = 0;
+            static _Queued_task* _Meld(_Queued_task* const _First, _Queued_task* const _Second) noexcept {
+                // the root with the later deadline becomes the first child of the other one
+                if (!_First) {
+                    return _Second;
+                } else if (!_Second) {
+                    return _First;
+                }
+
+                _Queued_task* const _Parent = _Second->_Deadline < _First->_Deadline ? _Second : _First;
+                _Queued_task* const _Child  = _Parent == _First ? _Second : _First;
+                _Child->_Next               = _Parent->_Child;
+                _Parent->_Child             = _Child;
+                return _Parent;
             }
 
-            _Queue_node* _Myhead;
-            _Queue_node* _Mytail;
-            size_t _Mysize;
-            mutable shared_lock _Mylock;
-        };
+            static _Queued_task* _Merge_pairs(_Queued_task* _List) noexcept {
+                // meld the siblings in pairs from left to right, then the pairs from right to left
+                _Queued_task* _Pairs = nullptr;
+                while (_List) {
+                    _Queued_task* const _First  = _List;
+                    _Queued_task* const _Second = _First->_Next;
+                    _List                       = _Second ? _Second->_Next : nullptr;
+                    _First->_Next               = nullptr;
+                    if (_Second) {
+                        _Second->_Next = nullptr;
+                    }
 
-        class _Task_counter { // unique task ID generator
-        public:
-            _Task_counter() noexcept : _Myval(1) {}
+                    _Queued_task* const _Pair = _Meld(_First, _Second);
+                    _Pair->_Next              = _Pairs;
+                    _Pairs                    = _Pair;
+                }
 
-            ~_Task_counter() noexcept {}
+                _Queued_task* _Root = nullptr;
+                for (_Queued_task* _Next; _Pairs; _Pairs = _Next) {
+                    _Next         = _Pairs->_Next;
+                    _Pairs->_Next = nullptr;
+                    _Root         = _Meld(_Root, _Pairs);
+                }
 
-            _Task_counter(const _Task_counter&)            = delete;
-            _Task_counter& operator=(const _Task_counter&) = delete;
+                return _Root;
+            }
 
-            task::id _Next_id() noexcept {
-                const task::id _Id = _Myval++;
-                return _Id != task::invalid_id ? _Id : _Myval++; // skip zero, invalid ID
+            void _Insert(_Queued_task* const _Task) noexcept {
+                // Note: In the earliest-deadline-first mode, the tasks with a deadline are kept in a pairing heap,
+                //       which links the tasks through their own fields, so inserting never allocates.
+                //       The heap inserts in O(1) and removes the earliest task in amortized O(log n).
+                if (_Task->_Deadline != _Clock::time_point{}
+                    && _Mymode.load(::std::memory_order_relaxed) == scheduling_mode::earliest_deadline_first) {
+                    _Task->_Next  = nullptr;
+                    _Task->_Child = nullptr;
+                    _Myheap       = _Meld(_Myheap, _Task);
+                    ++_Myheap_size;
+                } else {
+                    _Append(_Task);
+                }
             }
 
-        private:
-            ::std::atomic<task::id> _Myval;
+            void _Append(_Queued_task* const _Task) noexcept {
+                const size_t _Level = _Level_of(_Task->_Priority);
+                _Task_chain& _Entry = _Mybuckets[_Level];
+                _Task->_Next        = nullptr;
+                if (_Entry._Tail) { // append to the non-empty bucket, keeps FIFO order within the level
+                    _Entry._Tail->_Next = _Task;
+                } else { // insert the first task, mark the level as non-empty
+                    _Entry._Head = _Task;
+                    _Mymask     |= static_cast<_Level_mask>(1u << _Level);
+                }
+
+                _Entry._Tail = _Task;
+            }
+
+            _Queued_task* _Pop_earliest() noexcept {
+                _Queued_task* const _Root = _Myheap;
+                _Myheap                   = _Merge_pairs(_Root->_Child);
+                _Root->_Child             = nullptr;
+                --_Myheap_size;
+                return _Root;
+            }
+
+            _Queued_task* _Pop_head(const size_t _Level) noexcept {
+                _Task_chain& _Entry = _Mybuckets[_Level];
+                _Queued_task* _Head = _Entry._Head;
+                _Entry._Head        = _Head->_Next;
+                if (!_Entry._Head) { // bucket drained, mark the level as empty
+                    _Entry._Tail = nullptr;
+                    _Mymask     &= static_cast<_Level_mask>(~(1u << _Level));
+                }
+
+                return _Head;
+            }
+
+            size_t _Select_level() const noexcept {
+                // the most significant set bit marks the non-empty bucket with the highest priority
+                const size_t _Top = static_cast<size_t>(::std::bit_width(_Mymask)) - 1;
+                if (_Mymode.load(::std::memory_order_relaxed) != scheduling_mode::aging
+                    || ::std::has_single_bit(_Mymask) || _Myaging <= _Clock::duration::zero()) {
+                    return _Top;
+                }
+
+                // Note: Each bucket is FIFO, so its head has waited the longest and gained the most levels.
+                //       Comparing the heads is enough, no task is ever moved between the buckets. The gained
+                //       levels are capped below the highest priority, which is never overtaken, and ties go
+                //       to the higher base priority.
+                const _Clock::time_point _Now = _Clock::now();
+                size_t _Best                  = _Top;
+                size_t _Best_rank             = _Top;
+                for (size_t _Level = _Top; _Level-- > 0;) {
+                    const _Queued_task* const _Head = _Mybuckets[_Level]._Head;
+                    if (!_Head || _Head->_Enqueued == _Clock::time_point{}) { // empty or not stamped yet
+                        continue;
+                    }
+
+                    const size_t _Gained = static_cast<size_t>((_Now - _Head->_Enqueued) / _Myaging);
+                    const size_t _Rank   = (::std::min)(_Level + _Gained, _Level_count - 1);
+                    if (_Rank > _Best_rank) {
+                        _Best      = _Level;
+                        _Best_rank = _Rank;
+                    }
+                }
+
+                return _Best;
+            }
+
+            _Task_chain _Mybuckets[_Level_count];
+            _Level_mask _Mymask; // bit N is set if the bucket N is non-empty
+            _Queued_task* _Myheap; // tasks with a deadline, only in the earliest-deadline-first mode
+            size_t _Myheap_size;
+            size_t _Mysize;
+            uint64_t _Mydequeued; // number of tasks that have left the queue to run
+            ::std::atomic<scheduling_mode> _Mymode; // written under the lock, read without it to skip the clock
+            _Clock::duration _Myaging; // waiting time per gained level
+            mutable shared_lock _Mylock;
         };
 
+        class _Steal_group;
+
         class _Thread_cache { // thread's internal cache
         public:
             ::std::atomic<thread_state> _State;
             waitable_event _State_event; // event used for synchronization when state changes
             waitable_event _Termination_event; // event used for synchronization at termination
             _Task_queue _Queue;
-            _Task_counter _Counter;
+            ::std::atomic<_Steal_group*> _Group; // group of threads that may share tasks with this thread
+            uint32_t _Seed; // state of the random victim selection
+            ::std::atomic<uint32_t> _Spin_rounds; // idle polls with a pause backoff before yielding
+            ::std::atomic<uint32_t> _Yield_rounds; // idle polls with a yield before parking
+            ::std::atomic<uint64_t> _Spin_wakeups; // idle periods that ended while spinning
+            ::std::atomic<uint64_t> _Yield_wakeups; // idle periods that ended while yielding
+            ::std::atomic<uint64_t> _Park_wakeups; // idle periods that ended after parking
+            ::std::atomic<uint64_t> _Missed_deadlines; // tasks that finished after their deadline
+            uint32_t _Help_depth; // number of nested waits that run other tasks, used only by the thread itself
+            _Trace_buffer* _Trace; // events of the current trace, used only by the thread itself
+#if MJSYNC_TASK_METRICS
+            _Task_metrics _Metrics; // written only by the thread itself
+#endif // MJSYNC_TASK_METRICS
 
             explicit _Thread_cache(const thread_state _Initial_state) noexcept
-                : _State(_Initial_state), _State_event(), _Termination_event(), _Queue(), _Counter() {}
+                : _State(_Initial_state), _State_event(), _Termination_event(), _Queue(), _Group(nullptr),
+                _Seed(static_cast<uint32_t>(reinterpret_cast<uintptr_t>(this) >> 4) | 1),
+                _Spin_rounds(thread::idle_policy{}.spin_rounds), _Yield_rounds(thread::idle_policy{}.yield_rounds),
+                _Spin_wakeups(0), _Yield_wakeups(0), _Park_wakeups(0), _Missed_deadlines(0), _Help_depth(0),
+                _Trace(nullptr) {}
 
             _Thread_cache()                                = delete;
             _Thread_cache(const _Thread_cache&)            = delete;
             _Thread_cache& operator=(const _Thread_cache&) = delete;
+
+            uint32_t _Next_random() noexcept {
+                // generate the next pseudo-random number (xorshift32), called only by the owning thread
+                _Seed ^= _Seed << 13;
+                _Seed ^= _Seed >> 17;
+                _Seed ^= _Seed << 5;
+                return _Seed;
+            }
+        };
+
+        class _Steal_group { // set of threads that steal pending tasks from each other
+        public:
+            _Steal_group() noexcept : _Mycaches(nullptr), _Mysize(0), _Mycapacity(0),
+                _Myenabled(true), _Mynext(this), _Mylock() {}
+
+            ~_Steal_group() noexcept {
+                ::mjx::delete_object_array(_Mycaches, _Mycapacity);
+            }
+
+            _Steal_group(const _Steal_group&)            = delete;
+            _Steal_group& operator=(const _Steal_group&) = delete;
+
+            bool _Is_enabled() const noexcept {
+                return _Myenabled.load(::std::memory_order_relaxed);
+            }
+
+            void _Enable(const bool _Enabled) noexcept {
+                _Myenabled.store(_Enabled, ::std::memory_order_relaxed);
+            }
+
+            _Steal_group* _Next_group() const noexcept {
+                return _Mynext;
+            }
+
+            void _Link(_Steal_group* const _Next) noexcept {
+                // groups of one pool form a ring, visited once the local group has nothing to steal
+                _Mynext = _Next;
+            }
+
+            void _Reserve(const size_t _New_capacity) {
+                lock_guard _Guard(_Mylock);
+                if (_New_capacity <= _Mycapacity) { // already large enough, do nothing
+                    return;
+                }
+
+                _Thread_cache** const _New_caches = ::mjx::allocate_object_array<_Thread_cache*>(_New_capacity);
+                if (_Mysize > 0) {
+                    ::memcpy(_New_caches, _Mycaches, _Mysize * sizeof(_Thread_cache*));
+                }
+
+                ::mjx::delete_object_array(_Mycaches, _Mycapacity);
+                _Mycaches   = _New_caches;
+                _Mycapacity = _New_capacity;
+            }
+
+            void _Join(_Thread_cache* const _Cache) {
+                _Reserve(_Mysize + 1); // no-op if the capacity has been reserved before
+                lock_guard _Guard(_Mylock);
+                _Mycaches[_Mysize++] = _Cache;
+                _Cache->_Group.store(this, ::std::memory_order_release);
+            }
+
+            void _Leave(_Thread_cache* const _Cache) noexcept {
+                // Note: Leaving requires an exclusive lock, so once this function returns, no thief
+                //       can access the queue of the leaving thread, which can then be safely destroyed.
+                lock_guard _Guard(_Mylock);
+                for (size_t _Idx = 0; _Idx < _Mysize; ++_Idx) {
+                    if (_Mycaches[_Idx] == _Cache) { // replace with the last cache to keep the array dense
+                        _Mycaches[_Idx] = _Mycaches[--_Mysize];
+                        _Cache->_Group.store(nullptr, ::std::memory_order_release);
+                        break;
+                    }
+                }
+            }
+
+            _Queued_task* _Steal(_Thread_cache* const _Thief) noexcept {
+                if (!_Is_enabled()) { // stealing disabled, break
+                    return nullptr;
+                }
+
+                shared_lock_guard _Guard(_Mylock);
+                if (_Mysize == 0) { // no threads to steal from, break
+                    return nullptr;
+                }
+
+                // visit every other thread once, starting with a random victim
+                const size_t _First = static_cast<size_t>(_Thief->_Next_random()) % _Mysize;
+                for (size_t _Off = 0; _Off < _Mysize; ++_Off) {
+                    _Thread_cache* const _Victim = _Mycaches[(_First + _Off) % _Mysize];
+                    if (_Victim == _Thief || _Victim->_Queue._Empty()) {
+                        continue;
+                    }
+
+                    _Queued_task* const _Task = _Victim->_Queue._Steal();
+                    if (_Task) { // stolen successfully
+                        return _Task;
+                    }
+                }
+
+                return nullptr;
+            }
+
+        private:
+            _Thread_cache** _Mycaches;
+            size_t _Mysize;
+            size_t _Mycapacity;
+            ::std::atomic<bool> _Myenabled;
+            _Steal_group* _Mynext; // next group in the ring, the group itself if alone
+            mutable shared_lock _Mylock;
         };
 
+        // cache of the worker thread that runs the calling code, null on other threads
+        inline thread_local _Thread_cache* _Current_worker = nullptr;
+
         class _Thread_impl {
         public:
             void* _Handle;
             thread::id _Id;
             _Thread_cache _Cache;
+            bool _Stopped; // set once the thread has exited
 
-            _Thread_impl() noexcept : _Handle(nullptr), _Id(0), _Cache(thread_state::waiting) {
+            _Thread_impl() noexcept : _Handle(nullptr), _Id(0), _Cache(thread_state::waiting), _Stopped(false) {
                 _Attach();
             }
 
             ~_Thread_impl() noexcept {
-                ::CloseHandle(_Handle);
+                mjsync_impl::_Close_thread(_Handle);
             }
 
             _Thread_impl(const _Thread_impl&)            = delete;
@@ -268,15 +594,104 @@ namespace mjx {
                 return _Cache._State.exchange(_New_state, ::std::memory_order_acq_rel);
             }
 
-            _Queued_task* _Find_task(const task::id _Id) noexcept {
-                return _Cache._Queue._Find(_Id);
+            void _Resume_if_waiting() noexcept {
+                // called after publishing new tasks, pairs with the fence in _Park()
+                ::std::atomic_thread_fence(::std::memory_order_seq_cst);
+                thread_state _Expected = thread_state::waiting;
+                if (_Cache._State.load(::std::memory_order_relaxed) == thread_state::waiting
+                    && _Cache._State.compare_exchange_strong(_Expected, thread_state::working)) {
+                    _Cache._State_event.notify();
+                }
+            }
+
+            void _Stop() noexcept {
+                // request termination and wait until the thread exits, the pending tasks stay in the queue
+                if (_Stopped) { // already stopped, do nothing
+                    return;
+                }
+
+                if (_Exchange_state(thread_state::terminated) == thread_state::waiting) {
+                    _Cache._State_event.notify(); // the thread is waiting, notify it
+                }
+
+                _Cache._Termination_event.wait_and_reset(); // wait until terminated
+                _Stopped = true;
+            }
+
+            static bool _Run_inline(_Queued_task* const _Task) noexcept {
+                // a pool worker runs the awaited task itself if no thread has started it yet, as if it had stolen it,
+                // it holds its own reference and retires the task, the queue that still holds it only drops its one
+                _Thread_cache* const _Cache = _Current_worker;
+                if (!_Cache || !_Cache->_Group.load(::std::memory_order_acquire)) {
+                    return false;
+                }
+
+                _Task_table& _Table = mjsync_impl::_Get_task_table();
+                _Task->_Refs.fetch_add(1, ::std::memory_order_relaxed); // the caller's handle keeps the slot alive
+                if (!_Task->_Claim()) {
+                    _Table._Release(_Task);
+                    return false;
+                }
+
+                _Execute_task(_Cache, _Task);
+                _Table._Retire(_Task);
+                return true;
+            }
+
+            template <class _Pred>
+            static void _Help_until(const _Pred& _Done) noexcept {
+                // Note: A worker that waits for another task runs pending tasks from its own queue or steals them
+                //       meanwhile. The awaited task may be queued behind the waiter, blocking would deadlock then.
+                //       Once there is nothing to run, the worker polls according to its idle policy and returns,
+                //       the caller blocks. Tasks enqueued later remain available to the thieves. Each helped task
+                //       may wait and help again, so the nesting is limited to keep the stack bounded.
+                _Thread_cache* const _Cache = _Current_worker;
+                if (!_Cache || _Cache->_Help_depth >= _Max_help_depth) { // not a worker or nested too deeply
+                    return;
+                }
+
+                ++_Cache->_Help_depth;
+                uint32_t _Idle_rounds = 0;
+                while (!_Done() && _Cache->_State.load(::std::memory_order_acquire) == thread_state::working) {
+                    if (_Run_next_task(_Cache) || _Try_steal_task(_Cache)) {
+                        _Idle_rounds = 0;
+                        continue;
+                    }
+
+                    const uint32_t _Spin_rounds = _Cache->_Spin_rounds.load(::std::memory_order_relaxed);
+                    if (_Idle_rounds < _Spin_rounds) { // spin with an exponential backoff
+                        const uint32_t _Shift = _Idle_rounds < _Max_backoff_shift ? _Idle_rounds : _Max_backoff_shift;
+                        for (uint32_t _Count = uint32_t{1} << _Shift; _Count > 0; --_Count) {
+                            mjsync_impl::_Pause_processor();
+                        }
+                    } else if (_Idle_rounds - _Spin_rounds < _Cache->_Yield_rounds.load(::std::memory_order_relaxed)) {
+                        mjsync_impl::_Yield_thread();
+                    } else { // nothing to run for a while, let the caller block
+                        break;
+                    }
+
+                    ++_Idle_rounds;
+                }
+
+                --_Cache->_Help_depth;
             }
 
         private:
-            static unsigned long __stdcall _Thread_routine(void* const _Data) noexcept {
+            enum class _Idle_phase : unsigned char {
+                _Spin,
+                _Yield,
+                _Park
+            };
+
+            static constexpr uint32_t _Max_backoff_shift = 6; // at most 64 pauses per spin round
+            static constexpr uint32_t _Max_help_depth    = 16; // nested waits that still run other tasks
+
+            static unsigned long _MJSYNC_THREAD_CALL _Thread_routine(void* const _Data) noexcept {
                 _Thread_cache* const _Cache = static_cast<_Thread_cache*>(_Data);
+                _Current_worker             = _Cache;
                 bool _Terminate             = false; // indicates whether termination has been requested
-                bool _Was_idle              = false; // indicates whether the thread was in an idle state
+                uint32_t _Idle_rounds       = 0; // number of consecutive polls that found no task
+                _Idle_phase _Phase          = _Idle_phase::_Spin; // phase of the last idle poll
                 while (!_Terminate) {
                     switch (_Cache->_State.load(::std::memory_order_acquire)) {
                     case thread_state::terminated: // end execution
@@ -286,27 +701,21 @@ namespace mjx {
                         _Cache->_State_event.wait_and_reset();
                         break;
                     case thread_state::working: // perform another task
-                        if (!_Cache->_Queue._Empty()) {
-                            _Queued_task _Task = static_cast<_Queued_task&&>(_Cache->_Queue._Steal());
-                            if (_Task._Should_execute()) {
-                                _Task._Execute();
-                            }
+                        if (_Phase == _Idle_phase::_Park) { // resumed after parking
+                            _Cache->_Park_wakeups.fetch_add(1, ::std::memory_order_relaxed);
+                            _Idle_rounds = 0;
+                            _Phase       = _Idle_phase::_Spin;
+                        }
 
-                            if (_Was_idle) { // got some task, reset the flag
-                                _Was_idle = false;
-                            }
-                        } else { // no more tasks
-                            // Note: The use of atomic operations here necessitates caution in changing the
-                            //       state, especially the first time when the thread has no tasks.
-                            //       Modifying the state in this critical section may result in a race condition,
-                            //       where a termination request is overwritten by the state change to 'waiting'.
-                            //       To prevent this, we use the _Was_idle flag to toggle the state only if the
-                            //       thread was previously in an idle state, avoiding a potential race condition.
-                            if (_Was_idle) {
-                                _Cache->_State.store(thread_state::waiting, ::std::memory_order_release);
+                        if (_Run_next_task(_Cache) || _Try_steal_task(_Cache)) {
+                            if (_Idle_rounds > 0) { // the idle period ended before parking
+                                ::std::atomic<uint64_t>& _Counter = _Phase == _Idle_phase::_Spin
+                                    ? _Cache->_Spin_wakeups : _Cache->_Yield_wakeups;
+                                _Counter.fetch_add(1, ::std::memory_order_relaxed);
+                                _Idle_rounds = 0;
                             }
-
-                            _Was_idle = !_Was_idle; // toggle flag state
+                        } else { // no more tasks, wait according to the idle policy
+                            _Phase = _Wait_idle(_Cache, _Idle_rounds++);
                         }
 
                         break;
@@ -319,87 +728,150 @@ namespace mjx {
                 // Note: The termination request always originates from thread::terminate(), which subsequently
                 //       waits until the thread is fully terminated. It is crucial to notify the termination
                 //       process to prevent an indefinite wait.
+                mjsync_impl::_Get_trace_registry()._Detach(_Cache->_Trace);
                 _Cache->_Termination_event.notify();
                 return 0;
             }
 
-            bool _Attach() noexcept {
-                _Handle = ::CreateThread(nullptr, 0, &_Thread_impl::_Thread_routine,
-                    &_Cache, 0, reinterpret_cast<unsigned long*>(&_Id));
-                if (_Handle) {
-                    return true;
-                } else { // failed to attach a new thread
-                    _Set_state(thread_state::terminated); // mark failure
+            static _Idle_phase _Wait_idle(_Thread_cache* const _Cache, const uint32_t _Round) noexcept {
+                // Note: Parking costs a kernel wait and a full wake-up for the next task, which dominates
+                //       the latency between bursts. Spinning and yielding first keep the thread responsive
+                //       for a bounded time, the policy decides how long.
+                const uint32_t _Spin_rounds = _Cache->_Spin_rounds.load(::std::memory_order_relaxed);
+                if (_Round < _Spin_rounds) { // spin with an exponential backoff
+                    const uint32_t _Shift = _Round < _Max_backoff_shift ? _Round : _Max_backoff_shift;
+                    for (uint32_t _Count = uint32_t{1} << _Shift; _Count > 0; --_Count) {
+                        mjsync_impl::_Pause_processor();
+                    }
+
+                    return _Idle_phase::_Spin;
+                }
+
+                if (_Round - _Spin_rounds < _Cache->_Yield_rounds.load(::std::memory_order_relaxed)) {
+                    mjsync_impl::_Yield_thread(); // give up the rest of the time slice
+                    return _Idle_phase::_Yield;
+                }
+
+                _Park(_Cache);
+                return _Idle_phase::_Park;
+            }
+
+            static void _Park(_Thread_cache* const _Cache) noexcept {
+                // Note: The thread publishes the 'waiting' state before checking its queue for the last time,
+                //       while schedule_task() publishes the task before checking the state. Both sides issue
+                //       a full fence in between, so at least one of them observes the other and no task is left
+                //       behind in the queue of a parked thread. The exchange fails if the state has been changed
+                //       concurrently (e.g. by a termination request), in which case it must be preserved.
+                thread_state _Expected = thread_state::working;
+                if (!_Cache->_State.compare_exchange_strong(_Expected, thread_state::waiting)) {
+                    return;
+                }
+
+                ::std::atomic_thread_fence(::std::memory_order_seq_cst);
+                if (!_Cache->_Queue._Empty()) { // a task has arrived in the meantime, resume immediately
+                    _Expected = thread_state::waiting;
+                    _Cache->_State.compare_exchange_strong(_Expected, thread_state::working);
+                }
+            }
+
+            static bool _Try_steal_task(_Thread_cache* const _Cache) noexcept {
+                // try to steal a pending task from another thread before going idle, the own group goes first
+                _Steal_group* const _Home = _Cache->_Group.load(::std::memory_order_acquire);
+                if (!_Home) { // not a member of any group, break
                     return false;
                 }
+
+                _Steal_group* _Group = _Home;
+                _Queued_task* _Task  = nullptr;
+                do {
+                    _Task  = _Group->_Steal(_Cache);
+                    _Group = _Group->_Next_group();
+                } while (!_Task && _Group != _Home);
+                if (!_Task) { // nothing to steal, break
+                    return false;
+                }
+
+                _Run_task(_Cache, _Task);
+                return true;
             }
-        };
 
-        inline bool _Set_thread_name_preferred(void* const _Handle, const char* const _Name) noexcept {
-            // set the thread name by using SetThreadDescription()
-            using _Fn_t        = long(__stdcall*)(void*, const wchar_t*);
-            static _Fn_t _Func = []() noexcept -> _Fn_t { // load it once
-                const HMODULE _Module = ::GetModuleHandleW(L"Kernel32");
-                if (!_Module) [[unlikely]] { // module not loaded, break
-                    return nullptr;
+            static bool _Run_next_task(_Thread_cache* const _Cache) noexcept {
+                // pop the next task and execute it, the queue is not locked during execution
+                _Queued_task* const _Task = _Cache->_Queue._Steal();
+                if (!_Task) { // nothing to run, break
+                    return false;
                 }
 
-                // Note: The SetThreadDescription() function was introducated in Windows 10, version 1607.
-                //       While it's possible to check the Windows version to determine availibility,
-                //       a more robust approach is to attempt to load the function dynamically from
-                //       the Kernel32.dll library. If the function is present, its signature will be available,
-                //       allowing successful loading. Otherwise, GetProcAddress() will return a null-pointer.
-                return reinterpret_cast<_Fn_t>(::GetProcAddress(_Module, "SetThreadDescription"));
-            }();
-            if (!_Func) { // function not loaded, break
-                return false;
+                _Run_task(_Cache, _Task);
+                return true;
             }
 
-            try {
-                // call within a try-catch block to handle potential allocation failure gracefully
-                const size_t _Size = ::strlen(_Name);
-                auto _Widen        = ::mjx::make_unique_smart_array<wchar_t>(_Size + 1);
-                mjsync_impl::_Narrow_to_widen(_Name, _Name + _Size, _Widen.get());
-                return SUCCEEDED(_Func(_Handle, _Widen.get()));
-            } catch (...) {
-                return false;
+            static void _Run_task(_Thread_cache* const _Cache, _Queued_task* const _Task) noexcept {
+                // skips the tasks that have been canceled or already run by a waiting worker
+                _Task_table& _Table = mjsync_impl::_Get_task_table();
+                if (_Task->_Claim()) {
+                    _Execute_task(_Cache, _Task);
+                    _Table._Retire(_Task);
+                } else {
+                    _Table._Drop_unclaimed(_Task);
+                }
             }
-        }
 
-        struct alignas(8) _Thread_name_info {
-            unsigned long _Type;
-            const char* _Name;
-            unsigned long _Thread_id;
-            unsigned long _Flags;
-        };
+            static void _Trace_task(
+                _Thread_cache* const _Cache, const _Queued_task* const _Task, const _Trace_event _Event) noexcept {
+                // a single relaxed load unless tracing, the buffer is replaced once per trace
+                _Trace_registry& _Registry = mjsync_impl::_Get_trace_registry();
+                if (!_Registry._Is_enabled()) {
+                    return;
+                }
 
-        inline bool _Set_thread_name_fallback(void* const _Handle, const char* const _Name) noexcept {
-            // set the thread name by throwing an exception
-            _Thread_name_info _Info;
-            _Info._Type      = 0x1000; // must be 0x1000
-            _Info._Name      = _Name;
-            _Info._Thread_id = ::GetThreadId(_Handle);
-            _Info._Flags     = 0; // must be zero
-            __try {
-                // communicate with debugger by throwing a specially-configured exception
-                constexpr unsigned long _Code = 0x406D'1388;
-                ::RaiseException(_Code, 0, sizeof(_Thread_name_info) / sizeof(ULONG_PTR),
-                    reinterpret_cast<const ULONG_PTR*>(&_Info));
-                return false;
-            } __except (EXCEPTION_EXECUTE_HANDLER) {
-                return true; // expected behavior, treat it as a success
+                if (!_Cache->_Trace || !_Registry._Is_current(_Cache->_Trace)) {
+                    _Cache->_Trace = _Registry._Attach(_Cache->_Trace, mjsync_impl::_Current_thread_id());
+                    if (!_Cache->_Trace) { // out of memory, skip the event
+                        return;
+                    }
+                }
+
+                _Cache->_Trace->_Append(_Event, _Task->_Get_id(), _Task->_Priority, _Task->_Label, _Trace_time());
             }
-        }
 
-        inline size_t _Hardware_concurrency() noexcept {
-            SYSTEM_INFO _Info = {0};
-            ::GetSystemInfo(&_Info);
-#ifdef _M_X64
-            return static_cast<size_t>(_Info.dwNumberOfProcessors);
-#else // ^^^ _M_X64 ^^^ / vvv _M_IX86 vvv
-            return _Info.dwNumberOfProcessors;
-#endif // _M_X64
-        }
+            static void _Execute_task(_Thread_cache* const _Cache, _Queued_task* const _Task) noexcept {
+                // the clock is read only for the tasks with a deadline, unless metrics are on
+                _Trace_task(_Cache, _Task, _Trace_event::_Begin);
+#if MJSYNC_TASK_METRICS
+                _Task->_Dequeued = _Task_queue::_Clock::now();
+                _Task->_Execute();
+                _Task->_Completed = _Task_queue::_Clock::now();
+                if (_Task->_Enqueued != _Task_queue::_Clock::time_point{}) { // zero if never enqueued
+                    _Cache->_Metrics._Queue_wait._Record(_Task->_Dequeued - _Task->_Enqueued);
+                }
+
+                _Cache->_Metrics._Run_time._Record(_Task->_Completed - _Task->_Dequeued);
+                if (_Task->_Deadline != _Task_queue::_Clock::time_point{}
+                    && _Task->_Completed > _Task->_Deadline) { // finished too late
+                    _Cache->_Missed_deadlines.fetch_add(1, ::std::memory_order_relaxed);
+                }
+#else // ^^^ MJSYNC_TASK_METRICS ^^^ / vvv !MJSYNC_TASK_METRICS vvv
+                _Task->_Execute();
+                if (_Task->_Deadline != _Task_queue::_Clock::time_point{}
+                    && _Task_queue::_Clock::now() > _Task->_Deadline) { // finished too late
+                    _Cache->_Missed_deadlines.fetch_add(1, ::std::memory_order_relaxed);
+                }
+#endif // MJSYNC_TASK_METRICS
+
+                _Trace_task(_Cache, _Task, _Trace_event::_End);
+            }
+
+            bool _Attach() noexcept {
+                if (mjsync_impl::_Create_thread(&_Thread_impl::_Thread_routine, &_Cache, _Handle, _Id)) {
+                    return true;
+                } else { // failed to attach a new thread
+                    _Set_state(thread_state::terminated); // mark failure
+                    _Stopped = true; // there is nothing to wait for
+                    return false;
+                }
+            }
+        };
     } // namespace mjsync_impl
 } // namespace mjx
 
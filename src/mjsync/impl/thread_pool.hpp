@@ -6,81 +6,284 @@
 #pragma once
 #ifndef _MJSYNC_IMPL_THREAD_POOL_HPP_
 #define _MJSYNC_IMPL_THREAD_POOL_HPP_
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <mjmem/object_allocator.hpp>
+#include <mjmem/smart_pointer.hpp>
+#include <mjsync/impl/epoch.hpp>
+#include <mjsync/impl/platform.hpp>
+#include <mjsync/impl/thread.hpp>
+#include <mjsync/impl/timer_wheel.hpp>
 #include <mjsync/impl/utils.hpp>
+#include <mjsync/srwlock.hpp>
 #include <mjsync/thread.hpp>
+#include <mjsync/thread_pool.hpp>
+#include <mjsync/topology.hpp>
+#include <new>
 #include <type_traits>
 
 namespace mjx {
     namespace mjsync_impl {
-        class _Thread_list { // singly-linked thread list
+        class _Scaling_controller { // inspects the thread-pool periodically, on its own thread
         public:
-            _Thread_list() noexcept : _Myhead(nullptr), _Mytail(nullptr), _Mysize(0) {}
+            using _Sample_fn = void(*)(void*, const thread_pool::scaling_policy&);
 
-            explicit _Thread_list(const size_t _Size) : _Myhead(nullptr), _Mytail(nullptr), _Mysize(0) {
-                _Grow(_Size);
+            _Scaling_controller(
+                void* const _Target, const _Sample_fn _Sample, const thread_pool::scaling_policy& _Policy)
+                : _Mytarget(_Target), _Mysample(_Sample), _Mypolicy(_Policy), _Myevent(), _Mystop(false), _Mythread() {
+                _Mythread.set_name("mjsync scaler");
+                _Mythread.schedule_task(&_Service_routine, this); // the state is ready, start sampling
+            }
+
+            ~_Scaling_controller() noexcept {
+                _Mystop.store(true, ::std::memory_order_release);
+                _Myevent.notify();
+                _Mythread.terminate();
+            }
+
+            _Scaling_controller(const _Scaling_controller&)            = delete;
+            _Scaling_controller& operator=(const _Scaling_controller&) = delete;
+
+        private:
+            static void _Service_routine(void* const _Arg) noexcept {
+                static_cast<_Scaling_controller*>(_Arg)->_Service();
+            }
+
+            void _Service() noexcept {
+                const uint32_t _Interval = static_cast<uint32_t>((::std::min)(static_cast<uint64_t>(
+                    _Mypolicy.sample_interval.count()), uint64_t{waitable_event::infinite_timeout - 1}));
+                for (;;) {
+                    _Myevent.wait_and_reset(_Interval);
+                    if (_Mystop.load(::std::memory_order_acquire)) {
+                        break;
+                    }
+
+                    _Mysample(_Mytarget, _Mypolicy);
+                }
+            }
+
+            void* _Mytarget;
+            _Sample_fn _Mysample;
+            const thread_pool::scaling_policy _Mypolicy;
+            waitable_event _Myevent;
+            ::std::atomic<bool> _Mystop;
+            thread _Mythread; // samples the pool, terminated before the other members are destroyed
+        };
+
+        class _Thread_list { // thread list, published as an immutable array
+        public:
+            static constexpr uint32_t _Any_node = 0xFFFF'FFFF;
+
+            _Thread_list(const size_t _Size, const thread_placement _Placement)
+                : _Myarray(::std::addressof(_Myempty)), _Myempty(), _Mysize(0), _Myepoch(), _Mygroups(nullptr),
+                _Mygroup_count(0), _Mypolicy(), _Myscheduling(), _Mymissed(0), _Mytopology(), _Mynode_map(),
+                _Mytimers(nullptr), _Mytimer_lock(), _Mycontroller(), _Mycontroller_lock(), _Mypaused(false),
+                _Myresize_lock() {
+                if (_Placement == thread_placement::numa_aware) {
+                    _Init_topology();
+                }
+
+                _Init_groups();
+                try {
+                    _Grow(_Size);
+                } catch (...) {
+                    _Clear();
+                    ::mjx::delete_object_array(_Mygroups, _Mygroup_count);
+                    throw;
+                }
             }
 
             ~_Thread_list() noexcept {
+                _Disable_scaling(); // stop resizing first
+                ::mjx::delete_object(_Mytimers.load(::std::memory_order_acquire)); // stop firing next
                 _Clear();
+                ::mjx::delete_object_array(_Mygroups, _Mygroup_count);
             }
 
             size_t _Size() const noexcept {
-                return _Mysize;
+                return _Mysize.load(::std::memory_order_relaxed);
             }
 
-            void _Clear() noexcept {
-                if (_Myhead) {
-                    for (_List_node* _Node = _Myhead, *_Next; _Node != nullptr; _Node = _Next) {
-                        _Next = _Node->_Next;
-                        ::mjx::delete_object(_Node);
+            _Epoch_domain& _Epoch() noexcept {
+                // the threads may be used only within a read-side section of this domain
+                return _Myepoch;
+            }
+
+            thread_placement _Placement() const noexcept {
+                return _Mytopology.empty() ? thread_placement::none : thread_placement::numa_aware;
+            }
+
+            bool _Is_stealing_enabled() const noexcept {
+                return _Mygroups[0]._Is_enabled();
+            }
+
+            void _Enable_stealing(const bool _Enabled) noexcept {
+                for (size_t _Idx = 0; _Idx < _Mygroup_count; ++_Idx) {
+                    _Mygroups[_Idx]._Enable(_Enabled);
+                }
+            }
+
+            uint32_t _Current_node() const noexcept {
+                // returns the NUMA node of the calling thread's processor, or _Any_node without placement
+                if (!_Mynode_map) {
+                    return _Any_node;
+                }
+
+                uint16_t _Group;
+                uint8_t _Number;
+                mjsync_impl::_Current_processor(_Group, _Number);
+                const size_t _Idx = static_cast<size_t>(_Group) * _Group_width + _Number;
+                return _Idx < _Mynode_map.size() ? _Mynode_map.get()[_Idx] : _Any_node;
+            }
+
+            thread::idle_policy _Idle_policy() const noexcept {
+                lock_guard _Guard(_Myresize_lock);
+                return _Mypolicy;
+            }
+
+            void _Set_idle_policy(const thread::idle_policy& _Policy) noexcept {
+                // apply the policy to the existing threads, new threads inherit it
+                lock_guard _Guard(_Myresize_lock);
+                _Mypolicy = _Policy;
+                _For_each_thread(
+                    [&_Policy](thread& _Thread) noexcept {
+                        _Thread.set_idle_policy(_Policy);
                     }
+                );
+            }
+
+            thread::scheduling_policy _Scheduling_policy() const noexcept {
+                lock_guard _Guard(_Myresize_lock);
+                return _Myscheduling;
+            }
+
+            void _Set_scheduling_policy(const thread::scheduling_policy& _Policy) noexcept {
+                // apply the policy to the existing threads, new threads inherit it
+                lock_guard _Guard(_Myresize_lock);
+                _Myscheduling = _Policy;
+                _For_each_thread(
+                    [&_Policy](thread& _Thread) noexcept {
+                        (void) _Thread.set_scheduling_policy(_Policy);
+                    }
+                );
+            }
+
+            uint64_t _Retired_missed_deadlines() const noexcept {
+                // deadlines missed by the threads that have been retired
+                return _Mymissed.load(::std::memory_order_relaxed);
+            }
+
+#if MJSYNC_TASK_METRICS
+            void _Retired_task_metrics(latency_histogram& _Queue_wait, latency_histogram& _Run_time) const noexcept {
+                // latencies of the tasks executed by the threads that have been retired
+                shared_lock_guard _Guard(_Mymetrics_lock);
+                _Queue_wait.merge(_Myretired_metrics.queue_wait);
+                _Run_time.merge(_Myretired_metrics.run_time);
+            }
+#endif // MJSYNC_TASK_METRICS
+
+            _Timer_wheel* _Timers() const noexcept {
+                // returns the timer wheel, or null if no timer has been scheduled yet
+                return _Mytimers.load(::std::memory_order_acquire);
+            }
 
-                    _Myhead = nullptr;
-                    _Mytail = nullptr;
-                    _Mysize = 0;
+            _Timer_wheel& _Create_timers() {
+                // the wheel and its thread are created with the first timer
+                _Timer_wheel* _Wheel = _Mytimers.load(::std::memory_order_acquire);
+                if (!_Wheel) {
+                    lock_guard _Guard(_Mytimer_lock);
+                    _Wheel = _Mytimers.load(::std::memory_order_relaxed);
+                    if (!_Wheel) {
+                        _Wheel = ::mjx::create_object<_Timer_wheel>(this, &_Dispatch_timer);
+                        _Mytimers.store(_Wheel, ::std::memory_order_release);
+                    }
                 }
+
+                return *_Wheel;
             }
 
-            void _Grow(size_t _Count) {
-                if (_Count == 0) { // no growth, do nothing
-                    return;
+            bool _Enable_scaling(const thread_pool::scaling_policy& _Policy) {
+                if (_Policy.min_threads == 0 || _Policy.sample_interval.count() <= 0
+                    || (_Policy.max_threads != 0 && _Policy.max_threads < _Policy.min_threads)) { // invalid policy
+                    return false;
                 }
 
-                if (_Mysize == 0) { // allocate the first node
-                    _Myhead = ::mjx::create_object<_List_node>();
-                    _Mytail = _Myhead;
-                    _Mysize = 1;
-                    --_Count; // one already allocated
+                thread_pool::scaling_policy _Resolved = _Policy;
+                if (_Resolved.max_threads == 0) { // as many threads as the hardware supports
+                    _Resolved.max_threads = (::std::max)(mjsync_impl::_Hardware_concurrency(), _Policy.min_threads);
                 }
 
-                while (_Count-- > 0) {
-                    _Mytail->_Next = ::mjx::create_object<_List_node>();
-                    _Mytail        = _Mytail->_Next;
-                    ++_Mysize;
+                _Disable_scaling(); // the old policy must not be applied anymore
+                unique_smart_ptr<_Scaling_controller> _Raced; // set by a concurrent call, joined without the lock
+                {
+                    lock_guard _Guard(_Mycontroller_lock);
+                    _Raced.reset(_Mycontroller.release());
+                    _Mycontroller.reset(::mjx::create_object<_Scaling_controller>(this, &_Scale_routine, _Resolved));
                 }
+
+                return true;
             }
 
-            void _Reduce(size_t _Count) noexcept {
-                _Reduce_waiting_threads(_Count);
-                if (_Count > 0) { // reduced not enough threads, reduce few more
-                    _Mysize -= _Count; // substract once
-                    while (_Count-- > 0) {
-                        _List_node* const _Old_head = _Myhead;
-                        _Myhead                     = _Old_head->_Next;
-                        ::mjx::delete_object(_Old_head);
-                    }
+            void _Disable_scaling() noexcept {
+                // the controller is joined without the lock, it may be retiring a thread whose task calls into the pool
+                unique_smart_ptr<_Scaling_controller> _Old;
+                {
+                    lock_guard _Guard(_Mycontroller_lock);
+                    _Old.reset(_Mycontroller.release());
                 }
             }
 
-            bool _Is_thread_present(const thread::id _Id) const noexcept {
-                if (_Mysize == 0) {
-                    return false;
+            bool _Is_scaling() const noexcept {
+                shared_lock_guard _Guard(_Mycontroller_lock);
+                return static_cast<bool>(_Mycontroller);
+            }
+
+            void _Pause_scaling(const bool _Paused) noexcept {
+                // suspended threads look idle and their queues do not progress, the controller must ignore them
+                _Mypaused.store(_Paused, ::std::memory_order_relaxed);
+            }
+
+            void _Clear() noexcept {
+                _Disable_scaling(); // an empty list must not grow again
+                _Thread_array* _Old;
+                {
+                    lock_guard _Guard(_Myresize_lock);
+                    _Old = _Publish(::std::addressof(_Myempty));
+                }
+
+                for (size_t _Idx = 0; _Idx < _Old->_Size; ++_Idx) { // unlocked, see _Retire_nodes()
+                    _Destroy_node(_Old->_Nodes[_Idx]);
+                }
+
+                _Release_array(_Old);
+            }
+
+            void _Grow(const size_t _Count) {
+                lock_guard _Guard(_Myresize_lock);
+                _Append_nodes(_Count);
+            }
+
+            void _Reduce(const size_t _Count) noexcept {
+                // prefer the waiting threads, the pending tasks of the removed threads are moved elsewhere
+                unique_smart_ptr<_Thread_array> _Retired;
+                {
+                    lock_guard _Guard(_Myresize_lock);
+                    _Retired.reset(_Unpublish(_Count));
                 }
 
-                for (_List_node* _Node = _Myhead; _Node != nullptr; _Node = _Node->_Next) {
-                    if (_Node->_Thread.get_id() == _Id) {
+                if (_Retired) {
+                    _Retire_nodes(_Retired->_Nodes, _Retired->_Size);
+                }
+            }
+
+            bool _Is_thread_present(const thread::id _Id) const noexcept {
+                // the caller must be within a read-side section, the same applies to the functions below
+                const _Thread_array& _Current = *_Myarray.load(::std::memory_order_acquire);
+                for (size_t _Idx = 0; _Idx < _Current._Size; ++_Idx) {
+                    if (_Current._Nodes[_Idx]->_Thread.get_id() == _Id) {
                         return true;
                     }
                 }
@@ -88,13 +291,11 @@ namespace mjx {
                 return false;
             }
 
-            thread* _Select_any_waiting_thread() noexcept {
-                if (_Mysize == 0) {
-                    return nullptr;
-                }
-
-                for (_List_node* _Node = _Myhead; _Node != nullptr; _Node = _Node->_Next) {
-                    if (_Node->_Thread.state() == thread_state::waiting) {
+            thread* _Select_any_waiting_thread(const uint32_t _Numa_node = _Any_node) noexcept {
+                const _Thread_array& _Current = *_Myarray.load(::std::memory_order_acquire);
+                for (size_t _Idx = 0; _Idx < _Current._Size; ++_Idx) {
+                    _List_node* const _Node = _Current._Nodes[_Idx];
+                    if (_Node->_Thread.state() == thread_state::waiting && _Is_on_node(_Node, _Numa_node)) {
                         return ::std::addressof(_Node->_Thread);
                     }
                 }
@@ -102,76 +303,433 @@ namespace mjx {
                 return nullptr;
             }
 
-            thread* _Select_thread_with_fewest_pending_tasks() noexcept {
-                switch (_Mysize) {
+            thread* _Select_thread_with_fewest_pending_tasks(const uint32_t _Numa_node = _Any_node) noexcept {
+                const _Thread_array& _Current = *_Myarray.load(::std::memory_order_acquire);
+                switch (_Current._Size) {
                 case 0: // no threads available, don't select any
                     return nullptr;
                 case 1: // only one thread is available, select it
-                    return ::std::addressof(_Myhead->_Thread);
+                    return ::std::addressof(_Current._Nodes[0]->_Thread);
                 default: // search for the best thread
                     break;
                 }
 
-                thread* _Result = ::std::addressof(_Myhead->_Thread); // first thread by default
-                size_t _Count   = _Result->pending_tasks();
-                for (_List_node* _Node = _Myhead->_Next; _Node != nullptr; _Node = _Node->_Next) {
+                thread* _Result = nullptr;
+                size_t _Count   = 0;
+                for (size_t _Idx = 0; _Idx < _Current._Size; ++_Idx) {
+                    _List_node* const _Node = _Current._Nodes[_Idx];
+                    if (!_Is_on_node(_Node, _Numa_node)) {
+                        continue;
+                    }
+
                     const size_t _Pending_tasks = _Node->_Thread.pending_tasks();
-                    if (_Pending_tasks < _Count) {
+                    if (!_Result || _Pending_tasks < _Count) {
                         _Result = ::std::addressof(_Node->_Thread);
                         _Count  = _Pending_tasks;
                     }
                 }
 
+                if (!_Result) { // no threads on the requested node, select from all threads
+                    return _Select_thread_with_fewest_pending_tasks();
+                }
+
                 return _Result;
             }
 
             template <class _Fn, class... _Types>
-            void _For_each_thread(_Fn&& _Func, _Types&&... _Args) noexcept(
+            size_t _For_each_thread(_Fn&& _Func, _Types&&... _Args) noexcept(
                 noexcept(_Func(::std::declval<thread&>(), ::std::forward<_Types>(_Args)...))) {
-                for (_List_node* _Node = _Myhead; _Node != nullptr; _Node = _Node->_Next) {
-                    // calls _Func(thread&, ...)
-                    (void) _Func(_Node->_Thread, ::std::forward<_Types>(_Args)...);
+                // calls _Func(thread&, ...) for each thread of a single snapshot, returns the number of threads
+                const _Thread_array& _Current = *_Myarray.load(::std::memory_order_acquire);
+                for (size_t _Idx = 0; _Idx < _Current._Size; ++_Idx) {
+                    (void) _Func(_Current._Nodes[_Idx]->_Thread, ::std::forward<_Types>(_Args)...);
                 }
+
+                return _Current._Size;
             }
 
         private:
+            using _Clock = ::std::chrono::steady_clock;
+
             struct _List_node {
-                _List_node* _Next = nullptr;
+                uint32_t _Numa_node = 0; // node the thread is pinned to, always zero without placement
+                uint64_t _Dequeued = 0; // tasks dequeued as of the last sample
+                _Clock::time_point _Progress{}; // the last sample that found the queue empty or progressing
+                _Clock::time_point _Idle_since{}; // the first sample that found the thread idle
+                bool _Idle = false;
                 thread _Thread;
             };
 
-            void _Reduce_waiting_threads(size_t& _Count) noexcept {
-                // Note: We start from the head to ensure that we delete all matching nodes.
-                //       The second step skips the head, as it must store the previous node.
-                //       Neglecting to track the previous node could break the entire connection
-                //       between existing nodes. This method is used exclusively within the _Reduce() method,
-                //       so there's no need to verify the availability of nodes after this step,
-                //       as _Reduce() already performs this check.
-                while (_Myhead && _Myhead->_Thread.state() == thread_state::waiting && _Count > 0) {
-                    _List_node* _Old_head = _Myhead;
-                    _Myhead               = _Old_head->_Next;
-                    ::mjx::delete_object(_Old_head);
-                    --_Count;
-                    --_Mysize;
-                }
-
-                _List_node* _Current = _Myhead; // skips head
-                while (_Current && _Current->_Next && _Count > 0) {
-                    if (_Current->_Next->_Thread.state() == thread_state::waiting) {
-                        _List_node* _Temp = _Current->_Next;
-                        _Current->_Next   = _Current->_Next->_Next; // unlink node
-                        ::mjx::delete_object(_Temp);
-                        --_Count;
-                        --_Mysize;
+            struct _Thread_array { // never modified once published
+                _List_node** _Nodes = nullptr;
+                size_t _Size        = 0;
+                size_t _Capacity    = 0;
+
+                ~_Thread_array() noexcept {
+                    ::mjx::delete_object_array(_Nodes, _Capacity);
+                }
+            };
+
+            static void _Dispatch_timer(void* const _Self, const task_descriptor& _Desc) noexcept {
+                // hands a due timer to a waiting thread, or to the one with the fewest pending tasks
+                _Thread_list* const _List = static_cast<_Thread_list*>(_Self);
+                _Epoch_guard _Guard(_List->_Myepoch);
+                thread* _Thread = _List->_Select_any_waiting_thread();
+                if (!_Thread) {
+                    _Thread = _List->_Select_thread_with_fewest_pending_tasks();
+                }
+
+                if (_Thread) {
+                    try {
+                        (void) _Thread->schedule_task(_Desc);
+                    } catch (...) { // the task table is exhausted, the timer is dropped
+                    }
+                }
+            }
+
+            static void _Scale_routine(void* const _Self, const thread_pool::scaling_policy& _Policy) noexcept {
+                static_cast<_Thread_list*>(_Self)->_Scale(_Policy);
+            }
+
+            static bool _Is_on_node(const _List_node* const _Node, const uint32_t _Numa_node) noexcept {
+                return _Numa_node == _Any_node || _Node->_Numa_node == _Numa_node;
+            }
+
+            void _Init_topology() {
+                // discover the topology and map each processor to its node, used to find the caller's node
+                _Mytopology = processor_topology::query();
+                if (_Mytopology.empty()) { // the topology is not available, fall back to no placement
+                    return;
+                }
+
+                uint16_t _Max_group = 0;
+                for (const processor_info& _Proc : _Mytopology.processors()) {
+                    if (_Proc.group > _Max_group) {
+                        _Max_group = _Proc.group;
+                    }
+                }
+
+                const size_t _Map_size = (static_cast<size_t>(_Max_group) + 1) * _Group_width;
+                _Mynode_map            = ::mjx::make_unique_smart_array<uint32_t>(_Map_size);
+                for (size_t _Idx = 0; _Idx < _Map_size; ++_Idx) {
+                    _Mynode_map.get()[_Idx] = _Any_node;
+                }
+
+                for (const processor_info& _Proc : _Mytopology.processors()) {
+                    _Mynode_map.get()[_Proc.group * _Group_width + _Proc.number] = _Proc.numa_node;
+                }
+            }
+
+            void _Init_groups() {
+                // Note: Each NUMA node has its own steal group and the groups form a ring. An idle thread
+                //       steals from its own node first and visits the remote nodes only if that fails,
+                //       which keeps the tasks and their data on the node they were scheduled to.
+                _Mygroup_count = _Mytopology.empty() ? 1 : _Mytopology.numa_node_count();
+                _Mygroups      = ::mjx::allocate_object_array<_Steal_group>(_Mygroup_count);
+                for (size_t _Idx = 0; _Idx < _Mygroup_count; ++_Idx) {
+                    ::new (static_cast<void*>(_Mygroups + _Idx)) _Steal_group();
+                }
+
+                for (size_t _Idx = 0; _Idx < _Mygroup_count; ++_Idx) {
+                    _Mygroups[_Idx]._Link(_Mygroups + (_Idx + 1) % _Mygroup_count);
+                }
+            }
+
+            const processor_info& _Select_processor(const _Thread_array& _Array) const noexcept {
+                // choose the node with the fewest threads, then spread its threads over the cores first
+                // and use the SMT siblings only once every core of the node has a thread
+                size_t _Min_count = static_cast<size_t>(-1);
+                uint32_t _Target  = 0;
+                for (uint32_t _Numa_node = 0; _Numa_node < _Mygroup_count; ++_Numa_node) {
+                    size_t _Count = 0;
+                    for (size_t _Idx = 0; _Idx < _Array._Size; ++_Idx) {
+                        if (_Array._Nodes[_Idx]->_Numa_node == _Numa_node) {
+                            ++_Count;
+                        }
+                    }
+
+                    if (_Count < _Min_count) {
+                        _Min_count = _Count;
+                        _Target    = _Numa_node;
+                    }
+                }
+
+                const ::std::span<const processor_info> _Procs = _Mytopology.node_processors(_Target);
+                const uint32_t _First_core = _Procs.front().core;
+                const size_t _Cores        = static_cast<size_t>(_Procs.back().core - _First_core) + 1;
+                const size_t _Slot         = _Min_count % _Procs.size();
+                const ::std::span<const processor_info> _Siblings =
+                    _Mytopology.core_processors(_First_core + static_cast<uint32_t>(_Slot % _Cores));
+                return _Siblings[(_Slot / _Cores) % _Siblings.size()];
+            }
+
+            _List_node* _Create_node(const _Thread_array& _Array) {
+                _List_node* const _Node = ::mjx::create_object<_List_node>();
+                _Node->_Thread.set_idle_policy(_Mypolicy);
+                (void) _Node->_Thread.set_scheduling_policy(_Myscheduling);
+                _Node->_Progress = _Clock::now();
+                if (!_Mytopology.empty()) { // pin the thread to a processor of the least populated node
+                    const processor_info& _Proc = _Select_processor(_Array);
+                    _Node->_Numa_node           = _Proc.numa_node;
+                    (void) _Node->_Thread.set_affinity(_Proc);
+                }
+
+                _Mygroups[_Node->_Numa_node]._Join(::std::addressof(_Node->_Thread._Myimpl->_Cache));
+                return _Node;
+            }
+
+            void _Destroy_node(_List_node* const _Node) noexcept {
+                // leave the group first, so that no other thread steals from the destroyed one
+                _Mygroups[_Node->_Numa_node]._Leave(::std::addressof(_Node->_Thread._Myimpl->_Cache));
+                ::mjx::delete_object(_Node);
+            }
+
+            static _Thread_array* _Make_array(const size_t _Capacity) {
+                unique_smart_ptr<_Thread_array> _Array(::mjx::create_object<_Thread_array>());
+                if (_Capacity > 0) {
+                    _Array->_Nodes    = ::mjx::allocate_object_array<_List_node*>(_Capacity);
+                    _Array->_Capacity = _Capacity;
+                }
+
+                return _Array.release();
+            }
+
+            void _Release_array(_Thread_array* const _Array) noexcept {
+                if (_Array != ::std::addressof(_Myempty)) { // the empty array is a member
+                    ::mjx::delete_object(_Array);
+                }
+            }
+
+            _Thread_array* _Publish(_Thread_array* const _New) noexcept {
+                // Note: Readers load the current array within a read-side section and never lock anything.
+                //       Once the new array is published, the old one is returned only after every reader
+                //       that may still use it has left, so the caller may then release it and destroy
+                //       the threads that are no longer referenced. The caller must hold the resize lock.
+                _Thread_array* const _Old = _Myarray.exchange(_New, ::std::memory_order_seq_cst);
+                _Mysize.store(_New->_Size, ::std::memory_order_relaxed);
+                _Myepoch._Synchronize();
+                return _Old;
+            }
+
+            _Thread_array* _Unpublish(const size_t _Count) noexcept {
+                // the caller must hold the resize lock, returns the removed nodes, or null if none are removed
+                const _Thread_array& _Current = *_Myarray.load(::std::memory_order_relaxed);
+                const size_t _Removed = _Current._Size > 0 ? (::std::min)(_Count, _Current._Size - 1) : 0; // keep one
+                if (_Removed == 0) { // nothing to remove
+                    return nullptr;
+                }
+
+                unique_smart_ptr<_Thread_array> _Next;
+                unique_smart_ptr<_Thread_array> _Retired;
+                try {
+                    _Next.reset(_Make_array(_Current._Size - _Removed));
+                    _Retired.reset(_Make_array(_Removed));
+                } catch (...) { // out of memory, keep the threads
+                    return nullptr;
+                }
+
+                size_t _Waiting = 0;
+                for (size_t _Idx = 0; _Idx < _Current._Size; ++_Idx) {
+                    if (_Current._Nodes[_Idx]->_Thread.state() == thread_state::waiting) {
+                        ++_Waiting;
+                    }
+                }
+
+                size_t _Waiting_quota = (::std::min)(_Waiting, _Removed);
+                size_t _Busy_quota    = _Removed - _Waiting_quota;
+                for (size_t _Idx = 0; _Idx < _Current._Size; ++_Idx) { // the states may change, both arrays must fill
+                    _List_node* const _Node = _Current._Nodes[_Idx];
+                    size_t& _Quota = _Node->_Thread.state() == thread_state::waiting ? _Waiting_quota : _Busy_quota;
+                    bool _Remove;
+                    if (_Next->_Size == _Next->_Capacity || _Retired->_Size == _Retired->_Capacity) {
+                        _Remove = _Next->_Size == _Next->_Capacity;
+                    } else if (_Quota > 0) {
+                        _Remove = true;
+                        --_Quota;
                     } else {
-                        _Current = _Current->_Next;
+                        _Remove = false;
+                    }
+
+                    _Thread_array& _Target         = _Remove ? *_Retired : *_Next;
+                    _Target._Nodes[_Target._Size++] = _Node;
+                }
+
+                _Release_array(_Publish(_Next.release()));
+                return _Retired.release();
+            }
+
+            void _Append_nodes(const size_t _Count) {
+                // the caller must hold the resize lock, all new threads are published at once
+                if (_Count == 0) { // no growth, do nothing
+                    return;
+                }
+
+                const _Thread_array& _Current = *_Myarray.load(::std::memory_order_relaxed);
+                for (size_t _Idx = 0; _Idx < _Mygroup_count; ++_Idx) { // joining must not fail after this point
+                    _Mygroups[_Idx]._Reserve(_Current._Size + _Count);
+                }
+
+                unique_smart_ptr<_Thread_array> _Next(_Make_array(_Current._Size + _Count));
+                ::std::copy(_Current._Nodes, _Current._Nodes + _Current._Size, _Next->_Nodes);
+                _Next->_Size = _Current._Size;
+                try {
+                    while (_Next->_Size < _Next->_Capacity) {
+                        _Next->_Nodes[_Next->_Size] = _Create_node(*_Next);
+                        ++_Next->_Size;
                     }
+                } catch (...) {
+                    for (size_t _Idx = _Current._Size; _Idx < _Next->_Size; ++_Idx) { // never published
+                        _Destroy_node(_Next->_Nodes[_Idx]);
+                    }
+
+                    throw;
+                }
+
+                _Release_array(_Publish(_Next.release()));
+            }
+
+            void _Retire_nodes(_List_node* const* const _Nodes, const size_t _Count) noexcept {
+                // Note: The nodes are no longer published, so the pool no longer schedules to them. Once a thread
+                //       leaves its steal group and stops, nobody else touches its queue, which can then be drained.
+                //       A busy thread finishes its current task first, and that task may call into the pool,
+                //       so the threads are stopped without the resize lock. The lock is taken only to move
+                //       the pending tasks to the remaining thread with the fewest pending tasks, preferably
+                //       on the same NUMA node, by then the retired threads run nothing.
+                for (size_t _Idx = 0; _Idx < _Count; ++_Idx) {
+                    _List_node* const _Node   = _Nodes[_Idx];
+                    _Thread_impl* const _Impl = _Node->_Thread._Myimpl.get();
+                    _Mygroups[_Node->_Numa_node]._Leave(::std::addressof(_Impl->_Cache));
+                    _Impl->_Stop();
+                    _Mymissed.fetch_add(_Node->_Thread.missed_deadlines(), ::std::memory_order_relaxed);
+#if MJSYNC_TASK_METRICS
+                    const thread::task_metrics _Metrics = _Node->_Thread.collect_task_metrics();
+                    lock_guard _Guard(_Mymetrics_lock);
+                    _Myretired_metrics.queue_wait.merge(_Metrics.queue_wait);
+                    _Myretired_metrics.run_time.merge(_Metrics.run_time);
+#endif // MJSYNC_TASK_METRICS
                 }
+
+                lock_guard _Guard(_Myresize_lock);
+                for (size_t _Idx = 0; _Idx < _Count; ++_Idx) {
+                    _List_node* const _Node = _Nodes[_Idx];
+                    _Task_batch _Batch;
+                    _Node->_Thread._Myimpl->_Cache._Queue._Take_all(_Batch);
+                    if (_Batch._Size() > 0) {
+                        thread* const _Heir = _Select_thread_with_fewest_pending_tasks(_Node->_Numa_node);
+                        if (_Heir) {
+                            _Heir->_Myimpl->_Cache._Queue._Enqueue(_Batch);
+                            _Heir->_Myimpl->_Resume_if_waiting();
+                        } else { // no thread left, the tasks will never run
+                            _Batch._Cancel_all();
+                        }
+                    }
+
+                    ::mjx::delete_object(_Node);
+                }
+            }
+
+            void _Scale(const thread_pool::scaling_policy& _Policy) noexcept {
+                if (_Mypaused.load(::std::memory_order_relaxed)) {
+                    return;
+                }
+
+                _List_node* _Idle_node;
+                {
+                    lock_guard _Guard(_Myresize_lock); // the array cannot change, reading it needs no read-side section
+                    _Idle_node = _Apply_scaling(_Policy);
+                }
+
+                if (_Idle_node) { // unlocked, see _Retire_nodes()
+                    _Retire_nodes(&_Idle_node, 1);
+                }
+            }
+
+            _List_node* _Apply_scaling(const thread_pool::scaling_policy& _Policy) noexcept {
+                // Note: The age of the pending tasks is not recorded, which would cost a clock read per task.
+                //       Instead, a non-empty queue that has not dequeued anything since the previous samples
+                //       holds a task that has waited at least that long. A thread is idle if it has parked
+                //       with an empty queue. The pool grows at once, but shrinks by one thread per sample.
+                //       The caller must hold the resize lock, the returned node must be retired.
+                const _Thread_array& _Current = *_Myarray.load(::std::memory_order_relaxed);
+                const _Clock::time_point _Now = _Clock::now();
+                size_t _Pending               = 0;
+                size_t _Stalled               = 0;
+                size_t _Idle_idx              = _Current._Size; // the thread that has been idle for the longest time
+                for (size_t _Idx = 0; _Idx < _Current._Size; ++_Idx) {
+                    _List_node* const _Node = _Current._Nodes[_Idx];
+                    size_t _Queued;
+                    uint64_t _Dequeued;
+                    _Node->_Thread._Myimpl->_Cache._Queue._Sample(_Queued, _Dequeued);
+                    _Pending += _Queued;
+                    if (_Queued == 0 || _Dequeued != _Node->_Dequeued) { // the queue is empty or progresses
+                        _Node->_Dequeued = _Dequeued;
+                        _Node->_Progress = _Now;
+                    } else if (_Policy.max_queue_age.count() > 0
+                        && _Now - _Node->_Progress >= _Policy.max_queue_age) { // the oldest task waits too long
+                        ++_Stalled;
+                    }
+
+                    if (_Queued > 0 || _Node->_Thread.state() != thread_state::waiting) { // busy
+                        _Node->_Idle = false;
+                    } else if (!_Node->_Idle) { // idle from now on
+                        _Node->_Idle       = true;
+                        _Node->_Idle_since = _Now;
+                    } else if (_Idle_idx == _Current._Size
+                        || _Node->_Idle_since < _Current._Nodes[_Idle_idx]->_Idle_since) {
+                        _Idle_idx = _Idx;
+                    }
+                }
+
+                const size_t _Count = _Current._Size;
+                size_t _Wanted      = (::std::max)(_Count + _Stalled, _Policy.min_threads);
+                if (_Policy.max_queue_depth > 0 && _Pending > _Policy.max_queue_depth * _Count) { // queues too deep
+                    _Wanted = (::std::max)(_Wanted, (_Pending + _Policy.max_queue_depth - 1) / _Policy.max_queue_depth);
+                }
+
+                _Wanted = (::std::min)(_Wanted, _Policy.max_threads);
+                try {
+                    if (_Wanted > _Count) {
+                        _Append_nodes(_Wanted - _Count);
+                    } else if (_Idle_idx < _Count && _Count > _Policy.min_threads && (_Count > _Policy.max_threads
+                        || _Now - _Current._Nodes[_Idle_idx]->_Idle_since >= _Policy.keep_alive)) {
+                        _List_node* const _Node = _Current._Nodes[_Idle_idx];
+                        unique_smart_ptr<_Thread_array> _Next(_Make_array(_Count - 1));
+                        for (size_t _Idx = 0; _Idx < _Count; ++_Idx) {
+                            if (_Idx != _Idle_idx) {
+                                _Next->_Nodes[_Next->_Size++] = _Current._Nodes[_Idx];
+                            }
+                        }
+
+                        _Release_array(_Publish(_Next.release()));
+                        return _Node;
+                    }
+                } catch (...) { // out of resources, try again with the next sample
+                }
+
+                return nullptr;
             }
 
-            _List_node* _Myhead;
-            _List_node* _Mytail;
-            size_t _Mysize;
+            ::std::atomic<_Thread_array*> _Myarray; // the current snapshot, replaced as a whole when resizing
+            _Thread_array _Myempty; // published while there are no threads
+            ::std::atomic<size_t> _Mysize; // size of the current snapshot
+            _Epoch_domain _Myepoch; // tracks the readers of the snapshots
+            _Steal_group* _Mygroups; // one steal group per NUMA node
+            size_t _Mygroup_count;
+            thread::idle_policy _Mypolicy; // policy of all threads in the list
+            thread::scheduling_policy _Myscheduling; // scheduling policy of all threads in the list
+            ::std::atomic<uint64_t> _Mymissed; // deadlines missed by the retired threads
+#if MJSYNC_TASK_METRICS
+            thread::task_metrics _Myretired_metrics; // latencies recorded by the retired threads
+            mutable shared_lock _Mymetrics_lock;
+#endif // MJSYNC_TASK_METRICS
+            processor_topology _Mytopology; // empty unless the threads are placed
+            unique_smart_array<uint32_t> _Mynode_map; // maps processor numbers to NUMA nodes
+            ::std::atomic<_Timer_wheel*> _Mytimers; // created with the first timer
+            shared_lock _Mytimer_lock; // serializes the creation of the timer wheel
+            unique_smart_ptr<_Scaling_controller> _Mycontroller; // present while auto scaling is enabled
+            mutable shared_lock _Mycontroller_lock; // serializes enabling and disabling auto scaling
+            ::std::atomic<bool> _Mypaused; // set while the threads are suspended
+            mutable shared_lock _Myresize_lock; // serializes adding and removing threads
         };
     } // namespace mjsync_impl
 } // namespace mjx
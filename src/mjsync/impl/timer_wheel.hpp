@@ -0,0 +1,390 @@
+// timer_wheel.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _MJSYNC_IMPL_TIMER_WHEEL_HPP_
+#define _MJSYNC_IMPL_TIMER_WHEEL_HPP_
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mjmem/object_allocator.hpp>
+#include <mjsync/impl/utils.hpp>
+#include <mjsync/srwlock.hpp>
+#include <mjsync/task.hpp>
+#include <mjsync/thread.hpp>
+#include <mjsync/waitable_event.hpp>
+
+namespace mjx {
+    namespace mjsync_impl {
+        struct _Timer_link { // intrusive circular list, each slot has its own sentinel
+            _Timer_link* _Prev;
+            _Timer_link* _Next;
+        };
+
+        struct _Timer_entry : _Timer_link {
+            uint64_t _Deadline; // in ticks since the wheel has been created
+            uint64_t _Period; // in ticks, zero for one-shot timers
+            thread::callable _Callable;
+            void* _Arg;
+            task_priority _Priority;
+            uint8_t _Level; // level of the wheel that holds the entry, or the due or overflow list
+            uint8_t _Slot;
+            uint32_t _Handle; // index in the handle table
+        };
+
+        class _Timer_wheel { // hierarchical timer wheel, serviced by a single thread
+        public:
+            using _Clock       = ::std::chrono::steady_clock;
+            using _Dispatch_fn = void(*)(void*, const task_descriptor&);
+
+            static constexpr uint64_t _Infinite_tick = ~uint64_t{0};
+
+            _Timer_wheel(void* const _Target, const _Dispatch_fn _Dispatch)
+                : _Mytarget(_Target), _Mydispatch(_Dispatch), _Mystart(_Clock::now()), _Mycurrent(0),
+                _Mywake_tick(_Infinite_tick), _Mycount(0), _Mymasks(), _Myslots(), _Mydue(), _Myoverflow(),
+                _Myhandles(nullptr), _Myhandle_count(0), _Myhandle_capacity(0), _Myfree_handle(_No_handle), _Mylock(),
+                _Myevent(), _Mystop(false), _Mythread() {
+                for (size_t _Level = 0; _Level < _Level_count; ++_Level) {
+                    for (_Timer_link& _Slot : _Myslots[_Level]) {
+                        _Slot._Prev = ::std::addressof(_Slot);
+                        _Slot._Next = ::std::addressof(_Slot);
+                    }
+                }
+
+                _Mydue._Prev      = ::std::addressof(_Mydue);
+                _Mydue._Next      = ::std::addressof(_Mydue);
+                _Myoverflow._Prev = ::std::addressof(_Myoverflow);
+                _Myoverflow._Next = ::std::addressof(_Myoverflow);
+                _Mythread.set_name("mjsync timer");
+                _Mythread.schedule_task(&_Service_routine, this); // the state is ready, start servicing
+            }
+
+            ~_Timer_wheel() noexcept {
+                _Mystop.store(true, ::std::memory_order_release);
+                _Myevent.notify();
+                _Mythread.terminate();
+                for (size_t _Idx = 0; _Idx < _Myhandle_count; ++_Idx) {
+                    if (_Myhandles[_Idx]._Entry) { // the timer is still armed
+                        ::mjx::delete_object(_Myhandles[_Idx]._Entry);
+                    }
+                }
+
+                ::mjx::delete_object_array(_Myhandles, _Myhandle_capacity);
+            }
+
+            _Timer_wheel(const _Timer_wheel&)            = delete;
+            _Timer_wheel& operator=(const _Timer_wheel&) = delete;
+
+            uint64_t _Ticks_until(const _Clock::time_point _Time) const noexcept {
+                // rounds up, so that the timer never fires early
+                if (_Time <= _Mystart) {
+                    return 0;
+                }
+
+                return static_cast<uint64_t>(
+                    ::std::chrono::ceil<::std::chrono::milliseconds>(_Time - _Mystart).count());
+            }
+
+            uint64_t _Add(const uint64_t _Deadline, const uint64_t _Period, const thread::callable _Callable,
+                void* const _Arg, const task_priority _Priority) {
+                _Timer_entry* const _Entry = ::mjx::create_object<_Timer_entry>();
+                _Entry->_Deadline          = _Deadline;
+                _Entry->_Period            = _Period;
+                _Entry->_Callable          = _Callable;
+                _Entry->_Arg               = _Arg;
+                _Entry->_Priority          = _Priority;
+                bool _Wake                 = false;
+                uint64_t _Id;
+                {
+                    lock_guard _Guard(_Mylock);
+                    try {
+                        _Id = _Acquire_handle(_Entry);
+                    } catch (...) {
+                        ::mjx::delete_object(_Entry);
+                        throw;
+                    }
+
+                    _Insert(_Entry);
+                    ++_Mycount;
+                    if (_Deadline < _Mywake_tick) { // the timer thread would sleep past the deadline
+                        _Mywake_tick = _Deadline;
+                        _Wake        = true;
+                    }
+                }
+
+                if (_Wake) {
+                    _Myevent.notify();
+                }
+
+                return _Id;
+            }
+
+            bool _Cancel(const uint64_t _Id) noexcept {
+                lock_guard _Guard(_Mylock);
+                const uint32_t _Index = static_cast<uint32_t>(_Id) - 1;
+                if (static_cast<uint32_t>(_Id) == 0 || _Index >= _Myhandle_count) {
+                    return false;
+                }
+
+                _Timer_handle& _Handle = _Myhandles[_Index];
+                if (!_Handle._Entry || _Handle._Generation != static_cast<uint32_t>(_Id >> 32)) { // fired or canceled
+                    return false;
+                }
+
+                _Timer_entry* const _Entry = _Handle._Entry;
+                _Unlink(_Entry);
+                _Release_handle(_Index);
+                ::mjx::delete_object(_Entry);
+                --_Mycount;
+                return true;
+            }
+
+            size_t _Size() const noexcept {
+                lock_guard _Guard(_Mylock);
+                return _Mycount;
+            }
+
+        private:
+            // Note: Each level has 64 slots and every slot of a level covers the whole span of the level below,
+            //       so five levels cover 2^30 ticks, which is about 12 days at one tick per millisecond.
+            //       A timer starts in the highest level in which its deadline differs from the current tick
+            //       and moves to lower levels whenever the current tick reaches the start of its slot.
+            //       Timers beyond the current span wait in the overflow list until the next span begins.
+            static constexpr size_t _Slot_bits       = 6;
+            static constexpr size_t _Slot_count      = size_t{1} << _Slot_bits;
+            static constexpr size_t _Level_count     = 5;
+            static constexpr uint64_t _Span          = uint64_t{1} << (_Slot_bits * _Level_count);
+            static constexpr uint8_t _Due_level      = static_cast<uint8_t>(_Level_count);
+            static constexpr uint8_t _Overflow_level = static_cast<uint8_t>(_Level_count + 1);
+            static constexpr uint32_t _No_handle     = 0xFFFF'FFFF;
+            static constexpr size_t _Batch_size      = 64; // tasks handed to the workers per lock acquisition
+
+            struct _Timer_handle { // maps a timer ID to its entry, the generation invalidates stale IDs
+                _Timer_entry* _Entry;
+                uint32_t _Generation;
+                uint32_t _Next_free;
+            };
+
+            static void _Service_routine(void* const _Arg) noexcept {
+                static_cast<_Timer_wheel*>(_Arg)->_Service();
+            }
+
+            uint64_t _Now() const noexcept {
+                return static_cast<uint64_t>(
+                    ::std::chrono::duration_cast<::std::chrono::milliseconds>(_Clock::now() - _Mystart).count());
+            }
+
+            void _Service() noexcept {
+                task_descriptor _Batch[_Batch_size];
+                while (!_Mystop.load(::std::memory_order_acquire)) {
+                    size_t _Count;
+                    uint32_t _Timeout;
+                    {
+                        lock_guard _Guard(_Mylock);
+                        _Advance(_Now());
+                        _Count = _Collect_due(_Batch);
+                        if (_Count == _Batch_size) { // more timers may be due, do not wait
+                            _Timeout     = 0;
+                            _Mywake_tick = _Mycurrent;
+                        } else {
+                            _Mywake_tick = _Next_event();
+                            _Timeout     = _Mywake_tick == _Infinite_tick ? waitable_event::infinite_timeout
+                                : static_cast<uint32_t>((::std::min)(_Mywake_tick - _Mycurrent,
+                                    uint64_t{waitable_event::infinite_timeout - 1}));
+                        }
+                    }
+
+                    for (size_t _Idx = 0; _Idx < _Count; ++_Idx) { // hand the due tasks to the workers
+                        _Mydispatch(_Mytarget, _Batch[_Idx]);
+                    }
+
+                    if (_Timeout > 0) {
+                        _Myevent.wait_and_reset(_Timeout);
+                    }
+                }
+            }
+
+            uint64_t _Acquire_handle(_Timer_entry* const _Entry) {
+                uint32_t _Index;
+                if (_Myfree_handle != _No_handle) { // reuse a released handle
+                    _Index         = _Myfree_handle;
+                    _Myfree_handle = _Myhandles[_Index]._Next_free;
+                } else {
+                    mjsync_impl::_Reserve_one_more(_Myhandles, _Myhandle_count, _Myhandle_capacity);
+                    _Index             = static_cast<uint32_t>(_Myhandle_count++);
+                    _Myhandles[_Index] = _Timer_handle{nullptr, 0, _No_handle};
+                }
+
+                _Myhandles[_Index]._Entry = _Entry;
+                _Entry->_Handle           = _Index;
+                return (static_cast<uint64_t>(_Myhandles[_Index]._Generation) << 32) | (_Index + 1);
+            }
+
+            void _Release_handle(const uint32_t _Index) noexcept {
+                _Timer_handle& _Handle = _Myhandles[_Index];
+                _Handle._Entry         = nullptr;
+                ++_Handle._Generation;
+                _Handle._Next_free     = _Myfree_handle;
+                _Myfree_handle         = _Index;
+            }
+
+            void _Link(_Timer_link& _List, _Timer_entry* const _Entry) noexcept {
+                _Entry->_Prev      = _List._Prev;
+                _Entry->_Next      = ::std::addressof(_List);
+                _List._Prev->_Next = _Entry;
+                _List._Prev        = _Entry;
+            }
+
+            void _Unlink(_Timer_entry* const _Entry) noexcept {
+                _Entry->_Prev->_Next = _Entry->_Next;
+                _Entry->_Next->_Prev = _Entry->_Prev;
+                if (_Entry->_Level < _Level_count) { // the due and overflow lists have no mask
+                    _Timer_link& _List = _Myslots[_Entry->_Level][_Entry->_Slot];
+                    if (_List._Next == ::std::addressof(_List)) { // the slot became empty
+                        _Mymasks[_Entry->_Level] &= ~(uint64_t{1} << _Entry->_Slot);
+                    }
+                }
+            }
+
+            void _Insert(_Timer_entry* const _Entry) noexcept {
+                if (_Entry->_Deadline <= _Mycurrent) { // already due
+                    _Entry->_Level = _Due_level;
+                    _Link(_Mydue, _Entry);
+                    return;
+                }
+
+                const uint64_t _Diff = _Entry->_Deadline ^ _Mycurrent;
+                if (_Diff >= _Span) { // beyond the current span
+                    _Entry->_Level = _Overflow_level;
+                    _Link(_Myoverflow, _Entry);
+                    return;
+                }
+
+                const size_t _Level = static_cast<size_t>(::std::bit_width(_Diff) - 1) / _Slot_bits;
+                const size_t _Slot  =
+                    static_cast<size_t>(_Entry->_Deadline >> (_Level * _Slot_bits)) & (_Slot_count - 1);
+                _Entry->_Level      = static_cast<uint8_t>(_Level);
+                _Entry->_Slot       = static_cast<uint8_t>(_Slot);
+                _Mymasks[_Level]   |= uint64_t{1} << _Slot;
+                _Link(_Myslots[_Level][_Slot], _Entry);
+            }
+
+            uint64_t _Next_event() const noexcept {
+                // returns the first tick at which the timer thread has something to do
+                return _Mydue._Next != ::std::addressof(_Mydue) ? _Mycurrent : _Next_slot_event();
+            }
+
+            uint64_t _Next_slot_event() const noexcept {
+                // returns the first tick at which a non-empty slot is processed
+                uint64_t _Result = _Infinite_tick;
+                if (_Myoverflow._Next != ::std::addressof(_Myoverflow)) { // the next span begins
+                    _Result = (_Mycurrent | (_Span - 1)) + 1;
+                }
+
+                for (size_t _Level = 0; _Level < _Level_count; ++_Level) {
+                    // only the slots ahead of the current one can be non-empty
+                    const size_t _Shift   = _Level * _Slot_bits;
+                    const size_t _Index   = static_cast<size_t>(_Mycurrent >> _Shift) & (_Slot_count - 1);
+                    const uint64_t _Above =
+                        _Index + 1 < _Slot_count ? _Mymasks[_Level] >> (_Index + 1) << (_Index + 1) : 0;
+                    if (_Above != 0) {
+                        const uint64_t _Base = _Mycurrent >> (_Shift + _Slot_bits) << (_Shift + _Slot_bits);
+                        const uint64_t _Tick = _Base + (static_cast<uint64_t>(::std::countr_zero(_Above)) << _Shift);
+                        if (_Tick < _Result) {
+                            _Result = _Tick;
+                        }
+                    }
+                }
+
+                return _Result;
+            }
+
+            void _Advance(const uint64_t _Tick) noexcept {
+                // jump from event to event, the ticks in between have nothing to process
+                while (_Mycurrent < _Tick) {
+                    const uint64_t _Next = _Next_slot_event(); // the due list must not stop the wheel
+                    if (_Next > _Tick) {
+                        _Mycurrent = _Tick;
+                        break;
+                    }
+
+                    _Mycurrent = _Next;
+                    if ((_Mycurrent & (_Span - 1)) == 0) { // a new span begins
+                        _Reinsert_all(_Myoverflow);
+                    }
+
+                    for (size_t _Level = _Level_count - 1; _Level > 0; --_Level) { // cascade from the top
+                        const size_t _Shift = _Level * _Slot_bits;
+                        if ((_Mycurrent & ((uint64_t{1} << _Shift) - 1)) == 0) { // the slot begins now
+                            _Cascade(_Level, static_cast<size_t>(_Mycurrent >> _Shift) & (_Slot_count - 1));
+                        }
+                    }
+
+                    _Cascade(0, static_cast<size_t>(_Mycurrent) & (_Slot_count - 1));
+                }
+            }
+
+            void _Cascade(const size_t _Level, const size_t _Slot) noexcept {
+                _Mymasks[_Level] &= ~(uint64_t{1} << _Slot);
+                _Reinsert_all(_Myslots[_Level][_Slot]);
+            }
+
+            void _Reinsert_all(_Timer_link& _List) noexcept {
+                // re-insert all timers of the list, relative to the current tick
+                _Timer_link* _Next = _List._Next;
+                _List._Prev        = ::std::addressof(_List);
+                _List._Next        = ::std::addressof(_List);
+                while (_Next != ::std::addressof(_List)) {
+                    _Timer_entry* const _Entry = static_cast<_Timer_entry*>(_Next);
+                    _Next                      = _Next->_Next;
+                    _Insert(_Entry);
+                }
+            }
+
+            size_t _Collect_due(task_descriptor* const _Batch) noexcept {
+                size_t _Count = 0;
+                while (_Count < _Batch_size && _Mydue._Next != ::std::addressof(_Mydue)) {
+                    _Timer_entry* const _Entry = static_cast<_Timer_entry*>(_Mydue._Next);
+                    _Unlink(_Entry);
+                    _Batch[_Count++] = task_descriptor{_Entry->_Callable, _Entry->_Arg, _Entry->_Priority};
+                    if (_Entry->_Period > 0) { // re-arm, skip the periods that have already been missed
+                        const uint64_t _Missed = (_Mycurrent - _Entry->_Deadline) / _Entry->_Period;
+                        _Entry->_Deadline     += (_Missed + 1) * _Entry->_Period;
+                        _Insert(_Entry);
+                    } else {
+                        _Release_handle(_Entry->_Handle);
+                        ::mjx::delete_object(_Entry);
+                        --_Mycount;
+                    }
+                }
+
+                return _Count;
+            }
+
+            void* _Mytarget;
+            _Dispatch_fn _Mydispatch;
+            const _Clock::time_point _Mystart;
+            uint64_t _Mycurrent; // the last processed tick
+            uint64_t _Mywake_tick; // the tick at which the timer thread wakes up
+            size_t _Mycount; // number of armed timers
+            uint64_t _Mymasks[_Level_count]; // bit N is set if the slot N of the level is non-empty
+            _Timer_link _Myslots[_Level_count][_Slot_count];
+            _Timer_link _Mydue; // timers that are due, but have not been handed over yet
+            _Timer_link _Myoverflow; // timers beyond the current span
+            _Timer_handle* _Myhandles;
+            size_t _Myhandle_count;
+            size_t _Myhandle_capacity;
+            uint32_t _Myfree_handle;
+            mutable shared_lock _Mylock;
+            waitable_event _Myevent;
+            ::std::atomic<bool> _Mystop;
+            thread _Mythread; // services the wheel, terminated before the other members are destroyed
+        };
+    } // namespace mjsync_impl
+} // namespace mjx
+
+#endif // _MJSYNC_IMPL_TIMER_WHEEL_HPP_
\ No newline at end of file
@@ -0,0 +1,264 @@
+// topology.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _MJSYNC_IMPL_TOPOLOGY_HPP_
+#define _MJSYNC_IMPL_TOPOLOGY_HPP_
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <mjmem/smart_pointer.hpp>
+#include <mjsync/topology.hpp>
+#ifdef _WIN32
+#include <mjsync/impl/tinywin.hpp>
+#else // ^^^ _WIN32 ^^^ / vvv !_WIN32 vvv
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mjsync/impl/platform.hpp>
+#endif // _WIN32
+
+namespace mjx {
+    namespace mjsync_impl {
+        inline constexpr uint32_t _Unknown_node = 0xFFFF'FFFF;
+
+        inline void _Order_processors(processor_info* const _First, processor_info* const _Last) noexcept {
+            // order by node and core, then replace system node numbers and core indices with dense ones
+            ::std::sort(_First, _Last, [](const processor_info& _Left, const processor_info& _Right) noexcept {
+                if (_Left.numa_node != _Right.numa_node) {
+                    return _Left.numa_node < _Right.numa_node;
+                }
+
+                return _Left.core != _Right.core ? _Left.core < _Right.core : _Left.number < _Right.number;
+            });
+            uint32_t _Node_index = 0;
+            uint32_t _Core_index = 0;
+            uint32_t _Prev_node  = _First->numa_node; // system node number of the previous processor
+            uint32_t _Prev_core  = _First->core; // original core index of the previous processor
+            for (processor_info* _Proc = _First; _Proc != _Last; ++_Proc) {
+                if (_Proc->numa_node != _Prev_node) { // first processor of the next node
+                    ++_Node_index;
+                    ++_Core_index;
+                } else if (_Proc->core != _Prev_core) { // first processor of the next core
+                    ++_Core_index;
+                }
+
+                _Prev_node       = _Proc->numa_node;
+                _Prev_core       = _Proc->core;
+                _Proc->numa_node = _Node_index;
+                _Proc->core      = _Core_index;
+            }
+        }
+
+#ifdef _WIN32
+        inline unique_smart_array<unsigned char> _Query_processor_relations() {
+            // retrieve the information about all processor relationships
+            unsigned long _Bytes = 0;
+            if (::GetLogicalProcessorInformationEx(RelationAll, nullptr, &_Bytes)
+                || ::GetLastError() != ERROR_INSUFFICIENT_BUFFER) {
+                return unique_smart_array<unsigned char>{};
+            }
+
+            unique_smart_array<unsigned char> _Buf = ::mjx::make_unique_smart_array<unsigned char>(_Bytes);
+            if (!::GetLogicalProcessorInformationEx(RelationAll,
+                reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(_Buf.get()), &_Bytes)) {
+                return unique_smart_array<unsigned char>{};
+            }
+
+            return _Buf;
+        }
+
+        template <class _Fn>
+        inline void _For_each_relation(const unique_smart_array<unsigned char>& _Buf,
+            const LOGICAL_PROCESSOR_RELATIONSHIP _Relation, _Fn&& _Func) {
+            // entries have variable sizes, each one stores its own size
+            for (size_t _Off = 0; _Off < _Buf.size();) {
+                const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX* const _Info =
+                    reinterpret_cast<const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(_Buf.get() + _Off);
+                if (_Info->Relationship == _Relation) {
+                    _Func(*_Info);
+                }
+
+                _Off += _Info->Size;
+            }
+        }
+
+        inline unique_smart_array<processor_info> _Discover_processors() {
+            // returns all logical processors, ordered by NUMA node, then by core, with dense indices
+            const unique_smart_array<unsigned char> _Buf = _Query_processor_relations();
+            if (!_Buf) { // the topology is not available
+                return unique_smart_array<processor_info>{};
+            }
+
+            size_t _Count = 0;
+            _For_each_relation(_Buf, RelationProcessorCore,
+                [&_Count](const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX& _Info) noexcept {
+                    for (unsigned short _Idx = 0; _Idx < _Info.Processor.GroupCount; ++_Idx) {
+                        _Count += static_cast<size_t>(::std::popcount(_Info.Processor.GroupMask[_Idx].Mask));
+                    }
+                }
+            );
+            if (_Count == 0) {
+                return unique_smart_array<processor_info>{};
+            }
+
+            unique_smart_array<processor_info> _Procs = ::mjx::make_unique_smart_array<processor_info>(_Count);
+            processor_info* const _First              = _Procs.get();
+            processor_info* const _Last               = _First + _Count;
+            size_t _Size                              = 0;
+            uint32_t _Core                            = 0;
+            _For_each_relation(_Buf, RelationProcessorCore,
+                [&](const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX& _Info) noexcept {
+                    for (unsigned short _Idx = 0; _Idx < _Info.Processor.GroupCount; ++_Idx) {
+                        const GROUP_AFFINITY& _Affinity = _Info.Processor.GroupMask[_Idx];
+                        for (ULONG_PTR _Mask = _Affinity.Mask; _Mask != 0; _Mask &= _Mask - 1) {
+                            _First[_Size++] = processor_info{_Affinity.Group,
+                                static_cast<uint8_t>(::std::countr_zero(_Mask)), _Core, _Unknown_node};
+                        }
+                    }
+
+                    ++_Core;
+                }
+            );
+
+            _For_each_relation(_Buf, RelationNumaNode,
+                [&](const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX& _Info) noexcept {
+                    const GROUP_AFFINITY& _Affinity = _Info.NumaNode.GroupMask;
+                    for (processor_info* _Proc = _First; _Proc != _Last; ++_Proc) {
+                        if (_Proc->group == _Affinity.Group && (_Affinity.Mask >> _Proc->number) & 1) {
+                            _Proc->numa_node = _Info.NumaNode.NodeNumber;
+                        }
+                    }
+                }
+            );
+
+            _Order_processors(_First, _Last);
+            return _Procs;
+        }
+#else // ^^^ _WIN32 ^^^ / vvv !_WIN32 vvv
+        inline bool _Read_sysfs_line(const char* const _Path, char* const _Buf, const size_t _Size) noexcept {
+            // reads the first line of a sysfs file, without the line break
+            FILE* const _File = ::fopen(_Path, "r");
+            if (!_File) {
+                return false;
+            }
+
+            const bool _Read = ::fgets(_Buf, static_cast<int>(_Size), _File) != nullptr;
+            ::fclose(_File);
+            if (!_Read) {
+                return false;
+            }
+
+            _Buf[::strcspn(_Buf, "\n")] = '\0';
+            return true;
+        }
+
+        inline bool _Read_sysfs_value(const char* const _Path, uint32_t& _Value) noexcept {
+            char _Buf[32];
+            if (!_Read_sysfs_line(_Path, _Buf, sizeof(_Buf))) {
+                return false;
+            }
+
+            char* _End;
+            const unsigned long _Parsed = ::strtoul(_Buf, &_End, 10);
+            if (_End == _Buf) {
+                return false;
+            }
+
+            _Value = static_cast<uint32_t>(_Parsed);
+            return true;
+        }
+
+        template <class _Fn>
+        inline bool _For_each_listed_index(const char* const _Path, _Fn&& _Func) {
+            // the file holds a list of ranges, such as "0-3,8,10-11"
+            char _Buf[4096];
+            if (!_Read_sysfs_line(_Path, _Buf, sizeof(_Buf))) {
+                return false;
+            }
+
+            for (const char* _Pos = _Buf; *_Pos != '\0';) {
+                char* _End;
+                const unsigned long _First = ::strtoul(_Pos, &_End, 10);
+                if (_End == _Pos) { // malformed list, break
+                    return false;
+                }
+
+                unsigned long _Last = _First;
+                _Pos                = _End;
+                if (*_Pos == '-') {
+                    _Last = ::strtoul(_Pos + 1, &_End, 10);
+                    _Pos  = _End;
+                }
+
+                for (unsigned long _Idx = _First; _Idx <= _Last; ++_Idx) {
+                    _Func(static_cast<uint32_t>(_Idx));
+                }
+
+                if (*_Pos == ',') {
+                    ++_Pos;
+                }
+            }
+
+            return true;
+        }
+
+        inline unique_smart_array<processor_info> _Discover_processors() {
+            // Note: Linux numbers its processors contiguously, they are split into groups of _Group_width
+            //       to match processor_info. The cores are told apart by the package and the core ID,
+            //       the core IDs repeat across packages.
+            const char* const _Online = "/sys/devices/system/cpu/online";
+            size_t _Count             = 0;
+            if (!_For_each_listed_index(_Online, [&_Count](uint32_t) noexcept { ++_Count; }) || _Count == 0) {
+                return unique_smart_array<processor_info>{};
+            }
+
+            unique_smart_array<processor_info> _Procs = ::mjx::make_unique_smart_array<processor_info>(_Count);
+            processor_info* const _First              = _Procs.get();
+            processor_info* const _Last               = _First + _Count;
+            size_t _Size                              = 0;
+            _For_each_listed_index(_Online, [&](const uint32_t _Cpu) noexcept {
+                if (_Size == _Count) { // the list changed in the meantime
+                    return;
+                }
+
+                char _Path[128];
+                uint32_t _Package = 0;
+                uint32_t _Core_id = _Cpu; // without the topology, every processor is its own core
+                ::snprintf(_Path, sizeof(_Path), "/sys/devices/system/cpu/cpu%u/topology/physical_package_id", _Cpu);
+                _Read_sysfs_value(_Path, _Package);
+                ::snprintf(_Path, sizeof(_Path), "/sys/devices/system/cpu/cpu%u/topology/core_id", _Cpu);
+                _Read_sysfs_value(_Path, _Core_id);
+                _First[_Size++] = processor_info{static_cast<uint16_t>(_Cpu / _Group_width),
+                    static_cast<uint8_t>(_Cpu % _Group_width), (_Package << 16) | (_Core_id & 0xFFFF), _Unknown_node};
+            });
+            if (_Size != _Count) {
+                return unique_smart_array<processor_info>{};
+            }
+
+            _For_each_listed_index("/sys/devices/system/node/online", [&](const uint32_t _Node) {
+                char _Path[128];
+                ::snprintf(_Path, sizeof(_Path), "/sys/devices/system/node/node%u/cpulist", _Node);
+                _For_each_listed_index(_Path, [&](const uint32_t _Cpu) noexcept {
+                    const uint16_t _Group = static_cast<uint16_t>(_Cpu / _Group_width);
+                    const uint8_t _Number = static_cast<uint8_t>(_Cpu % _Group_width);
+                    for (processor_info* _Proc = _First; _Proc != _Last; ++_Proc) {
+                        if (_Proc->group == _Group && _Proc->number == _Number) {
+                            _Proc->numa_node = _Node;
+                            break;
+                        }
+                    }
+                });
+            });
+
+            _Order_processors(_First, _Last);
+            return _Procs;
+        }
+#endif // _WIN32
+    } // namespace mjsync_impl
+} // namespace mjx
+
+#endif // _MJSYNC_IMPL_TOPOLOGY_HPP_
\ No newline at end of file
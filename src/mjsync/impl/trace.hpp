@@ -0,0 +1,238 @@
+// trace.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _MJSYNC_IMPL_TRACE_HPP_
+#define _MJSYNC_IMPL_TRACE_HPP_
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mjmem/object_allocator.hpp>
+#include <mjmem/smart_pointer.hpp>
+#include <mjsync/srwlock.hpp>
+#include <mjsync/task.hpp>
+#include <mjsync/trace.hpp>
+#include <new>
+
+namespace mjx {
+    namespace mjsync_impl {
+        inline uint64_t _Trace_time() noexcept {
+            return static_cast<uint64_t>(::std::chrono::duration_cast<::std::chrono::nanoseconds>(
+                ::std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+        enum class _Trace_event : unsigned char {
+            _Begin,
+            _End
+        };
+
+        struct _Trace_record { // single event, the fields are atomic so that a concurrent flush is well-defined
+            ::std::atomic<uint64_t> _Time; // steady clock, in nanoseconds
+            ::std::atomic<task::id> _Task;
+            ::std::atomic<const char*> _Label; // null if the task has no label
+            ::std::atomic<uint32_t> _Info; // priority in the low byte, event in the next one
+
+            _Trace_record() noexcept : _Time(0), _Task(task::invalid_id), _Label(nullptr), _Info(0) {}
+        };
+
+        struct _Trace_snapshot { // copy of a record, taken by the flushing thread
+            uint64_t _Time;
+            task::id _Task;
+            const char* _Label;
+            task_priority _Priority;
+            _Trace_event _Event;
+        };
+
+        class _Trace_buffer { // ring of events, written by a single thread and flushed by any thread
+        public:
+            _Trace_buffer* _Next; // next buffer in the registry, guarded by the registry's lock
+            const unsigned long _Thread; // ID of the writing thread
+            const uint32_t _Session; // trace the buffer belongs to
+            bool _Detached; // set once the writing thread no longer uses the buffer, guarded by the registry's lock
+
+            _Trace_buffer(const size_t _Capacity, const unsigned long _Thread, const uint32_t _Session)
+                : _Next(nullptr), _Thread(_Thread), _Session(_Session), _Detached(false),
+                _Myrecords(::mjx::make_unique_smart_array<_Trace_record>(_Capacity)), _Mymask(_Capacity - 1),
+                _Myhead(0) {
+                for (size_t _Idx = 0; _Idx < _Capacity; ++_Idx) { // the storage is raw
+                    ::new (static_cast<void*>(_Myrecords.get() + _Idx)) _Trace_record();
+                }
+            }
+
+            ~_Trace_buffer() noexcept {}
+
+            _Trace_buffer(const _Trace_buffer&)            = delete;
+            _Trace_buffer& operator=(const _Trace_buffer&) = delete;
+
+            void _Append(const _Trace_event _Event, const task::id _Task, const task_priority _Priority,
+                const char* const _Label, const uint64_t _Time) noexcept {
+                // Note: The writer owns the head, so it publishes each record with a plain release store and never
+                //       takes a lock. Once the ring is full, the oldest records are overwritten.
+                const uint64_t _Pos    = _Myhead.load(::std::memory_order_relaxed);
+                _Trace_record& _Record = _Myrecords.get()[static_cast<size_t>(_Pos & _Mymask)];
+                _Record._Time.store(_Time, ::std::memory_order_relaxed);
+                _Record._Task.store(_Task, ::std::memory_order_relaxed);
+                _Record._Label.store(_Label, ::std::memory_order_relaxed);
+                _Record._Info.store(static_cast<uint32_t>(_Priority) | (static_cast<uint32_t>(_Event) << 8),
+                    ::std::memory_order_relaxed);
+                _Myhead.store(_Pos + 1, ::std::memory_order_release);
+            }
+
+            template <class _Fn>
+            void _Visit(_Fn&& _Func) const {
+                // copies the live records first, then drops the ones that the writer may have overwritten meanwhile
+                const size_t _Capacity = _Mymask + 1;
+                const uint64_t _Head   = _Myhead.load(::std::memory_order_acquire);
+                const uint64_t _First  = _Head > _Capacity ? _Head - _Capacity : 0;
+                const size_t _Count    = static_cast<size_t>(_Head - _First);
+                if (_Count == 0) {
+                    return;
+                }
+
+                unique_smart_array<_Trace_snapshot> _Copies = ::mjx::make_unique_smart_array<_Trace_snapshot>(_Count);
+                for (size_t _Idx = 0; _Idx < _Count; ++_Idx) {
+                    const _Trace_record& _Record = _Myrecords.get()[static_cast<size_t>((_First + _Idx) & _Mymask)];
+                    const uint32_t _Info         = _Record._Info.load(::std::memory_order_relaxed);
+                    _Copies.get()[_Idx]          = _Trace_snapshot{_Record._Time.load(::std::memory_order_relaxed),
+                        _Record._Task.load(::std::memory_order_relaxed),
+                        _Record._Label.load(::std::memory_order_relaxed), static_cast<task_priority>(_Info & 0xFF),
+                        static_cast<_Trace_event>((_Info >> 8) & 0xFF)};
+                }
+
+                ::std::atomic_thread_fence(::std::memory_order_acquire);
+                const uint64_t _Now   = _Myhead.load(::std::memory_order_relaxed);
+                const uint64_t _Valid = _Now > _Capacity ? _Now - _Capacity : 0; // older records may be torn
+                for (size_t _Idx = 0; _Idx < _Count; ++_Idx) {
+                    if (_First + _Idx >= _Valid) {
+                        _Func(_Copies.get()[_Idx]);
+                    }
+                }
+            }
+
+        private:
+            unique_smart_array<_Trace_record> _Myrecords;
+            const size_t _Mymask;
+            ::std::atomic<uint64_t> _Myhead; // number of records ever appended
+        };
+
+        class _Trace_registry { // buffers of all threads that have recorded events
+        public:
+            _Trace_registry() noexcept : _Myenabled(false), _Mysession(0), _Mycapacity(0), _Myorigin(0),
+                _Mybuffers(nullptr), _Mylock() {}
+
+            ~_Trace_registry() noexcept {
+                // Note: The registry is destroyed at process exit, after the threads that used the buffers.
+                for (_Trace_buffer* _Next; _Mybuffers; _Mybuffers = _Next) {
+                    _Next = _Mybuffers->_Next;
+                    ::mjx::delete_object(_Mybuffers);
+                }
+            }
+
+            _Trace_registry(const _Trace_registry&)            = delete;
+            _Trace_registry& operator=(const _Trace_registry&) = delete;
+
+            bool _Is_enabled() const noexcept {
+                return _Myenabled.load(::std::memory_order_relaxed);
+            }
+
+            uint64_t _Origin() const noexcept {
+                shared_lock_guard _Guard(_Mylock);
+                return _Myorigin;
+            }
+
+            bool _Is_current(const _Trace_buffer* const _Buffer) const noexcept {
+                return _Buffer->_Session == _Mysession.load(::std::memory_order_relaxed);
+            }
+
+            void _Start(const size_t _Capacity) noexcept {
+                // the buffers of the previous trace are released by their threads once they notice the new one
+                lock_guard _Guard(_Mylock);
+                _Mycapacity = ::std::bit_ceil(_Capacity);
+                _Myorigin   = _Trace_time();
+                _Mysession.fetch_add(1, ::std::memory_order_relaxed);
+                _Release_detached();
+                _Myenabled.store(true, ::std::memory_order_relaxed);
+            }
+
+            void _Stop() noexcept {
+                _Myenabled.store(false, ::std::memory_order_relaxed);
+            }
+
+            _Trace_buffer* _Attach(_Trace_buffer* const _Old, const unsigned long _Thread) noexcept {
+                // replaces the thread's buffer of a previous trace, null if out of memory
+                _Detach(_Old);
+                size_t _Capacity;
+                uint32_t _Session;
+                {
+                    shared_lock_guard _Guard(_Mylock);
+                    _Capacity = _Mycapacity;
+                    _Session  = _Mysession.load(::std::memory_order_relaxed);
+                }
+
+                _Trace_buffer* _Buffer;
+                try {
+                    _Buffer = ::mjx::create_object<_Trace_buffer>(_Capacity, _Thread, _Session);
+                } catch (...) {
+                    return nullptr;
+                }
+
+                lock_guard _Guard(_Mylock);
+                _Buffer->_Next = _Mybuffers;
+                _Mybuffers     = _Buffer;
+                return _Buffer;
+            }
+
+            void _Detach(_Trace_buffer* const _Buffer) noexcept {
+                // the events of the current trace are kept until the next one starts
+                if (_Buffer) {
+                    lock_guard _Guard(_Mylock);
+                    _Buffer->_Detached = true;
+                    _Release_detached();
+                }
+            }
+
+            template <class _Fn>
+            void _For_each_buffer(_Fn&& _Func) const {
+                shared_lock_guard _Guard(_Mylock);
+                const uint32_t _Session = _Mysession.load(::std::memory_order_relaxed);
+                for (const _Trace_buffer* _Buffer = _Mybuffers; _Buffer; _Buffer = _Buffer->_Next) {
+                    if (_Buffer->_Session == _Session) {
+                        _Func(*_Buffer);
+                    }
+                }
+            }
+
+        private:
+            void _Release_detached() noexcept {
+                // frees the buffers that are no longer written and no longer part of the current trace
+                const uint32_t _Session = _Mysession.load(::std::memory_order_relaxed);
+                _Trace_buffer** _Link   = &_Mybuffers;
+                while (*_Link) {
+                    _Trace_buffer* const _Buffer = *_Link;
+                    if (_Buffer->_Detached && _Buffer->_Session != _Session) {
+                        *_Link = _Buffer->_Next;
+                        ::mjx::delete_object(_Buffer);
+                    } else {
+                        _Link = &_Buffer->_Next;
+                    }
+                }
+            }
+
+            ::std::atomic<bool> _Myenabled;
+            ::std::atomic<uint32_t> _Mysession; // written under the lock, read without it by the recording threads
+            size_t _Mycapacity; // records per buffer, a power of two
+            uint64_t _Myorigin; // start of the current trace
+            _Trace_buffer* _Mybuffers;
+            mutable shared_lock _Mylock;
+        };
+
+        // returns the process-wide trace registry
+        _Trace_registry& _Get_trace_registry() noexcept;
+    } // namespace mjsync_impl
+} // namespace mjx
+
+#endif // _MJSYNC_IMPL_TRACE_HPP_
\ No newline at end of file
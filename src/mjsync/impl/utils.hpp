@@ -6,20 +6,29 @@
 #pragma once
 #ifndef _MJSYNC_IMPL_UTILS_HPP_
 #define _MJSYNC_IMPL_UTILS_HPP_
-#include <crtdbg.h>
+#include <algorithm>
+#include <cstddef>
 #include <cstdlib>
+#include <mjmem/object_allocator.hpp>
 #include <new>
+#ifdef _WIN32
+#include <crtdbg.h>
 
 // generic assert macro, useful in debug mode
 #define _INTERNAL_ASSERT(_Cond, _Msg)                                   \
     if (!(_Cond)) {                                                     \
         ::_CrtDbgReport(_CRT_ERROR, __FILE__, __LINE__, nullptr, _Msg); \
     }
+#endif // _WIN32
 
 namespace mjx {
     namespace mjsync_impl {
         [[noreturn]] inline void _Unreachable() noexcept {
+#ifdef _WIN32
             __assume(false);
+#else // ^^^ _WIN32 ^^^ / vvv !_WIN32 vvv
+            __builtin_unreachable();
+#endif // _WIN32
 #ifdef _DEBUG
             ::abort();
 #endif // _DEBUG
@@ -32,6 +41,21 @@ namespace mjx {
 
             *_Dest = L'\0'; // end with null-terminator
         }
+
+        template <class _Ty>
+        inline void _Reserve_one_more(_Ty*& _Array, const size_t _Size, size_t& _Capacity) {
+            // grows the array geometrically, so that appending is amortized constant
+            if (_Size < _Capacity) {
+                return;
+            }
+
+            const size_t _New_capacity = _Capacity > 0 ? _Capacity * 2 : 4;
+            _Ty* const _New_array      = ::mjx::allocate_object_array<_Ty>(_New_capacity);
+            ::std::copy(_Array, _Array + _Size, _New_array);
+            ::mjx::delete_object_array(_Array, _Capacity);
+            _Array    = _New_array;
+            _Capacity = _New_capacity;
+        }
     } // namespace mjsync_impl
 } // namespace mjx
 
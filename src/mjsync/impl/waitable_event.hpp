@@ -6,10 +6,19 @@
 #pragma once
 #ifndef _MJSYNC_IMPL_WAITABLE_EVENT_HPP_
 #define _MJSYNC_IMPL_WAITABLE_EVENT_HPP_
-#include <mjsync/impl/tinywin.hpp>
+#include <cstdint>
+#include <mjsync/impl/platform.hpp>
+#include <mjsync/waitable_event.hpp>
+#ifndef _WIN32
+#include <atomic>
+#include <climits>
+#include <ctime>
+#include <mjmem/object_allocator.hpp>
+#endif // _WIN32
 
 namespace mjx {
     namespace mjsync_impl {
+#ifdef _WIN32
         inline void* _Create_anonymous_waitable_event() noexcept {
             return ::CreateEventW(nullptr, true, false, nullptr);
         }
@@ -24,6 +33,116 @@ namespace mjx {
                 return nullptr;
             }
         }
+
+        inline void _Close_waitable_event(void* const _Handle) noexcept {
+            ::CloseHandle(_Handle);
+        }
+
+        inline bool _Wait_for_waitable_event(void* const _Handle, const uint32_t _Timeout) noexcept {
+            return ::WaitForSingleObject(_Handle, _Timeout) == WAIT_OBJECT_0;
+        }
+
+        inline void _Set_waitable_event(void* const _Handle) noexcept {
+            ::SetEvent(_Handle);
+        }
+
+        inline void _Reset_waitable_event(void* const _Handle) noexcept {
+            ::ResetEvent(_Handle);
+        }
+#else // ^^^ _WIN32 ^^^ / vvv !_WIN32 vvv
+        struct _Futex_event { // manual-reset event, the handle points to it
+            static constexpr uint32_t _Unset   = 0;
+            static constexpr uint32_t _Set     = 1;
+            static constexpr uint32_t _Waiting = 2; // unset, at least one thread sleeps on it
+
+            ::std::atomic<uint32_t> _State{_Unset};
+        };
+
+        static_assert(sizeof(_Futex_event) == sizeof(uint32_t), "the futex must be the whole event");
+
+        inline _Futex_event* _As_futex_event(void* const _Handle) noexcept {
+            return static_cast<_Futex_event*>(_Handle);
+        }
+
+        inline void* _Create_anonymous_waitable_event() noexcept {
+            try {
+                return ::mjx::create_object<_Futex_event>();
+            } catch (...) {
+                return nullptr;
+            }
+        }
+
+        inline void* _Create_or_open_named_waitable_event(const wchar_t*) noexcept {
+            return nullptr; // Linux has no named events, the event is left invalid
+        }
+
+        inline void _Close_waitable_event(void* const _Handle) noexcept {
+            ::mjx::delete_object(_As_futex_event(_Handle));
+        }
+
+        inline bool _Wait_for_waitable_event(void* const _Handle, const uint32_t _Timeout) noexcept {
+            ::std::atomic<uint32_t>& _State = _As_futex_event(_Handle)->_State;
+            const bool _Infinite            = _Timeout == waitable_event::infinite_timeout;
+            timespec _Deadline              = {0, 0};
+            if (!_Infinite) {
+                ::clock_gettime(CLOCK_MONOTONIC, &_Deadline);
+                _Deadline.tv_sec  += static_cast<time_t>(_Timeout / 1000);
+                _Deadline.tv_nsec += static_cast<long>(_Timeout % 1000) * 1'000'000;
+                if (_Deadline.tv_nsec >= 1'000'000'000) {
+                    ++_Deadline.tv_sec;
+                    _Deadline.tv_nsec -= 1'000'000'000;
+                }
+            }
+
+            for (;;) {
+                uint32_t _Current = _State.load(::std::memory_order_acquire);
+                if (_Current == _Futex_event::_Set) {
+                    return true;
+                }
+
+                if (_Current == _Futex_event::_Unset
+                    && !_State.compare_exchange_weak(_Current, _Futex_event::_Waiting, ::std::memory_order_relaxed)) {
+                    continue; // changed, check again
+                }
+
+                if (_Infinite) {
+                    mjsync_impl::_Futex_wait(&_State, _Futex_event::_Waiting, nullptr);
+                    continue;
+                }
+
+                // the futex takes a relative timeout, recompute it after every wake-up
+                timespec _Now;
+                ::clock_gettime(CLOCK_MONOTONIC, &_Now);
+                timespec _Remaining;
+                _Remaining.tv_sec  = _Deadline.tv_sec - _Now.tv_sec;
+                _Remaining.tv_nsec = _Deadline.tv_nsec - _Now.tv_nsec;
+                if (_Remaining.tv_nsec < 0) {
+                    --_Remaining.tv_sec;
+                    _Remaining.tv_nsec += 1'000'000'000;
+                }
+
+                if (_Remaining.tv_sec < 0) { // timed out
+                    return _State.load(::std::memory_order_acquire) == _Futex_event::_Set;
+                }
+
+                mjsync_impl::_Futex_wait(&_State, _Futex_event::_Waiting, &_Remaining);
+            }
+        }
+
+        inline void _Set_waitable_event(void* const _Handle) noexcept {
+            ::std::atomic<uint32_t>& _State = _As_futex_event(_Handle)->_State;
+            if (_State.exchange(_Futex_event::_Set, ::std::memory_order_release) == _Futex_event::_Waiting) {
+                mjsync_impl::_Futex_wake(&_State, INT_MAX);
+            }
+        }
+
+        inline void _Reset_waitable_event(void* const _Handle) noexcept {
+            // an unset event stays unset, its waiters must not be forgotten
+            uint32_t _Expected = _Futex_event::_Set;
+            _As_futex_event(_Handle)->_State.compare_exchange_strong(
+                _Expected, _Futex_event::_Unset, ::std::memory_order_relaxed);
+        }
+#endif // _WIN32
     } // namespace mjsync_impl
 } // namespace mjx
 
@@ -0,0 +1,137 @@
+// latency_histogram.cpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <mjsync/latency_histogram.hpp>
+
+namespace mjx {
+    latency_histogram::latency_histogram() noexcept
+        : _Mybuckets(), _Mycount(0), _Mysum(0), _Mymin(UINT64_MAX), _Mymax(0) {}
+
+    void latency_histogram::record(const duration _Value, const uint64_t _Count) noexcept {
+        if (_Count == 0) {
+            return;
+        }
+
+        const uint64_t _Nanoseconds       = _Value.count() > 0 ? static_cast<uint64_t>(_Value.count()) : 0;
+        _Mybuckets[bucket_index(_Value)] += _Count;
+        _Mycount                         += _Count;
+        _Mysum                           += _Nanoseconds * _Count;
+        if (_Nanoseconds < _Mymin) {
+            _Mymin = _Nanoseconds;
+        }
+
+        if (_Nanoseconds > _Mymax) {
+            _Mymax = _Nanoseconds;
+        }
+    }
+
+    void latency_histogram::merge(const latency_histogram& _Other) noexcept {
+        for (size_t _Idx = 0; _Idx < bucket_count; ++_Idx) {
+            _Mybuckets[_Idx] += _Other._Mybuckets[_Idx];
+        }
+
+        _Mycount += _Other._Mycount;
+        _Mysum   += _Other._Mysum;
+        if (_Other._Mymin < _Mymin) {
+            _Mymin = _Other._Mymin;
+        }
+
+        if (_Other._Mymax > _Mymax) {
+            _Mymax = _Other._Mymax;
+        }
+    }
+
+    void latency_histogram::reset() noexcept {
+        ::memset(_Mybuckets, 0, sizeof(_Mybuckets));
+        _Mycount = 0;
+        _Mysum   = 0;
+        _Mymin   = UINT64_MAX;
+        _Mymax   = 0;
+    }
+
+    uint64_t latency_histogram::count() const noexcept {
+        return _Mycount;
+    }
+
+    latency_histogram::duration latency_histogram::minimum() const noexcept {
+        return duration{_Mycount > 0 ? static_cast<duration::rep>(_Mymin) : 0};
+    }
+
+    latency_histogram::duration latency_histogram::maximum() const noexcept {
+        return duration{static_cast<duration::rep>(_Mymax)};
+    }
+
+    latency_histogram::duration latency_histogram::mean() const noexcept {
+        return duration{_Mycount > 0 ? static_cast<duration::rep>(_Mysum / _Mycount) : 0};
+    }
+
+    latency_histogram::duration latency_histogram::percentile(const double _Percentage) const noexcept {
+        if (_Mycount == 0) { // no samples, break
+            return duration{0};
+        }
+
+        // the rank of the sample that the percentile points to, counted from one
+        const double _Clamped = _Percentage < 0.0 ? 0.0 : (_Percentage > 100.0 ? 100.0 : _Percentage);
+        uint64_t _Rank        = static_cast<uint64_t>(::std::ceil(_Clamped / 100.0 * static_cast<double>(_Mycount)));
+        if (_Rank == 0) {
+            _Rank = 1;
+        }
+
+        uint64_t _Seen = 0;
+        for (size_t _Idx = 0; _Idx < bucket_count; ++_Idx) {
+            _Seen += _Mybuckets[_Idx];
+            if (_Seen >= _Rank) { // the bucket's upper bound, but never more than the longest sample
+                const duration _Upper = bucket_upper_bound(_Idx);
+                return _Upper.count() < static_cast<duration::rep>(_Mymax)
+                    ? _Upper : duration{static_cast<duration::rep>(_Mymax)};
+            }
+        }
+
+        return maximum(); // the buckets lag behind the count in a concurrent snapshot
+    }
+
+    ::std::span<const uint64_t> latency_histogram::buckets() const noexcept {
+        return ::std::span<const uint64_t>(_Mybuckets, bucket_count);
+    }
+
+    size_t latency_histogram::bucket_index(const duration _Value) noexcept {
+        // Note: The first sub_bucket_count buckets hold one value each. Every following power of two is
+        //       split into sub_bucket_count buckets of equal width, so the width grows with the value.
+        constexpr uint64_t _Limit = (uint64_t{1} << max_exponent) - 1;
+        uint64_t _Nanoseconds     = _Value.count() > 0 ? static_cast<uint64_t>(_Value.count()) : 0;
+        if (_Nanoseconds > _Limit) {
+            _Nanoseconds = _Limit;
+        }
+
+        if (_Nanoseconds < sub_bucket_count) {
+            return static_cast<size_t>(_Nanoseconds);
+        }
+
+        const size_t _Exponent = static_cast<size_t>(::std::bit_width(_Nanoseconds)) - 1;
+        const size_t _Sub      = static_cast<size_t>(_Nanoseconds >> (_Exponent - sub_bucket_bits)) - sub_bucket_count;
+        return (_Exponent - sub_bucket_bits + 1) * sub_bucket_count + _Sub;
+    }
+
+    latency_histogram::duration latency_histogram::bucket_lower_bound(const size_t _Idx) noexcept {
+        if (_Idx < sub_bucket_count) {
+            return duration{static_cast<duration::rep>(_Idx)};
+        }
+
+        const size_t _Exponent = _Idx / sub_bucket_count + sub_bucket_bits - 1;
+        const uint64_t _Base   = sub_bucket_count + _Idx % sub_bucket_count;
+        return duration{static_cast<duration::rep>(_Base << (_Exponent - sub_bucket_bits))};
+    }
+
+    latency_histogram::duration latency_histogram::bucket_upper_bound(const size_t _Idx) noexcept {
+        if (_Idx + 1 >= bucket_count) { // the last bucket also holds all longer durations
+            return duration{static_cast<duration::rep>((uint64_t{1} << max_exponent) - 1)};
+        }
+
+        return bucket_lower_bound(_Idx + 1) - duration{1};
+    }
+} // namespace mjx
\ No newline at end of file
@@ -0,0 +1,73 @@
+// latency_histogram.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _MJSYNC_LATENCY_HISTOGRAM_HPP_
+#define _MJSYNC_LATENCY_HISTOGRAM_HPP_
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mjsync/api.hpp>
+#include <span>
+
+namespace mjx {
+    namespace mjsync_impl {
+        class _Latency_recorder;
+    } // namespace mjsync_impl
+
+    class _MJSYNC_API latency_histogram { // log-linear histogram of durations with a bounded relative error
+    public:
+        using duration = ::std::chrono::nanoseconds;
+
+        // each power of two is split into 2^sub_bucket_bits linear buckets, the error is below 1/16 of the value
+        static constexpr size_t sub_bucket_bits  = 4;
+        static constexpr size_t sub_bucket_count = size_t{1} << sub_bucket_bits;
+        static constexpr size_t max_exponent     = 36; // about 68 seconds, longer durations share the last bucket
+        static constexpr size_t bucket_count     = (max_exponent - sub_bucket_bits + 1) * sub_bucket_count;
+
+        latency_histogram() noexcept;
+
+        // records the duration _Count times, negative durations are recorded as zero
+        void record(const duration _Value, const uint64_t _Count = 1) noexcept;
+
+        // adds all samples of the other histogram
+        void merge(const latency_histogram& _Other) noexcept;
+
+        // removes all samples
+        void reset() noexcept;
+
+        // returns the number of samples
+        uint64_t count() const noexcept;
+
+        // returns the shortest, the longest and the average duration, zero if there are no samples
+        duration minimum() const noexcept;
+        duration maximum() const noexcept;
+        duration mean() const noexcept;
+
+        // returns the duration below which the percentage of samples lies, exact up to the bucket width
+        duration percentile(const double _Percentage) const noexcept;
+
+        // returns the number of samples in each bucket
+        ::std::span<const uint64_t> buckets() const noexcept;
+
+        // returns the bucket that holds the duration
+        static size_t bucket_index(const duration _Value) noexcept;
+
+        // returns the shortest and the longest duration that the bucket holds
+        static duration bucket_lower_bound(const size_t _Idx) noexcept;
+        static duration bucket_upper_bound(const size_t _Idx) noexcept;
+
+    private:
+        friend mjsync_impl::_Latency_recorder;
+
+        uint64_t _Mybuckets[bucket_count];
+        uint64_t _Mycount;
+        uint64_t _Mysum; // in nanoseconds
+        uint64_t _Mymin; // in nanoseconds, UINT64_MAX if there are no samples
+        uint64_t _Mymax; // in nanoseconds
+    };
+} // namespace mjx
+
+#endif // _MJSYNC_LATENCY_HISTOGRAM_HPP_
\ No newline at end of file
@@ -0,0 +1,326 @@
+// parallel.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _MJSYNC_PARALLEL_HPP_
+#define _MJSYNC_PARALLEL_HPP_
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <mjmem/object_allocator.hpp>
+#include <mjmem/smart_pointer.hpp>
+#include <mjsync/async.hpp>
+#include <mjsync/task.hpp>
+#include <mjsync/thread.hpp>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace mjx {
+    struct _No_partial {}; // partial result of algorithms that produce no result
+
+    template <task_scheduler _Sched>
+    inline size_t _Scheduler_concurrency(_Sched& _Scheduler) noexcept {
+        // returns the number of threads that execute the scheduler's tasks
+        if constexpr (requires { { _Scheduler.thread_count() } -> ::std::convertible_to<size_t>; }) {
+            const size_t _Count = _Scheduler.thread_count();
+            return _Count > 0 ? _Count : 1;
+        } else {
+            return 1;
+        }
+    }
+
+    template <task_scheduler _Sched, class _Ty, class _Body>
+    class _Parallel_range { // executes _Body over an index range, splitting it on demand
+    public:
+        _Parallel_range(_Sched& _Scheduler, _Body& _Func, const size_t _Size, const size_t _Grain) noexcept
+            : _Myscheduler(_Scheduler), _Myfunc(_Func), _Mygrain(_Grain > 0 ? _Grain : _Auto_grain(_Scheduler, _Size)),
+            _Mythreads(_Scheduler_concurrency(_Scheduler)), _Myqueued(0), _Myfailing(false), _Myfailed(false),
+            _Myexception(), _Myspawned(nullptr) {}
+
+        _Parallel_range(const _Parallel_range&)            = delete;
+        _Parallel_range& operator=(const _Parallel_range&) = delete;
+
+        ::std::optional<_Ty> _Run(const size_t _First, const size_t _Last, ::std::optional<_Ty> _Init) {
+            // the calling thread processes the range too, then combines the partials in the index order
+            _Piece _Own(this, _First, _Last);
+            _Own._Started = true;
+            _Process(_Own);
+
+            struct _Piece_releaser { // frees the joined pieces, even if an exception is thrown
+                _Piece* _Head;
+
+                ~_Piece_releaser() noexcept {
+                    while (_Head) {
+                        ::mjx::delete_object(::std::exchange(_Head, _Head->_Next));
+                    }
+                }
+            } _Releaser{_Join()};
+
+            size_t _Count = 1;
+            for (_Piece* _Next = _Releaser._Head; _Next; _Next = _Next->_Next) {
+                ++_Count;
+            }
+
+            unique_smart_array<_Piece*> _Pieces = ::mjx::make_unique_smart_array<_Piece*>(_Count);
+            _Pieces.get()[0]                    = ::std::addressof(_Own);
+            size_t _Idx                         = 1;
+            for (_Piece* _Next = _Releaser._Head; _Next; _Next = _Next->_Next) {
+                _Pieces.get()[_Idx++] = _Next;
+            }
+
+            if (_Myfailed.load(::std::memory_order_acquire)) {
+                ::std::rethrow_exception(_Myexception);
+            }
+
+            ::std::sort(_Pieces.get(), _Pieces.get() + _Count, [](const _Piece* _Left, const _Piece* _Right) noexcept {
+                return _Left->_First < _Right->_First;
+            });
+            if constexpr (!::std::is_same_v<_Ty, _No_partial>) {
+                for (_Piece** _Ptr = _Pieces.get(); _Ptr != _Pieces.get() + _Count; ++_Ptr) {
+                    if ((*_Ptr)->_Partial) {
+                        _Init = _Init ? ::std::optional<_Ty>(_Myfunc._Combine(::std::move(*_Init),
+                            ::std::move(*(*_Ptr)->_Partial))) : ::std::move((*_Ptr)->_Partial);
+                    }
+                }
+            }
+
+            return _Init;
+        }
+
+    private:
+        struct _Piece { // part of the range, owns its own partial result
+            _Parallel_range* _Owner;
+            size_t _First;
+            size_t _Last;
+            bool _Started;
+            ::std::optional<_Ty> _Partial;
+            task _Handle; // set by the spawning thread before the piece is published
+            _Piece* _Next; // next spawned or joined piece
+
+            _Piece(_Parallel_range* const _Owner, const size_t _First, const size_t _Last) noexcept
+                : _Owner(_Owner), _First(_First), _Last(_Last), _Started(false), _Partial(), _Handle(),
+                _Next(nullptr) {}
+        };
+
+        static size_t _Auto_grain(_Sched& _Scheduler, const size_t _Size) noexcept {
+            // aim for several chunks per thread, so that the splitting can balance the load
+            const size_t _Grain = _Size / (_Scheduler_concurrency(_Scheduler) * 8);
+            return _Grain > 0 ? _Grain : 1;
+        }
+
+        static void _Run_piece(void* const _Arg) noexcept {
+            _Piece* const _Target = static_cast<_Piece*>(_Arg);
+            _Target->_Started     = true;
+            _Target->_Owner->_Myqueued.fetch_sub(1, ::std::memory_order_relaxed);
+            _Target->_Owner->_Process(*_Target);
+        }
+
+        void _Fail(::std::exception_ptr _Exception) noexcept {
+            // only the first exception is kept, the remaining pieces stop early
+            bool _Expected = false;
+            if (_Myfailing.compare_exchange_strong(_Expected, true, ::std::memory_order_acq_rel)) {
+                _Myexception = ::std::move(_Exception);
+                _Myfailed.store(true, ::std::memory_order_release);
+            }
+        }
+
+        bool _Spawn(const size_t _First, const size_t _Last) noexcept {
+            // schedules a new piece, returns false if the caller must process the range itself
+            _Piece* _New_piece;
+            try {
+                _New_piece = ::mjx::create_object<_Piece>(this, _First, _Last);
+            } catch (...) {
+                return false;
+            }
+
+            _Myqueued.fetch_add(1, ::std::memory_order_relaxed);
+            try {
+                _New_piece->_Handle = _Myscheduler.schedule_task(
+                    task_descriptor{&_Run_piece, _New_piece, task_priority::normal});
+            } catch (...) { // the task has not been created
+            }
+
+            if (!_New_piece->_Handle.is_registered()) {
+                _Myqueued.fetch_sub(1, ::std::memory_order_relaxed);
+                ::mjx::delete_object(_New_piece);
+                return false;
+            }
+
+            // publish the piece, the joining thread waits for it through its handle
+            _Piece* _Head = _Myspawned.load(::std::memory_order_relaxed);
+            do {
+                _New_piece->_Next = _Head;
+            } while (!_Myspawned.compare_exchange_weak(
+                _Head, _New_piece, ::std::memory_order_release, ::std::memory_order_relaxed));
+            return true;
+        }
+
+        void _Process(_Piece& _Target) noexcept {
+            // Note: This is lazy binary splitting. A piece hands over the upper half of its range only
+            //       while fewer pieces wait in the queues than there are threads, that is, while some thread
+            //       may be idle. Otherwise the piece keeps going in grain-sized steps, so a balanced load
+            //       is not split any further, while an imbalance is detected between any two steps.
+            size_t _First = _Target._First;
+            size_t _Last  = _Target._Last;
+            try {
+                while (_First < _Last && !_Myfailed.load(::std::memory_order_relaxed)) {
+                    while (_Last - _First > _Mygrain && _Myqueued.load(::std::memory_order_relaxed) < _Mythreads) {
+                        const size_t _Mid = _First + (_Last - _First) / 2;
+                        if (!_Spawn(_Mid, _Last)) { // the piece could not be scheduled, keep the whole range
+                            break;
+                        }
+
+                        _Last = _Mid;
+                    }
+
+                    const size_t _Step = (::std::min)(_Mygrain, _Last - _First);
+                    _Myfunc(_First, _First + _Step, _Target._Partial);
+                    _First += _Step;
+                }
+            } catch (...) {
+                _Fail(::std::current_exception());
+            }
+
+            _Target._Last = _Last; // the upper part has been handed over to other pieces
+        }
+
+        _Piece* _Join() noexcept {
+            // Note: The pieces are joined through their handles, so a pool worker runs a piece that is still
+            //       queued itself, or other pending tasks while it waits. Blocking instead would deadlock
+            //       a nested call, the pieces may be queued behind the waiting worker. A piece publishes
+            //       the pieces it spawns before it finishes, so once every published piece is done,
+            //       no piece is left. Returns the joined pieces.
+            _Piece* _Joined = nullptr;
+            while (_Piece* _List = _Myspawned.exchange(nullptr, ::std::memory_order_acquire)) {
+                while (_List) {
+                    _Piece* const _Target = ::std::exchange(_List, _List->_Next);
+                    _Target->_Handle.wait_until_done();
+                    if (!_Target->_Started) { // canceled, the range is incomplete
+                        _Myqueued.fetch_sub(1, ::std::memory_order_relaxed);
+                        _Fail(::std::make_exception_ptr(::std::future_error(::std::future_errc::broken_promise)));
+                    }
+
+                    _Target->_Next = ::std::exchange(_Joined, _Target);
+                }
+            }
+
+            return _Joined;
+        }
+
+        _Sched& _Myscheduler;
+        _Body& _Myfunc;
+        const size_t _Mygrain;
+        const size_t _Mythreads;
+        ::std::atomic<size_t> _Myqueued; // scheduled pieces that have not started yet
+        ::std::atomic<bool> _Myfailing; // set by the first failing piece
+        ::std::atomic<bool> _Myfailed; // set once _Myexception is stored
+        ::std::exception_ptr _Myexception;
+        ::std::atomic<_Piece*> _Myspawned; // scheduled pieces that have not been joined yet
+    };
+
+    template <class _Fn>
+    struct _For_body { // invokes _Fn for every index of a step
+        _Fn& _Func;
+
+        void operator()(const size_t _First, const size_t _Last, ::std::optional<_No_partial>&) {
+            for (size_t _Idx = _First; _Idx < _Last; ++_Idx) {
+                _Func(_Idx);
+            }
+        }
+    };
+
+    template <class _Ty, class _Reduce_fn, class _Transform_fn>
+    struct _Transform_reduce_body { // accumulates the transformed indices of a step into the partial
+        _Reduce_fn& _Reduce;
+        _Transform_fn& _Transform;
+
+        void operator()(const size_t _First, const size_t _Last, ::std::optional<_Ty>& _Partial) {
+            for (size_t _Idx = _First; _Idx < _Last; ++_Idx) {
+                if (_Partial) {
+                    _Partial.emplace(_Reduce(::std::move(*_Partial), _Transform(_Idx)));
+                } else {
+                    _Partial.emplace(_Transform(_Idx));
+                }
+            }
+        }
+
+        _Ty _Combine(_Ty _Left, _Ty _Right) {
+            return _Reduce(::std::move(_Left), ::std::move(_Right));
+        }
+    };
+
+    // Note: The calling thread takes part in the execution and waits for the remaining work.
+    //       The element order of a reduction is preserved, so _Reduce must be associative,
+    //       but it does not have to be commutative.
+
+    // invokes _Func(i) for every index i in [_First, _Last)
+    template <task_scheduler _Sched, class _Fn>
+    void parallel_for(
+        _Sched& _Scheduler, const size_t _First, const size_t _Last, _Fn&& _Func, const size_t _Grain = 0) {
+        if (_First >= _Last) {
+            return;
+        }
+
+        _For_body<::std::remove_reference_t<_Fn>> _Body{_Func};
+        _Parallel_range<_Sched, _No_partial, decltype(_Body)> _Range(_Scheduler, _Body, _Last - _First, _Grain);
+        (void) _Range._Run(_First, _Last, ::std::nullopt);
+    }
+
+    // invokes _Func(element) for every element in [_First, _Last)
+    template <task_scheduler _Sched, ::std::random_access_iterator _Iter, class _Fn>
+    void parallel_for(_Sched& _Scheduler, const _Iter _First, const _Iter _Last, _Fn&& _Func, const size_t _Grain = 0) {
+        const auto _Size = _Last - _First;
+        ::mjx::parallel_for(_Scheduler, size_t{0}, static_cast<size_t>(_Size > 0 ? _Size : 0),
+            [&](const size_t _Idx) { _Func(_First[static_cast<::std::iter_difference_t<_Iter>>(_Idx)]); }, _Grain);
+    }
+
+    // reduces _Transform(i) for every index i in [_First, _Last) and _Init with _Reduce
+    template <task_scheduler _Sched, class _Ty, class _Reduce_fn, class _Transform_fn>
+    _Ty parallel_transform_reduce(_Sched& _Scheduler, const size_t _First, const size_t _Last, _Ty _Init,
+        _Reduce_fn _Reduce, _Transform_fn _Transform, const size_t _Grain = 0) {
+        if (_First >= _Last) {
+            return _Init;
+        }
+
+        _Transform_reduce_body<_Ty, _Reduce_fn, _Transform_fn> _Body{_Reduce, _Transform};
+        _Parallel_range<_Sched, _Ty, decltype(_Body)> _Range(_Scheduler, _Body, _Last - _First, _Grain);
+        return *_Range._Run(_First, _Last, ::std::optional<_Ty>(::std::move(_Init)));
+    }
+
+    // reduces _Transform(element) for every element in [_First, _Last) and _Init with _Reduce
+    template <task_scheduler _Sched, ::std::random_access_iterator _Iter, class _Ty, class _Reduce_fn,
+        class _Transform_fn>
+    _Ty parallel_transform_reduce(_Sched& _Scheduler, const _Iter _First, const _Iter _Last, _Ty _Init,
+        _Reduce_fn _Reduce, _Transform_fn _Transform, const size_t _Grain = 0) {
+        const auto _Size = _Last - _First;
+        return ::mjx::parallel_transform_reduce(_Scheduler, size_t{0}, static_cast<size_t>(_Size > 0 ? _Size : 0),
+            ::std::move(_Init), ::std::move(_Reduce), [&](const size_t _Idx) -> _Ty {
+                return _Transform(_First[static_cast<::std::iter_difference_t<_Iter>>(_Idx)]);
+            }, _Grain);
+    }
+
+    // reduces every index in [_First, _Last) and _Init with _Reduce
+    template <task_scheduler _Sched, class _Ty, class _Reduce_fn = ::std::plus<>>
+    _Ty parallel_reduce(_Sched& _Scheduler, const size_t _First, const size_t _Last, _Ty _Init,
+        _Reduce_fn _Reduce = {}, const size_t _Grain = 0) {
+        return ::mjx::parallel_transform_reduce(_Scheduler, _First, _Last, ::std::move(_Init), ::std::move(_Reduce),
+            [](const size_t _Idx) -> _Ty { return static_cast<_Ty>(_Idx); }, _Grain);
+    }
+
+    // reduces every element in [_First, _Last) and _Init with _Reduce
+    template <task_scheduler _Sched, ::std::random_access_iterator _Iter, class _Ty, class _Reduce_fn = ::std::plus<>>
+    _Ty parallel_reduce(_Sched& _Scheduler, const _Iter _First, const _Iter _Last, _Ty _Init,
+        _Reduce_fn _Reduce = {}, const size_t _Grain = 0) {
+        return ::mjx::parallel_transform_reduce(_Scheduler, _First, _Last, ::std::move(_Init), ::std::move(_Reduce),
+            [](const ::std::iter_reference_t<_Iter> _Elem) -> _Ty { return _Elem; }, _Grain);
+    }
+} // namespace mjx
+
+#endif // _MJSYNC_PARALLEL_HPP_
\ No newline at end of file
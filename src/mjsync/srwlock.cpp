@@ -3,7 +3,11 @@
 // Copyright (c) Mateusz Jandura. All rights reserved.
 // SPDX-License-Identifier: Apache-2.0
 
+#ifdef _WIN32
 #include <mjsync/impl/tinywin.hpp>
+#else // ^^^ _WIN32 ^^^ / vvv !_WIN32 vvv
+#include <mjsync/impl/srwlock.hpp>
+#endif // _WIN32
 #include <mjsync/srwlock.hpp>
 
 namespace mjx {
@@ -12,22 +16,38 @@ namespace mjx {
     shared_lock::~shared_lock() noexcept {}
 
     void shared_lock::lock() noexcept {
+#ifdef _WIN32
         ::AcquireSRWLockExclusive(reinterpret_cast<SRWLOCK*>(&_Myimpl));
+#else // ^^^ _WIN32 ^^^ / vvv !_WIN32 vvv
+        mjsync_impl::_Futex_rwlock::_Lock_exclusive(_Myimpl._Word);
+#endif // _WIN32
     }
 
     void shared_lock::lock_shared() noexcept {
+#ifdef _WIN32
         ::AcquireSRWLockShared(reinterpret_cast<SRWLOCK*>(&_Myimpl));
+#else // ^^^ _WIN32 ^^^ / vvv !_WIN32 vvv
+        mjsync_impl::_Futex_rwlock::_Lock_shared(_Myimpl._Word);
+#endif // _WIN32
     }
 
     void shared_lock::unlock() noexcept {
+#ifdef _WIN32
 #ifdef _Analysis_assume_lock_held_
         _Analysis_assume_lock_held_(reinterpret_cast<SRWLOCK>(_Myimpl)); // avoids C26110 warning
 #endif // _Analysis_assume_lock_held_
         ::ReleaseSRWLockExclusive(reinterpret_cast<SRWLOCK*>(&_Myimpl));
+#else // ^^^ _WIN32 ^^^ / vvv !_WIN32 vvv
+        mjsync_impl::_Futex_rwlock::_Unlock_exclusive(_Myimpl._Word);
+#endif // _WIN32
     }
 
     void shared_lock::unlock_shared() noexcept {
+#ifdef _WIN32
         ::ReleaseSRWLockShared(reinterpret_cast<SRWLOCK*>(&_Myimpl));
+#else // ^^^ _WIN32 ^^^ / vvv !_WIN32 vvv
+        mjsync_impl::_Futex_rwlock::_Unlock_shared(_Myimpl._Word);
+#endif // _WIN32
     }
 
     lock_guard::lock_guard(shared_lock& _Lock) noexcept : _Mylock(_Lock) {
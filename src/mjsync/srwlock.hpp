@@ -6,6 +6,7 @@
 #pragma once
 #ifndef _MJSYNC_SRWLOCK_HPP_
 #define _MJSYNC_SRWLOCK_HPP_
+#include <cstdint>
 #include <mjsync/api.hpp>
 
 namespace mjx {
@@ -30,9 +31,15 @@ namespace mjx {
         void unlock_shared() noexcept;
 
     private:
+#ifdef _WIN32
         struct _Impl { // copy of SRWLOCK structure
             void* _Ptr;
         };
+#else // ^^^ _WIN32 ^^^ / vvv !_WIN32 vvv
+        struct _Impl { // lock word, see impl/srwlock.hpp
+            uint32_t _Word;
+        };
+#endif // _WIN32
         
         _Impl _Myimpl;
     };
@@ -0,0 +1,125 @@
+// stop_token.cpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <mjmem/object_allocator.hpp>
+#include <mjsync/impl/stop_token.hpp>
+#include <mjsync/stop_token.hpp>
+#include <utility>
+
+namespace mjx {
+    stop_source::stop_source() : _Mystate(::mjx::create_object<mjsync_impl::_Stop_state>()) {}
+
+    stop_source::stop_source(const stop_source& _Other) noexcept : _Mystate(_Other._Mystate) {
+        mjsync_impl::_Stop_state::_Add_ref(_Mystate);
+    }
+
+    stop_source::stop_source(stop_source&& _Other) noexcept
+        : _Mystate(::std::exchange(_Other._Mystate, nullptr)) {}
+
+    stop_source::~stop_source() noexcept {
+        mjsync_impl::_Stop_state::_Release(_Mystate);
+    }
+
+    stop_source& stop_source::operator=(const stop_source& _Other) noexcept {
+        if (this != ::std::addressof(_Other)) {
+            mjsync_impl::_Stop_state::_Add_ref(_Other._Mystate);
+            mjsync_impl::_Stop_state::_Release(_Mystate);
+            _Mystate = _Other._Mystate;
+        }
+
+        return *this;
+    }
+
+    stop_source& stop_source::operator=(stop_source&& _Other) noexcept {
+        if (this != ::std::addressof(_Other)) {
+            mjsync_impl::_Stop_state::_Release(_Mystate);
+            _Mystate = ::std::exchange(_Other._Mystate, nullptr);
+        }
+
+        return *this;
+    }
+
+    bool stop_source::stop_possible() const noexcept {
+        return _Mystate != nullptr;
+    }
+
+    bool stop_source::stop_requested() const noexcept {
+        return _Mystate ? _Mystate->_Stop_requested() : false;
+    }
+
+    bool stop_source::request_stop() noexcept {
+        return _Mystate ? _Mystate->_Request_stop() : false;
+    }
+
+    stop_token stop_source::get_token() const noexcept {
+        mjsync_impl::_Stop_state::_Add_ref(_Mystate);
+        return stop_token(_Mystate);
+    }
+
+    stop_token::stop_token() noexcept : _Mystate(nullptr) {}
+
+    stop_token::stop_token(mjsync_impl::_Stop_state* const _State) noexcept : _Mystate(_State) {}
+
+    stop_token::stop_token(const stop_token& _Other) noexcept : _Mystate(_Other._Mystate) {
+        mjsync_impl::_Stop_state::_Add_ref(_Mystate);
+    }
+
+    stop_token::stop_token(stop_token&& _Other) noexcept : _Mystate(::std::exchange(_Other._Mystate, nullptr)) {}
+
+    stop_token::~stop_token() noexcept {
+        mjsync_impl::_Stop_state::_Release(_Mystate);
+    }
+
+    stop_token& stop_token::operator=(const stop_token& _Other) noexcept {
+        if (this != ::std::addressof(_Other)) {
+            mjsync_impl::_Stop_state::_Add_ref(_Other._Mystate);
+            mjsync_impl::_Stop_state::_Release(_Mystate);
+            _Mystate = _Other._Mystate;
+        }
+
+        return *this;
+    }
+
+    stop_token& stop_token::operator=(stop_token&& _Other) noexcept {
+        if (this != ::std::addressof(_Other)) {
+            mjsync_impl::_Stop_state::_Release(_Mystate);
+            _Mystate = ::std::exchange(_Other._Mystate, nullptr);
+        }
+
+        return *this;
+    }
+
+    bool stop_token::stop_possible() const noexcept {
+        // Note: Unlike std::stop_token, a token stays stoppable even if all sources are gone,
+        //       the sources are not counted separately.
+        return _Mystate != nullptr;
+    }
+
+    bool stop_token::stop_requested() const noexcept {
+        return _Mystate ? _Mystate->_Stop_requested() : false;
+    }
+
+    stop_callback::stop_callback(const stop_token& _Token, const callback_type _Callback, void* const _Arg) noexcept
+        : _Mystate(_Token._Mystate), _Mycallback(_Callback), _Myarg(_Arg), _Myprev(nullptr), _Mynext(nullptr),
+        _Mydone(false) {
+        if (!_Mystate) { // no stop state, nothing to register
+            return;
+        }
+
+        mjsync_impl::_Stop_state::_Add_ref(_Mystate);
+        if (!_Mystate->_Register(this)) { // already requested, invoke immediately
+            mjsync_impl::_Stop_state::_Release(_Mystate);
+            _Mystate = nullptr;
+            _Callback(_Arg);
+        }
+    }
+
+    stop_callback::~stop_callback() noexcept {
+        if (_Mystate) {
+            _Mystate->_Unregister(this);
+            mjsync_impl::_Stop_state::_Release(_Mystate);
+        }
+    }
+} // namespace mjx
\ No newline at end of file
@@ -0,0 +1,96 @@
+// stop_token.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _MJSYNC_STOP_TOKEN_HPP_
+#define _MJSYNC_STOP_TOKEN_HPP_
+#include <atomic>
+#include <mjsync/api.hpp>
+
+namespace mjx {
+    namespace mjsync_impl {
+        class _Stop_state;
+    } // namespace mjsync_impl
+
+    class stop_token;
+
+    class _MJSYNC_API stop_source { // requests a cooperative stop from the holders of its tokens
+    public:
+        stop_source();
+        stop_source(const stop_source& _Other) noexcept;
+        stop_source(stop_source&& _Other) noexcept;
+        ~stop_source() noexcept;
+
+        stop_source& operator=(const stop_source& _Other) noexcept;
+        stop_source& operator=(stop_source&& _Other) noexcept;
+
+        // checks if the source has a stop state
+        bool stop_possible() const noexcept;
+
+        // checks if a stop has been requested
+        bool stop_requested() const noexcept;
+
+        // requests a stop and invokes the registered callbacks, fails if a stop has already been requested
+        bool request_stop() noexcept;
+
+        // returns a token associated with the source's stop state
+        stop_token get_token() const noexcept;
+
+    private:
+        mjsync_impl::_Stop_state* _Mystate;
+    };
+
+    class _MJSYNC_API stop_token { // observes the stop state of a stop_source
+    public:
+        stop_token() noexcept;
+        stop_token(const stop_token& _Other) noexcept;
+        stop_token(stop_token&& _Other) noexcept;
+        ~stop_token() noexcept;
+
+        stop_token& operator=(const stop_token& _Other) noexcept;
+        stop_token& operator=(stop_token&& _Other) noexcept;
+
+        // checks if a stop can ever be requested
+        bool stop_possible() const noexcept;
+
+        // checks if a stop has been requested, a single relaxed load
+        bool stop_requested() const noexcept;
+
+    private:
+        friend stop_source;
+        friend class stop_callback;
+
+        explicit stop_token(mjsync_impl::_Stop_state* const _State) noexcept;
+
+        mjsync_impl::_Stop_state* _Mystate;
+    };
+
+    class _MJSYNC_API stop_callback { // invokes a callback once a stop is requested, while registered
+    public:
+        using callback_type = void(*)(void*);
+
+        // registers the callback, invokes it immediately if a stop has already been requested, must not throw
+        stop_callback(const stop_token& _Token, const callback_type _Callback, void* const _Arg) noexcept;
+
+        // unregisters the callback, waits if it is being invoked by another thread
+        ~stop_callback() noexcept;
+
+        stop_callback(const stop_callback&)            = delete;
+        stop_callback& operator=(const stop_callback&) = delete;
+
+    private:
+        friend mjsync_impl::_Stop_state;
+
+        mjsync_impl::_Stop_state* _Mystate;
+        callback_type _Mycallback;
+        void* _Myarg;
+        stop_callback* _Myprev;
+        stop_callback* _Mynext;
+#pragma warning(suppress : 4251) // C4251: std::atomic needs to have dll-interface
+        ::std::atomic<bool> _Mydone; // set once the callback has returned
+    };
+} // namespace mjx
+
+#endif // _MJSYNC_STOP_TOKEN_HPP_
\ No newline at end of file
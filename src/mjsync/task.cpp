@@ -8,30 +8,44 @@
 #include <type_traits>
 
 namespace mjx {
-    task::task() noexcept : _Myid(invalid_id), _Mythrd(nullptr) {}
+    namespace mjsync_impl {
+        _Task_table& _Get_task_table() noexcept {
+            static _Task_table _Table;
+            return _Table;
+        }
+    } // namespace mjsync_impl
+
+    task::task() noexcept : _Myid(invalid_id) {}
 
-    task::task(task&& _Other) noexcept : _Myid(_Other._Myid), _Mythrd(_Other._Mythrd) {
-        _Other._Myid   = invalid_id;
-        _Other._Mythrd = nullptr;
+    task::task(task&& _Other) noexcept : _Myid(_Other._Myid) {
+        _Other._Myid = invalid_id;
     }
 
-    task::task(const id _Id, thread* const _Thread) noexcept : _Myid(_Id), _Mythrd(_Thread) {}
+    task::task(const id _Id) noexcept : _Myid(_Id) {}
 
-    task::~task() noexcept {}
+    task::~task() noexcept {
+        if (is_registered()) { // release the slot reference held by this handle
+            mjsync_impl::_Task_proxy _Proxy(_Myid);
+            _Proxy._Release();
+        }
+    }
 
     task& task::operator=(task&& _Other) noexcept {
         if (this != ::std::addressof(_Other)) {
-            _Myid          = _Other._Myid;
-            _Mythrd        = _Other._Mythrd;
-            _Other._Myid   = invalid_id;
-            _Other._Mythrd = nullptr;
+            if (is_registered()) { // release the current slot reference first
+                mjsync_impl::_Task_proxy _Proxy(_Myid);
+                _Proxy._Release();
+            }
+
+            _Myid        = _Other._Myid;
+            _Other._Myid = invalid_id;
         }
 
         return *this;
     }
 
     bool task::is_registered() const noexcept {
-        return _Myid != invalid_id && _Mythrd != nullptr;
+        return _Myid != invalid_id;
     }
 
     task::id task::get_id() const noexcept {
@@ -43,7 +57,7 @@ namespace mjx {
             return task_state::none;
         }
 
-        mjsync_impl::_Task_proxy _Proxy(_Myid, _Mythrd->_Myimpl.get());
+        mjsync_impl::_Task_proxy _Proxy(_Myid);
         return _Proxy._Get_state();
     }
 
@@ -52,7 +66,7 @@ namespace mjx {
             return task_priority::none;
         }
 
-        mjsync_impl::_Task_proxy _Proxy(_Myid, _Mythrd->_Myimpl.get());
+        mjsync_impl::_Task_proxy _Proxy(_Myid);
         return _Proxy._Get_priority();
     }
 
@@ -61,13 +75,13 @@ namespace mjx {
             return cancellation_result::task_not_registered;
         }
 
-        mjsync_impl::_Task_proxy _Proxy(_Myid, _Mythrd->_Myimpl.get());
+        mjsync_impl::_Task_proxy _Proxy(_Myid);
         return _Proxy._Cancel();
     }
 
     void task::wait_until_done() noexcept {
         if (is_registered()) { // task registered, wait if possible
-            mjsync_impl::_Task_proxy _Proxy(_Myid, _Mythrd->_Myimpl.get());
+            mjsync_impl::_Task_proxy _Proxy(_Myid);
             _Proxy._Wait_until_done();
         }
     }
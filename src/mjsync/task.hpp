@@ -6,6 +6,7 @@
 #pragma once
 #ifndef _MJSYNC_TASK_HPP_
 #define _MJSYNC_TASK_HPP_
+#include <cstddef>
 #include <cstdint>
 #include <mjsync/api.hpp>
 
@@ -36,6 +37,10 @@ namespace mjx {
 
         static constexpr id invalid_id = 0;
 
+        // size and alignment of the storage that every task provides for its argument
+        static constexpr size_t inline_storage_size      = 128;
+        static constexpr size_t inline_storage_alignment = alignof(::std::max_align_t);
+
         task() noexcept;
         task(task&& _Other) noexcept;
         ~task() noexcept;
@@ -60,22 +65,23 @@ namespace mjx {
         enum class cancellation_result : unsigned char {
             success,
             already_canceled,
-            task_not_registered
+            task_not_registered,
+            already_started
         };
 
-        // cancels the task
+        // cancels the task if it has not started yet
         cancellation_result cancel() noexcept;
 
-        // waits until the task is done
+        // waits until the task is done, a pool worker runs the task itself if it has not started yet,
+        // or other pending tasks meanwhile
         void wait_until_done() noexcept;
 
     private:
         friend thread;
 
-        task(const id _Id, thread* const _Thread) noexcept;
+        explicit task(const id _Id) noexcept;
 
-        id _Myid; // unique task ID within thread task queue
-        thread* _Mythrd; // thread that will execute this task
+        id _Myid; // generational slot ID, unique among all live tasks
     };
 } // namespace mjx
 
@@ -0,0 +1,81 @@
+// task_graph.cpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <memory>
+#include <mjmem/object_allocator.hpp>
+#include <mjsync/impl/task_graph.hpp>
+#include <mjsync/task_graph.hpp>
+
+namespace mjx {
+    task_graph::task_graph() noexcept : _Mygraph(nullptr) {}
+
+    task_graph::task_graph(task_graph&& _Other) noexcept : _Mygraph(_Other._Mygraph.release()) {}
+
+    task_graph::~task_graph() noexcept {
+        if (_Mygraph) { // a node may still be notifying the finished run
+            mjsync_impl::_Graph_state::_Release_state(_Mygraph.release());
+        }
+    }
+
+    task_graph& task_graph::operator=(task_graph&& _Other) noexcept {
+        if (this != ::std::addressof(_Other)) {
+            if (_Mygraph) {
+                mjsync_impl::_Graph_state::_Release_state(_Mygraph.release());
+            }
+
+            _Mygraph.reset(_Other._Mygraph.release());
+        }
+
+        return *this;
+    }
+
+    task_graph::node_id task_graph::_Add_node(_Graph_callable* const _Callable, const task_priority _Priority) {
+        if (!_Mygraph) { // the first node, allocate the graph
+            try {
+                _Mygraph.reset(::mjx::create_object<mjsync_impl::_Graph_state>());
+            } catch (...) {
+                _Callable->_Destroy();
+                throw;
+            }
+        } else if (_Mygraph->_Is_running()) { // nodes must not be added while running
+            _Callable->_Destroy();
+            return invalid_node;
+        }
+
+        return _Mygraph->_Add_node(_Callable, _Priority);
+    }
+
+    bool task_graph::_Run(void* const _Scheduler, const _Schedule_fn _Schedule) {
+        return _Mygraph ? _Mygraph->_Run(_Scheduler, _Schedule) : true;
+    }
+
+    bool task_graph::add_edge(const node_id _Before, const node_id _After) {
+        if (!_Mygraph || _Mygraph->_Is_running()) { // no nodes or edges must not be added while running
+            return false;
+        }
+
+        return _Mygraph->_Add_edge(_Before, _After);
+    }
+
+    size_t task_graph::node_count() const noexcept {
+        return _Mygraph ? _Mygraph->_Size() : 0;
+    }
+
+    bool task_graph::is_running() const noexcept {
+        return _Mygraph ? _Mygraph->_Is_running() : false;
+    }
+
+    bool task_graph::clear() noexcept {
+        if (_Mygraph && _Mygraph->_Is_running()) { // nodes must not be removed while running
+            return false;
+        }
+
+        if (_Mygraph) {
+            mjsync_impl::_Graph_state::_Release_state(_Mygraph.release());
+        }
+
+        return true;
+    }
+} // namespace mjx
\ No newline at end of file
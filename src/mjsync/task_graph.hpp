@@ -0,0 +1,110 @@
+// task_graph.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _MJSYNC_TASK_GRAPH_HPP_
+#define _MJSYNC_TASK_GRAPH_HPP_
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mjmem/object_allocator.hpp>
+#include <mjmem/smart_pointer.hpp>
+#include <mjsync/api.hpp>
+#include <mjsync/async.hpp>
+#include <mjsync/task.hpp>
+#include <mjsync/thread.hpp>
+#include <type_traits>
+#include <utility>
+
+namespace mjx {
+    namespace mjsync_impl {
+        class _Graph_state;
+    } // namespace mjsync_impl
+
+    class _Graph_callable { // type-erased callable of a graph node
+    public:
+        _Graph_callable() noexcept {}
+        virtual ~_Graph_callable() noexcept {}
+
+        _Graph_callable(const _Graph_callable&)            = delete;
+        _Graph_callable& operator=(const _Graph_callable&) = delete;
+
+        virtual void _Invoke() = 0;
+        virtual void _Destroy() noexcept = 0;
+    };
+
+    template <class _Fn>
+    class _Graph_callable_impl : public _Graph_callable {
+    public:
+        template <class _Fx>
+        explicit _Graph_callable_impl(_Fx&& _Func) : _Myfunc(::std::forward<_Fx>(_Func)) {}
+
+        void _Invoke() override {
+            ::std::invoke(_Myfunc);
+        }
+
+        void _Destroy() noexcept override {
+            ::mjx::delete_object(this);
+        }
+
+    private:
+        _Fn _Myfunc;
+    };
+
+    class _MJSYNC_API task_graph { // reusable graph of callables, each one runs once its predecessors are done
+    public:
+        using node_id = size_t;
+
+        static constexpr node_id invalid_node = static_cast<node_id>(-1);
+
+        task_graph() noexcept;
+        task_graph(task_graph&& _Other) noexcept;
+        ~task_graph() noexcept;
+
+        task_graph& operator=(task_graph&& _Other) noexcept;
+
+        task_graph(const task_graph&)            = delete;
+        task_graph& operator=(const task_graph&) = delete;
+
+        // adds a new node, returns invalid_node if the graph is running
+        template <class _Fn>
+        node_id add_node(_Fn&& _Func, const task_priority _Priority = task_priority::normal) {
+            return _Add_node(::mjx::create_object<_Graph_callable_impl<::std::decay_t<_Fn>>>(
+                ::std::forward<_Fn>(_Func)), _Priority);
+        }
+
+        // makes _After depend on _Before, fails if the edge exists, is invalid or would create a cycle
+        bool add_edge(const node_id _Before, const node_id _After);
+
+        // returns the number of nodes
+        size_t node_count() const noexcept;
+
+        // checks if the graph is running
+        bool is_running() const noexcept;
+
+        // removes all nodes, fails if the graph is running
+        bool clear() noexcept;
+
+        // runs all nodes on the scheduler and waits until they are done, rethrows the first exception
+        template <task_scheduler _Sched>
+        bool run(_Sched& _Scheduler) {
+            return _Run(::std::addressof(_Scheduler), &_Schedule_on<_Sched>);
+        }
+
+    private:
+        using _Schedule_fn = task(*)(void*, const task_descriptor&);
+
+        // takes ownership of _Callable, destroys it on failure
+        node_id _Add_node(_Graph_callable* const _Callable, const task_priority _Priority);
+
+        // runs the graph, fails if the graph is already running
+        bool _Run(void* const _Scheduler, const _Schedule_fn _Schedule);
+
+#pragma warning(suppress : 4251) // C4251: _Graph_state needs to have dll-interface
+        unique_smart_ptr<mjsync_impl::_Graph_state> _Mygraph;
+    };
+} // namespace mjx
+
+#endif // _MJSYNC_TASK_GRAPH_HPP_
\ No newline at end of file
@@ -0,0 +1,76 @@
+// task_group.cpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <memory>
+#include <mjmem/object_allocator.hpp>
+#include <mjsync/impl/task_group.hpp>
+#include <mjsync/task_group.hpp>
+
+namespace mjx {
+    task_group::task_group() : _Mystate(::mjx::create_object<mjsync_impl::_Group_state>()) {}
+
+    task_group::task_group(task_group&& _Other) noexcept : _Mystate(_Other._Mystate.release()) {}
+
+    task_group::~task_group() noexcept {
+        if (_Mystate) { // the members refer to the group, wait for them and discard their exceptions
+            try {
+                _Mystate->_Wait();
+            } catch (...) {
+            }
+
+            mjsync_impl::_Group_state::_Release_state(_Mystate.release()); // a member may still be notifying
+        }
+    }
+
+    task_group& task_group::operator=(task_group&& _Other) noexcept {
+        if (this != ::std::addressof(_Other)) {
+            if (_Mystate) { // the old members refer to the old group, wait for them like the destructor does
+                try {
+                    _Mystate->_Wait();
+                } catch (...) {
+                }
+
+                mjsync_impl::_Group_state::_Release_state(_Mystate.release());
+            }
+
+            _Mystate.reset(_Other._Mystate.release());
+        }
+
+        return *this;
+    }
+
+    void task_group::_Run(void* const _Scheduler, const _Schedule_fn _Schedule, _Group_task* const _Task,
+        const task_priority _Priority) noexcept {
+        if (_Mystate) {
+            _Mystate->_Run(_Scheduler, _Schedule, _Task, _Priority);
+        } else { // moved-from group, nothing can join it
+            _Task->_Destroy();
+        }
+    }
+
+    void task_group::wait() {
+        if (_Mystate) {
+            _Mystate->_Wait();
+        }
+    }
+
+    void task_group::cancel() noexcept {
+        if (_Mystate) {
+            _Mystate->_Cancel();
+        }
+    }
+
+    bool task_group::is_canceled() const noexcept {
+        return _Mystate ? _Mystate->_Is_canceled() : false;
+    }
+
+    size_t task_group::pending_tasks() const noexcept {
+        return _Mystate ? _Mystate->_Pending() : 0;
+    }
+
+    stop_token task_group::get_token() const noexcept {
+        return _Mystate ? _Mystate->_Get_token() : stop_token{};
+    }
+} // namespace mjx
\ No newline at end of file
@@ -0,0 +1,135 @@
+// task_group.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _MJSYNC_TASK_GROUP_HPP_
+#define _MJSYNC_TASK_GROUP_HPP_
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mjmem/object_allocator.hpp>
+#include <mjmem/smart_pointer.hpp>
+#include <mjsync/api.hpp>
+#include <mjsync/async.hpp>
+#include <mjsync/stop_token.hpp>
+#include <mjsync/task.hpp>
+#include <mjsync/thread.hpp>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+namespace mjx {
+    namespace mjsync_impl {
+        class _Group_state;
+    } // namespace mjsync_impl
+
+    class _Group_task { // member of a task group, shared by the group and by the scheduled task
+    public:
+        _Group_task() noexcept
+            : _Group(nullptr), _Next(nullptr), _Next_failed(nullptr), _Refs(2), _Claimed(false), _Exception() {}
+
+        virtual ~_Group_task() noexcept {}
+
+        _Group_task(const _Group_task&)            = delete;
+        _Group_task& operator=(const _Group_task&) = delete;
+
+        virtual void _Invoke() = 0;
+        virtual void _Destroy() noexcept = 0;
+
+        mjsync_impl::_Group_state* _Group;
+        _Group_task* _Next; // next member that may not have been claimed yet
+        _Group_task* _Next_failed; // next member that has failed
+        ::std::atomic<uint32_t> _Refs;
+        ::std::atomic<bool> _Claimed; // set by the thread that runs the member, either a worker or a waiter
+        ::std::exception_ptr _Exception;
+    };
+
+    template <class _Fn>
+    class _Group_task_impl : public _Group_task {
+    public:
+        template <class _Fx>
+        explicit _Group_task_impl(_Fx&& _Func) : _Myfunc(::std::forward<_Fx>(_Func)) {}
+
+        void _Invoke() override {
+            ::std::invoke(_Myfunc);
+        }
+
+        void _Destroy() noexcept override {
+            ::mjx::delete_object(this);
+        }
+
+    private:
+        _Fn _Myfunc;
+    };
+
+    class task_group_error : public ::std::exception { // thrown by task_group::wait(), holds all gathered exceptions
+    public:
+        task_group_error(const smart_array<::std::exception_ptr>& _Exceptions, const size_t _Count) noexcept
+            : _Myexceptions(_Exceptions), _Mycount(_Count) {}
+
+        const char* what() const noexcept override {
+            return "one or more tasks of the group have failed";
+        }
+
+        // returns the exceptions thrown by the failed tasks
+        ::std::span<const ::std::exception_ptr> exceptions() const noexcept {
+            return ::std::span<const ::std::exception_ptr>(_Myexceptions.get(), _Mycount);
+        }
+
+    private:
+        smart_array<::std::exception_ptr> _Myexceptions;
+        size_t _Mycount;
+    };
+
+    class _MJSYNC_API task_group { // joins and cancels a dynamic set of tasks at once
+    public:
+        task_group();
+        task_group(task_group&& _Other) noexcept;
+        ~task_group() noexcept;
+
+        task_group& operator=(task_group&& _Other) noexcept;
+
+        task_group(const task_group&)            = delete;
+        task_group& operator=(const task_group&) = delete;
+
+        // schedules the callable as a member of the group, it runs on the waiting thread if scheduling fails
+        template <task_scheduler _Sched, class _Fn>
+        void run(_Sched& _Scheduler, _Fn&& _Func, const task_priority _Priority = task_priority::normal) {
+            _Run(::std::addressof(_Scheduler), &_Schedule_on<_Sched>,
+                ::mjx::create_object<_Group_task_impl<::std::decay_t<_Fn>>>(::std::forward<_Fn>(_Func)), _Priority);
+        }
+
+        // runs the members that have not started yet, then waits for the rest, throws task_group_error
+        // if any member has failed, the group can be reused afterwards, must not be called by a member
+        void wait();
+
+        // skips the members that have not started yet and requests a stop from the running ones
+        void cancel() noexcept;
+
+        // checks if the group has been canceled, a canceled group stays canceled
+        bool is_canceled() const noexcept;
+
+        // returns the number of members that have not finished yet
+        size_t pending_tasks() const noexcept;
+
+        // returns a token that is stopped once the group is canceled
+        stop_token get_token() const noexcept;
+
+    private:
+        using _Schedule_fn = task(*)(void*, const task_descriptor&);
+
+        // takes ownership of _Task
+        void _Run(void* const _Scheduler, const _Schedule_fn _Schedule, _Group_task* const _Task,
+            const task_priority _Priority) noexcept;
+
+#pragma warning(suppress : 4251) // C4251: _Group_state needs to have dll-interface
+        unique_smart_ptr<mjsync_impl::_Group_state> _Mystate;
+    };
+} // namespace mjx
+
+#endif // _MJSYNC_TASK_GROUP_HPP_
\ No newline at end of file
@@ -4,6 +4,7 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include <mjmem/object_allocator.hpp>
+#include <mjsync/impl/platform.hpp>
 #include <mjsync/impl/thread.hpp>
 #include <mjsync/thread.hpp>
 #include <type_traits>
@@ -55,13 +56,11 @@ namespace mjx {
             return false;
         }
 
-        void* const _Handle = _Myimpl->_Handle;
-        if (mjsync_impl::_Set_thread_name_preferred(_Handle, _Name)) { // preferred solution succeeded
-            return true;
-        }
+        return mjsync_impl::_Set_thread_name(_Myimpl->_Handle, _Name);
+    }
 
-        // preferred solution failed, use fallback solution
-        return mjsync_impl::_Set_thread_name_fallback(_Handle, _Name);
+    bool thread::set_affinity(const processor_info& _Proc) noexcept {
+        return _Myimpl ? mjsync_impl::_Set_thread_affinity(_Myimpl->_Handle, _Proc) : false;
     }
 
     void thread::cancel_all_pending_tasks() noexcept {
@@ -70,28 +69,122 @@ namespace mjx {
         }
     }
 
-    task thread::schedule_task(
-        const callable _Callable, void* const _Arg, const task_priority _Priority, const bool _Resume) {
+    thread::idle_policy thread::get_idle_policy() const noexcept {
         if (!_Myimpl) {
-            return task{};
+            return idle_policy{};
+        }
+
+        return idle_policy{_Myimpl->_Cache._Spin_rounds.load(::std::memory_order_relaxed),
+            _Myimpl->_Cache._Yield_rounds.load(::std::memory_order_relaxed)};
+    }
+
+    void thread::set_idle_policy(const idle_policy& _Policy) noexcept {
+        if (_Myimpl) {
+            _Myimpl->_Cache._Spin_rounds.store(_Policy.spin_rounds, ::std::memory_order_relaxed);
+            _Myimpl->_Cache._Yield_rounds.store(_Policy.yield_rounds, ::std::memory_order_relaxed);
+        }
+    }
+
+    thread::idle_statistics thread::collect_idle_statistics() const noexcept {
+        if (!_Myimpl) {
+            return idle_statistics{};
+        }
+
+        return idle_statistics{_Myimpl->_Cache._Spin_wakeups.load(::std::memory_order_relaxed),
+            _Myimpl->_Cache._Yield_wakeups.load(::std::memory_order_relaxed),
+            _Myimpl->_Cache._Park_wakeups.load(::std::memory_order_relaxed)};
+    }
+
+    thread::scheduling_policy thread::get_scheduling_policy() const noexcept {
+        return _Myimpl ? _Myimpl->_Cache._Queue._Policy() : scheduling_policy{};
+    }
+
+    bool thread::set_scheduling_policy(const scheduling_policy& _Policy) noexcept {
+        if (!_Myimpl || (_Policy.mode == scheduling_mode::aging && _Policy.aging_interval.count() <= 0)) {
+            return false;
+        }
+
+        _Myimpl->_Cache._Queue._Set_policy(_Policy);
+        return true;
+    }
+
+    uint64_t thread::missed_deadlines() const noexcept {
+        return _Myimpl ? _Myimpl->_Cache._Missed_deadlines.load(::std::memory_order_relaxed) : 0;
+    }
+
+    thread::task_metrics thread::collect_task_metrics() const noexcept {
+        task_metrics _Result;
+#if MJSYNC_TASK_METRICS
+        if (_Myimpl) {
+            _Myimpl->_Cache._Metrics._Queue_wait._Snapshot(_Result.queue_wait);
+            _Myimpl->_Cache._Metrics._Run_time._Snapshot(_Result.run_time);
         }
+#endif // MJSYNC_TASK_METRICS
+        return _Result;
+    }
+
+    task thread::schedule_task(
+        const callable _Callable, void* const _Arg, const task_priority _Priority, const bool _Resume) {
+        return schedule_task(task_descriptor{_Callable, _Arg, _Priority}, _Resume);
+    }
+
+    task thread::schedule_task(const callable _Callable, void* const _Arg,
+        const ::std::chrono::steady_clock::time_point _Deadline, const task_priority _Priority, const bool _Resume) {
+        return schedule_task(task_descriptor{_Callable, _Arg, _Priority, nullptr, nullptr, _Deadline}, _Resume);
+    }
 
-        const thread_state _State = _Myimpl->_Get_state();
-        if (_State == thread_state::terminated) { // scheduling inactive, breaj
+    task thread::schedule_task(const task_descriptor& _Desc, const bool _Resume) {
+        if (!_Myimpl || _Myimpl->_Get_state() == thread_state::terminated) { // scheduling inactive, break
             return task{};
         }
 
-        const task::id _New_id = _Myimpl->_Cache._Counter._Next_id();
-        _Myimpl->_Cache._Queue._Enqueue(mjsync_impl::_Queued_task(_New_id, _Callable, _Arg, _Priority));
-        task _New_task(_New_id, this);
-        if (_State == thread_state::waiting && _Resume) { // resume the thread
-            _Myimpl->_Set_state(thread_state::working);
-            _Myimpl->_Cache._State_event.notify();
+        mjsync_impl::_Queued_task* const _Task = mjsync_impl::_Get_task_table()._Acquire(_Desc);
+        task _New_task(_Task->_Get_id());
+        _Myimpl->_Cache._Queue._Enqueue(_Task);
+        if (_Resume) { // resume the thread if it is waiting, the state must be checked after enqueuing
+            _Myimpl->_Resume_if_waiting();
         }
 
         return _New_task;
     }
 
+    size_t thread::schedule_tasks(
+        ::std::span<const task_descriptor> _Descs, ::std::span<task> _Tasks, const bool _Resume) {
+        if (!_Myimpl || _Descs.empty()) {
+            return 0;
+        }
+
+        if (_Myimpl->_Get_state() == thread_state::terminated) { // scheduling inactive, break
+            return 0;
+        }
+
+        mjsync_impl::_Task_table& _Table = mjsync_impl::_Get_task_table();
+        mjsync_impl::_Task_batch _Batch;
+        size_t _Count = 0;
+        try {
+            for (; _Count < _Descs.size(); ++_Count) {
+                mjsync_impl::_Queued_task* const _Task = _Table._Acquire(_Descs[_Count]);
+                if (_Count < _Tasks.size()) {
+                    _Tasks[_Count] = task(_Task->_Get_id());
+                } else { // no room for the handle, drop its reference
+                    _Table._Release(_Task);
+                }
+
+                _Batch._Push(_Task);
+            }
+        } catch (...) {
+            _Batch._Cancel_all(); // nothing has been published yet, cancel the acquired tasks
+            throw;
+        }
+
+        _Myimpl->_Cache._Queue._Enqueue(_Batch);
+        if (_Resume) { // resume the thread once for the whole batch
+            _Myimpl->_Resume_if_waiting();
+        }
+
+        return _Count;
+    }
+
     bool thread::suspend() noexcept {
         if (!_Myimpl || _Myimpl->_Get_state() != thread_state::working) { // wrong state, break
             return false;
@@ -118,12 +211,7 @@ namespace mjx {
             return false;
         }
 
-        if (_Myimpl->_Exchange_state(thread_state::terminated) == thread_state::waiting) {
-            // the thread is waiting, notify it
-            _Myimpl->_Cache._State_event.notify();
-        }
-        
-        _Myimpl->_Cache._Termination_event.wait_and_reset(); // wait until terminated
+        _Myimpl->_Stop(); // wait until terminated
         _Myimpl.reset();
         return true;
     }
@@ -135,16 +223,16 @@ namespace mjx {
 
     thread::id current_thread_id() noexcept {
         // retrieve the thread identifier of the calling thread
-        return ::GetCurrentThreadId();
+        return mjsync_impl::_Current_thread_id();
     }
 
     void yield_current_thread() noexcept {
         // yield execution to another thread that is ready to run on the current processor
-        ::SwitchToThread();
+        mjsync_impl::_Yield_thread();
     }
 
     void sleep_for(const uintmax_t _Duration) noexcept {
         // suspend the execution of the current thread until the time-out interval elapses
-        ::Sleep(static_cast<unsigned long>(_Duration));
+        mjsync_impl::_Sleep_thread(_Duration);
     }
 } // namespace mjx
\ No newline at end of file
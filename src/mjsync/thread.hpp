@@ -6,13 +6,19 @@
 #pragma once
 #ifndef _MJSYNC_THREAD_HPP_
 #define _MJSYNC_THREAD_HPP_
+#include <chrono>
+#include <cstdint>
 #include <mjmem/smart_pointer.hpp>
 #include <mjsync/api.hpp>
+#include <mjsync/latency_histogram.hpp>
 #include <mjsync/task.hpp>
+#include <mjsync/topology.hpp>
+#include <span>
 
 namespace mjx {
     namespace mjsync_impl {
         class _Thread_impl;
+        class _Thread_list;
     } // namespace mjsync_impl
 
     enum class thread_state : unsigned char {
@@ -21,12 +27,56 @@ namespace mjx {
         working
     };
 
+    enum class scheduling_mode : unsigned char {
+        strict_priority, // the highest priority always goes first, lower priorities may starve
+        aging, // waiting tasks gain one priority level per aging interval
+        earliest_deadline_first // tasks with a deadline go first, the earliest one first, the rest by priority
+    };
+
+    struct task_descriptor { // describes a task to be scheduled
+        void (*callable)(void*) = nullptr;
+        void* arg               = nullptr;
+        task_priority priority  = task_priority::normal;
+        void (*deleter)(void*)  = nullptr; // if set, called with arg once the task is done with it
+
+        // if set, constructs the argument from arg in the task's inline storage (task::inline_storage_size bytes)
+        // and returns it, the returned pointer is then passed to callable and deleter instead of arg
+        void* (*emplace)(void*, void*) = nullptr;
+
+        // if set, the time by which the task should finish, ordered by it in the earliest-deadline-first mode
+        ::std::chrono::steady_clock::time_point deadline{};
+
+        // if set, names the task in traces, the string must outlive the trace
+        const char* label = nullptr;
+    };
+
     class _MJSYNC_API thread {
     public:
         using native_handle_type = void*;
         using id                 = unsigned int;
         using callable           = void(*)(void*);
 
+        struct idle_policy { // controls how an idle thread waits for new tasks before it parks itself
+            uint32_t spin_rounds  = 64; // polls separated by an exponentially growing pause
+            uint32_t yield_rounds = 16; // polls separated by yielding the processor
+        };
+
+        struct scheduling_policy { // controls the order in which the pending tasks run
+            scheduling_mode mode = scheduling_mode::strict_priority;
+            ::std::chrono::milliseconds aging_interval{100}; // waiting time per gained level, used by aging only
+        };
+
+        struct idle_statistics { // number of idle periods that ended in each phase
+            uint64_t spin_wakeups  = 0;
+            uint64_t yield_wakeups = 0;
+            uint64_t park_wakeups  = 0;
+        };
+
+        struct task_metrics { // latencies of the executed tasks, empty unless built with MJSYNC_TASK_METRICS
+            latency_histogram queue_wait; // from enqueue to the start of the execution
+            latency_histogram run_time; // from the start to the end of the execution
+        };
+
         thread();
         thread(thread&& _Other) noexcept;
         ~thread() noexcept;
@@ -56,12 +106,42 @@ namespace mjx {
         // changes the thread's name
         bool set_name(const char* const _Name) noexcept;
 
+        // pins the thread to the logical processor
+        bool set_affinity(const processor_info& _Proc) noexcept;
+
         // cancels all pending tasks
         void cancel_all_pending_tasks() noexcept;
 
+        // returns or changes how the thread waits for new tasks
+        idle_policy get_idle_policy() const noexcept;
+        void set_idle_policy(const idle_policy& _Policy) noexcept;
+
+        // collects the number of idle periods that ended in each phase
+        idle_statistics collect_idle_statistics() const noexcept;
+
+        // returns or changes the order of the pending tasks, fails if the policy is invalid
+        scheduling_policy get_scheduling_policy() const noexcept;
+        bool set_scheduling_policy(const scheduling_policy& _Policy) noexcept;
+
+        // returns the number of tasks that finished after their deadline
+        uint64_t missed_deadlines() const noexcept;
+
+        // collects the queue-wait and run-time latencies of the executed tasks
+        task_metrics collect_task_metrics() const noexcept;
+
         // schedules a new task
         task schedule_task(const callable _Callable, void* const _Arg,
             const task_priority _Priority = task_priority::normal, const bool _Resume = true);
+        task schedule_task(const task_descriptor& _Desc, const bool _Resume = true);
+
+        // schedules a new task that should finish by the deadline
+        task schedule_task(const callable _Callable, void* const _Arg,
+            const ::std::chrono::steady_clock::time_point _Deadline,
+            const task_priority _Priority = task_priority::normal, const bool _Resume = true);
+
+        // schedules multiple tasks at once, stores up to _Tasks.size() handles and returns the number of tasks
+        size_t schedule_tasks(::std::span<const task_descriptor> _Descs,
+            ::std::span<task> _Tasks = {}, const bool _Resume = true);
 
         // suspends the thread
         bool suspend() noexcept;
@@ -73,7 +153,7 @@ namespace mjx {
         bool terminate() noexcept;
 
     private:
-        friend task;
+        friend mjsync_impl::_Thread_list;
 
 #pragma warning(suppress : 4251) // C4251: _Thread_impl needs to have dll-interface
         unique_smart_ptr<mjsync_impl::_Thread_impl> _Myimpl;
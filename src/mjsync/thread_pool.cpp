@@ -3,22 +3,23 @@
 // Copyright (c) Mateusz Jandura. All rights reserved.
 // SPDX-License-Identifier: Apache-2.0
 
+#include <algorithm>
 #include <mjsync/impl/thread_pool.hpp>
 #include <mjsync/impl/utils.hpp>
+#include <mjsync/srwlock.hpp>
 #include <mjsync/thread_pool.hpp>
 
 namespace mjx {
     thread_pool::thread_pool() noexcept : _Mylist(nullptr), _Mystate(_Closed) {}
 
     thread_pool::thread_pool(thread_pool&& _Other) noexcept
-        : _Mylist(_Other._Mylist.release()), _Mystate(_Other._Mystate) {
-        _Other._Mystate = _Closed;
-    }
+        : _Mylist(_Other._Mylist.release()), _Mystate(_Other._Mystate.exchange(_Closed, ::std::memory_order_relaxed)) {}
 
-    thread_pool::thread_pool(const size_t _Count) : _Mylist(nullptr), _Mystate(_Closed) {
+    thread_pool::thread_pool(const size_t _Count, const thread_placement _Placement)
+        : _Mylist(nullptr), _Mystate(_Closed) {
         if (_Count > 0) { // requested non-empty pool, re-initialize
-            _Mylist.reset(::mjx::create_object<mjsync_impl::_Thread_list>(_Count));
-            _Mystate = _Working;
+            _Mylist.reset(::mjx::create_object<mjsync_impl::_Thread_list>(_Count, _Placement));
+            _Mystate.store(_Working, ::std::memory_order_relaxed);
         }
     }
 
@@ -29,58 +30,82 @@ namespace mjx {
     thread_pool& thread_pool::operator=(thread_pool&& _Other) noexcept {
         if (this != ::std::addressof(_Other)) {
             _Mylist.reset(_Other._Mylist.release());
-            _Mystate        = _Other._Mystate;
-            _Other._Mystate = _Closed;
+            _Mystate.store(_Other._Mystate.exchange(_Closed, ::std::memory_order_relaxed), ::std::memory_order_relaxed);
         }
 
         return *this;
     }
 
     thread* thread_pool::_Select_ideal_thread() noexcept {
-        if (_Mystate == _Waiting) { // all threads are waiting, choose the one with the fewest pending tasks
-            return _Mylist->_Select_thread_with_fewest_pending_tasks();
+        // prefer the threads on the caller's NUMA node, if the threads are placed,
+        // the caller must stay within a read-side section until it is done with the selected thread
+        const uint32_t _Node = _Mylist->_Current_node();
+        if (_Mystate.load(::std::memory_order_relaxed) == _Waiting) {
+            // all threads are waiting, choose the one with the fewest pending tasks
+            return _Mylist->_Select_thread_with_fewest_pending_tasks(_Node);
         } else {
-            thread* const _Thread = _Mylist->_Select_any_waiting_thread();
+            thread* const _Thread = _Mylist->_Select_any_waiting_thread(_Node);
             if (_Thread) { // waiting thread found, select it
                 return _Thread;
             } else { // no thread is waiting, choose the thread with the fewest pending tasks
-                return _Mylist->_Select_thread_with_fewest_pending_tasks();
+                return _Mylist->_Select_thread_with_fewest_pending_tasks(_Node);
             }
         }
     }
     
     bool thread_pool::is_open() const noexcept {
-        return _Mystate != _Closed;
+        return _Mystate.load(::std::memory_order_relaxed) != _Closed;
     }
 
     bool thread_pool::is_waiting() const noexcept {
-        return _Mystate == _Waiting;
+        return _Mystate.load(::std::memory_order_relaxed) == _Waiting;
     }
 
     bool thread_pool::is_working() const noexcept {
-        return _Mystate == _Working;
+        return _Mystate.load(::std::memory_order_relaxed) == _Working;
     }
 
     void thread_pool::close() noexcept {
-        if (_Mystate != _Closed) {
-            _Mystate = _Closed;
+        // Note: The threads are destroyed at once, so the pool must not be closed or destroyed
+        //       while other threads may still schedule tasks to it.
+        if (_Mystate.exchange(_Closed, ::std::memory_order_acq_rel) != _Closed) {
             _Mylist.reset();
         }
     }
 
     bool thread_pool::is_thread_in_pool(const thread::id _Id) const noexcept {
-        return _Mylist ? _Mylist->_Is_thread_present(_Id) : false;
+        if (!_Mylist) {
+            return false;
+        }
+
+        mjsync_impl::_Epoch_guard _Guard(_Mylist->_Epoch());
+        return _Mylist->_Is_thread_present(_Id);
     }
 
     thread_pool::statistics thread_pool::collect_statistics() const noexcept {
-        if (_Mystate == _Closed) {
+        if (_Mystate.load(::std::memory_order_relaxed) == _Closed) {
             return statistics{};
         }
 
         statistics _Result;
+        _Result.missed_deadlines = _Mylist->_Retired_missed_deadlines();
+#if MJSYNC_TASK_METRICS
+        _Mylist->_Retired_task_metrics(_Result.queue_wait, _Result.run_time);
+#endif // MJSYNC_TASK_METRICS
+        mjsync_impl::_Epoch_guard _Guard(_Mylist->_Epoch());
         _Mylist->_For_each_thread(
             [&_Result](thread& _Thread) noexcept {
-                _Result.pending_tasks += _Thread.pending_tasks();
+                const thread::idle_statistics _Idle = _Thread.collect_idle_statistics();
+                _Result.pending_tasks    += _Thread.pending_tasks();
+                _Result.spin_wakeups     += _Idle.spin_wakeups;
+                _Result.yield_wakeups    += _Idle.yield_wakeups;
+                _Result.park_wakeups     += _Idle.park_wakeups;
+                _Result.missed_deadlines += _Thread.missed_deadlines();
+#if MJSYNC_TASK_METRICS
+                const thread::task_metrics _Metrics = _Thread.collect_task_metrics();
+                _Result.queue_wait.merge(_Metrics.queue_wait);
+                _Result.run_time.merge(_Metrics.run_time);
+#endif // MJSYNC_TASK_METRICS
                 if (_Thread.state() == thread_state::waiting) {
                     ++_Result.waiting_threads;
                 } else {
@@ -92,7 +117,8 @@ namespace mjx {
     }
 
     void thread_pool::cancel_all_pending_tasks() noexcept {
-        if (_Mystate != _Closed) { // must not be closed
+        if (_Mystate.load(::std::memory_order_relaxed) != _Closed) { // must not be closed
+            mjsync_impl::_Epoch_guard _Guard(_Mylist->_Epoch());
             _Mylist->_For_each_thread(
                 [](thread& _Thread) noexcept {
                     _Thread.cancel_all_pending_tasks();
@@ -102,16 +128,16 @@ namespace mjx {
     }
 
     void thread_pool::increase_thread_count(const size_t _Count) {
-        if (_Mystate != _Closed) {
+        if (_Mystate.load(::std::memory_order_relaxed) != _Closed) {
             _Mylist->_Grow(_Count);
         }
     }
 
     void thread_pool::decrease_thread_count(const size_t _Count) noexcept {
-        if (_Mystate != _Closed) {
+        if (_Mystate.load(::std::memory_order_relaxed) != _Closed) {
             if (_Count >= _Mylist->_Size()) { // remove all threads
                 _Mylist->_Clear();
-                _Mystate = _Closed;
+                _Mystate.store(_Closed, ::std::memory_order_relaxed);
             } else { // remove some threads
                 _Mylist->_Reduce(_Count);
             }
@@ -123,7 +149,7 @@ namespace mjx {
     }
 
     void thread_pool::thread_count(const size_t _New_count) {
-        if (_Mystate != _Closed) {
+        if (_Mystate.load(::std::memory_order_relaxed) != _Closed) {
             const size_t _Count = _Mylist->_Size();
             if (_New_count > _Count) { // increase the number of threads
                 increase_thread_count(_New_count - _Count);
@@ -133,23 +159,175 @@ namespace mjx {
         }
     }
 
+    bool thread_pool::enable_auto_scaling(const scaling_policy& _Policy) {
+        if (_Mystate.load(::std::memory_order_relaxed) == _Closed) {
+            return false;
+        }
+
+        return _Mylist->_Enable_scaling(_Policy);
+    }
+
+    void thread_pool::disable_auto_scaling() noexcept {
+        if (_Mystate.load(::std::memory_order_relaxed) != _Closed) {
+            _Mylist->_Disable_scaling();
+        }
+    }
+
+    bool thread_pool::is_auto_scaling() const noexcept {
+        return _Mylist ? _Mylist->_Is_scaling() : false;
+    }
+
+    thread_placement thread_pool::placement() const noexcept {
+        return _Mylist ? _Mylist->_Placement() : thread_placement::none;
+    }
+
+    bool thread_pool::work_stealing() const noexcept {
+        return _Mylist ? _Mylist->_Is_stealing_enabled() : false;
+    }
+
+    void thread_pool::work_stealing(const bool _Enabled) noexcept {
+        if (_Mystate.load(::std::memory_order_relaxed) != _Closed) {
+            _Mylist->_Enable_stealing(_Enabled);
+        }
+    }
+
+    thread::idle_policy thread_pool::get_idle_policy() const noexcept {
+        return _Mylist ? _Mylist->_Idle_policy() : thread::idle_policy{};
+    }
+
+    void thread_pool::set_idle_policy(const thread::idle_policy& _Policy) noexcept {
+        if (_Mystate.load(::std::memory_order_relaxed) != _Closed) {
+            _Mylist->_Set_idle_policy(_Policy);
+        }
+    }
+
+    thread::scheduling_policy thread_pool::get_scheduling_policy() const noexcept {
+        return _Mylist ? _Mylist->_Scheduling_policy() : thread::scheduling_policy{};
+    }
+
+    bool thread_pool::set_scheduling_policy(const thread::scheduling_policy& _Policy) noexcept {
+        if (_Mystate.load(::std::memory_order_relaxed) == _Closed
+            || (_Policy.mode == scheduling_mode::aging && _Policy.aging_interval.count() <= 0)) {
+            return false;
+        }
+
+        _Mylist->_Set_scheduling_policy(_Policy);
+        return true;
+    }
+
     task thread_pool::schedule_task(
         const thread::callable _Callable, void* const _Arg, const task_priority _Priority) {
-        if (_Mystate == _Closed) { // scheduling inactive
+        return schedule_task(task_descriptor{_Callable, _Arg, _Priority});
+    }
+
+    task thread_pool::schedule_task(const thread::callable _Callable, void* const _Arg,
+        const ::std::chrono::steady_clock::time_point _Deadline, const task_priority _Priority) {
+        return schedule_task(task_descriptor{_Callable, _Arg, _Priority, nullptr, nullptr, _Deadline});
+    }
+
+    task thread_pool::schedule_task(const task_descriptor& _Desc) {
+        if (_Mystate.load(::std::memory_order_relaxed) == _Closed) { // scheduling inactive
             return task{};
         }
 
+        mjsync_impl::_Epoch_guard _Guard(_Mylist->_Epoch());
         thread* const _Thread = _Select_ideal_thread();
-        return _Thread ? _Thread->schedule_task(_Callable, _Arg, _Priority) : task{};
+        return _Thread ? _Thread->schedule_task(_Desc) : task{};
+    }
+
+    size_t thread_pool::schedule_tasks(::std::span<const task_descriptor> _Descs, ::std::span<task> _Tasks) {
+        if (_Mystate.load(::std::memory_order_relaxed) == _Closed
+            || _Descs.empty()) { // scheduling inactive or nothing to schedule
+            return 0;
+        }
+
+        // split the batch into contiguous chunks, one per thread, so that each queue is locked
+        // and each thread is woken up only once, the threads may be added or removed meanwhile,
+        // whatever is left is scheduled to a single thread
+        mjsync_impl::_Epoch_guard _Guard(_Mylist->_Epoch());
+        const size_t _Thread_count = (::std::max)(_Mylist->_Size(), size_t{1});
+        const size_t _Chunk_size   = (_Descs.size() + _Thread_count - 1) / _Thread_count;
+        size_t _Offset             = 0;
+        size_t _Count              = 0;
+        _Mylist->_For_each_thread(
+            [&](thread& _Thread) {
+                if (_Offset >= _Descs.size()) { // everything has been distributed
+                    return;
+                }
+
+                const size_t _Size = (::std::min)(_Chunk_size, _Descs.size() - _Offset);
+                ::std::span<task> _Handles;
+                if (_Offset < _Tasks.size()) { // some handles requested for this chunk
+                    _Handles = _Tasks.subspan(_Offset, (::std::min)(_Size, _Tasks.size() - _Offset));
+                }
+
+                _Count  += _Thread.schedule_tasks(_Descs.subspan(_Offset, _Size), _Handles);
+                _Offset += _Size;
+            }
+        );
+        if (_Offset < _Descs.size()) { // some threads have been removed meanwhile
+            thread* const _Thread = _Select_ideal_thread();
+            if (_Thread) {
+                _Count += _Thread->schedule_tasks(
+                    _Descs.subspan(_Offset), _Offset < _Tasks.size() ? _Tasks.subspan(_Offset) : ::std::span<task>{});
+            }
+        }
+
+        return _Count;
+    }
+
+    thread_pool::timer_id thread_pool::schedule_after(const ::std::chrono::milliseconds _Delay,
+        const thread::callable _Callable, void* const _Arg, const task_priority _Priority) {
+        return schedule_at(::std::chrono::steady_clock::now() + (::std::max)(_Delay, ::std::chrono::milliseconds{0}),
+            _Callable, _Arg, _Priority);
+    }
+
+    thread_pool::timer_id thread_pool::schedule_at(const ::std::chrono::steady_clock::time_point _Time,
+        const thread::callable _Callable, void* const _Arg, const task_priority _Priority) {
+        if (_Mystate.load(::std::memory_order_relaxed) == _Closed) { // scheduling inactive
+            return invalid_timer;
+        }
+
+        mjsync_impl::_Timer_wheel& _Wheel = _Mylist->_Create_timers();
+        return _Wheel._Add(_Wheel._Ticks_until(_Time), 0, _Callable, _Arg, _Priority);
+    }
+
+    thread_pool::timer_id thread_pool::schedule_every(const ::std::chrono::milliseconds _Period,
+        const thread::callable _Callable, void* const _Arg, const task_priority _Priority) {
+        if (_Mystate.load(::std::memory_order_relaxed) == _Closed
+            || _Period.count() <= 0) { // scheduling inactive or invalid period
+            return invalid_timer;
+        }
+
+        mjsync_impl::_Timer_wheel& _Wheel = _Mylist->_Create_timers();
+        const uint64_t _Ticks             = static_cast<uint64_t>(_Period.count());
+        return _Wheel._Add(
+            _Wheel._Ticks_until(::std::chrono::steady_clock::now() + _Period), _Ticks, _Callable, _Arg, _Priority);
+    }
+
+    bool thread_pool::cancel_timer(const timer_id _Id) noexcept {
+        mjsync_impl::_Timer_wheel* const _Wheel = _Mylist ? _Mylist->_Timers() : nullptr;
+        return _Wheel ? _Wheel->_Cancel(_Id) : false;
+    }
+
+    size_t thread_pool::pending_timers() const noexcept {
+        mjsync_impl::_Timer_wheel* const _Wheel = _Mylist ? _Mylist->_Timers() : nullptr;
+        return _Wheel ? _Wheel->_Size() : 0;
+    }
+
+    schedule_awaitable thread_pool::schedule(const task_priority _Priority) noexcept {
+        return ::mjx::schedule(*this, _Priority);
     }
 
     bool thread_pool::suspend() noexcept {
-        if (_Mystate != _Working) { // must be working
+        _Internal_state _Expected = _Working;
+        if (!_Mystate.compare_exchange_strong(_Expected, _Waiting, ::std::memory_order_acq_rel)) { // must be working
             return false;
         }
 
-        _Mystate      = _Waiting;
         bool _Success = true;
+        _Mylist->_Pause_scaling(true);
+        mjsync_impl::_Epoch_guard _Guard(_Mylist->_Epoch());
         _Mylist->_For_each_thread( // suspend as many threads, as possible
             [&_Success](thread& _Thread) noexcept {
                 if (!_Thread.suspend()) {
@@ -161,19 +339,24 @@ namespace mjx {
     }
 
     bool thread_pool::resume() noexcept {
-        if (_Mystate != _Waiting) { // must be waiting
+        _Internal_state _Expected = _Waiting;
+        if (!_Mystate.compare_exchange_strong(_Expected, _Working, ::std::memory_order_acq_rel)) { // must be waiting
             return false;
         }
 
-        _Mystate      = _Working;
         bool _Success = true;
-        _Mylist->_For_each_thread( // resume as many threads, as possible
-            [&_Success](thread& _Thread) noexcept {
-                if (!_Thread.resume()) {
-                    _Success = false;
+        {
+            mjsync_impl::_Epoch_guard _Guard(_Mylist->_Epoch());
+            _Mylist->_For_each_thread( // resume as many threads, as possible
+                [&_Success](thread& _Thread) noexcept {
+                    if (!_Thread.resume()) {
+                        _Success = false;
+                    }
                 }
-            }
-        );
+            );
+        }
+
+        _Mylist->_Pause_scaling(false);
         return _Success;
     }
 } // namespace mjx
\ No newline at end of file
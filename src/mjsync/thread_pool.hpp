@@ -6,19 +6,34 @@
 #pragma once
 #ifndef _MJSYNC_THREAD_POOL_HPP_
 #define _MJSYNC_THREAD_POOL_HPP_
+#include <atomic>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <mjmem/smart_pointer.hpp>
 #include <mjsync/api.hpp>
+#include <mjsync/coroutine.hpp>
+#include <mjsync/latency_histogram.hpp>
 #include <mjsync/task.hpp>
 #include <mjsync/thread.hpp>
+#include <span>
 
 namespace mjx {
     namespace mjsync_impl {
         class _Thread_list;
     } // namespace mjsync_impl
 
+    enum class thread_placement : unsigned char {
+        none, // threads run on any processor
+        numa_aware // threads are pinned to cores and grouped by NUMA node
+    };
+
     class _MJSYNC_API thread_pool {
     public:
+        using timer_id = uint64_t;
+
+        static constexpr timer_id invalid_timer = 0;
+
         thread_pool() noexcept;
         thread_pool(thread_pool&& _Other) noexcept;
         ~thread_pool() noexcept;
@@ -26,7 +41,7 @@ namespace mjx {
         thread_pool(const thread_pool&)            = delete;
         thread_pool& operator=(const thread_pool&) = delete;
 
-        explicit thread_pool(const size_t _Count);
+        explicit thread_pool(const size_t _Count, const thread_placement _Placement = thread_placement::none);
 
         thread_pool& operator=(thread_pool&& _Other) noexcept;
 
@@ -39,19 +54,25 @@ namespace mjx {
         // checks if the thread-pool is working
         bool is_working() const noexcept;
 
-        // closes the thread-pool
+        // closes the thread-pool, must not race with the threads that schedule tasks to it
         void close() noexcept;
 
         // checks if the thread is in the thread-pool
         bool is_thread_in_pool(const thread::id _Id) const noexcept;
 
         struct statistics {
-            size_t waiting_threads = 0;
-            size_t working_threads = 0;
-            size_t pending_tasks   = 0;
+            size_t waiting_threads    = 0;
+            size_t working_threads    = 0;
+            size_t pending_tasks      = 0;
+            uint64_t spin_wakeups     = 0; // idle periods that ended while spinning
+            uint64_t yield_wakeups    = 0; // idle periods that ended while yielding
+            uint64_t park_wakeups     = 0; // idle periods that ended after parking
+            uint64_t missed_deadlines = 0; // tasks that finished after their deadline
+            latency_histogram queue_wait; // empty unless built with MJSYNC_TASK_METRICS
+            latency_histogram run_time; // empty unless built with MJSYNC_TASK_METRICS
         };
 
-        // collects the thread-pool's statistics
+        // collects the thread-pool's statistics, including the task latencies of the retired threads
         statistics collect_statistics() const noexcept;
 
         // cancels all pending tasks
@@ -67,9 +88,72 @@ namespace mjx {
         size_t thread_count() const noexcept;
         void thread_count(const size_t _New_count);
 
+        // returns the placement of the threads, none if the topology is not available
+        thread_placement placement() const noexcept;
+
+        // checks or changes whether idle threads steal pending tasks from busy ones
+        bool work_stealing() const noexcept;
+        void work_stealing(const bool _Enabled) noexcept;
+
+        struct scaling_policy {
+            size_t min_threads     = 1;
+            size_t max_threads     = 0; // zero selects hardware_concurrency()
+            size_t max_queue_depth = 32; // pending tasks per thread above which the pool grows, zero ignores
+            ::std::chrono::milliseconds max_queue_age{20}; // how long a queue may not progress, zero ignores
+            ::std::chrono::milliseconds keep_alive{10'000}; // how long a thread may idle before it is retired
+            ::std::chrono::milliseconds sample_interval{5}; // how often the pool is inspected
+        };
+
+        // enables automatic scaling or replaces its policy, fails if the policy is invalid
+        bool enable_auto_scaling(const scaling_policy& _Policy);
+
+        // disables automatic scaling, the current threads are kept
+        void disable_auto_scaling() noexcept;
+
+        // checks if the number of threads is adjusted automatically
+        bool is_auto_scaling() const noexcept;
+
+        // returns or changes how idle threads wait for new tasks
+        thread::idle_policy get_idle_policy() const noexcept;
+        void set_idle_policy(const thread::idle_policy& _Policy) noexcept;
+
+        // returns or changes the order of the pending tasks of all threads, fails if the policy is invalid
+        thread::scheduling_policy get_scheduling_policy() const noexcept;
+        bool set_scheduling_policy(const thread::scheduling_policy& _Policy) noexcept;
+
         // schedules a new task
         task schedule_task(const thread::callable _Callable, void* const _Arg,
             const task_priority _Priority = task_priority::normal);
+        task schedule_task(const task_descriptor& _Desc);
+
+        // schedules a new task that should finish by the deadline
+        task schedule_task(const thread::callable _Callable, void* const _Arg,
+            const ::std::chrono::steady_clock::time_point _Deadline,
+            const task_priority _Priority = task_priority::normal);
+
+        // schedules multiple tasks at once, stores up to _Tasks.size() handles and returns the number of tasks
+        size_t schedule_tasks(::std::span<const task_descriptor> _Descs, ::std::span<task> _Tasks = {});
+
+        // schedules a task that runs once the delay elapses
+        timer_id schedule_after(const ::std::chrono::milliseconds _Delay, const thread::callable _Callable,
+            void* const _Arg, const task_priority _Priority = task_priority::normal);
+
+        // schedules a task that runs at the specified time
+        timer_id schedule_at(const ::std::chrono::steady_clock::time_point _Time, const thread::callable _Callable,
+            void* const _Arg, const task_priority _Priority = task_priority::normal);
+
+        // schedules a task that runs repeatedly, the first time once the period elapses
+        timer_id schedule_every(const ::std::chrono::milliseconds _Period, const thread::callable _Callable,
+            void* const _Arg, const task_priority _Priority = task_priority::normal);
+
+        // cancels the timer, fails if it has already fired or has been canceled
+        bool cancel_timer(const timer_id _Id) noexcept;
+
+        // returns the number of armed timers
+        size_t pending_timers() const noexcept;
+
+        // returns an awaitable that resumes the awaiting coroutine on one of the threads
+        schedule_awaitable schedule(const task_priority _Priority = task_priority::normal) noexcept;
 
         // suspends all threads
         bool suspend() noexcept;
@@ -89,7 +173,8 @@ namespace mjx {
 
 #pragma warning(suppress : 4251) // C4251: _Thread_list needs to have dll-interface
         unique_smart_ptr<mjsync_impl::_Thread_list> _Mylist;
-        _Internal_state _Mystate;
+#pragma warning(suppress : 4251) // C4251: ::std::atomic<_Internal_state> needs to have dll-interface
+        ::std::atomic<_Internal_state> _Mystate;
     };
 } // namespace mjx
 
@@ -0,0 +1,101 @@
+// topology.cpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <algorithm>
+#include <memory>
+#include <mjmem/object_allocator.hpp>
+#include <mjsync/impl/topology.hpp>
+#include <mjsync/topology.hpp>
+
+namespace mjx {
+    processor_topology::processor_topology() noexcept
+        : _Myprocs(nullptr), _Mysize(0), _Mycores(0), _Mynodes(0) {}
+
+    processor_topology::processor_topology(processor_topology&& _Other) noexcept
+        : _Myprocs(_Other._Myprocs), _Mysize(_Other._Mysize),
+        _Mycores(_Other._Mycores), _Mynodes(_Other._Mynodes) {
+        _Other._Myprocs = nullptr;
+        _Other._Mysize  = 0;
+        _Other._Mycores = 0;
+        _Other._Mynodes = 0;
+    }
+
+    processor_topology::~processor_topology() noexcept {
+        if (_Myprocs) {
+            ::mjx::delete_object_array(_Myprocs, _Mysize);
+        }
+    }
+
+    processor_topology& processor_topology::operator=(processor_topology&& _Other) noexcept {
+        if (this != ::std::addressof(_Other)) {
+            if (_Myprocs) {
+                ::mjx::delete_object_array(_Myprocs, _Mysize);
+            }
+
+            _Myprocs        = _Other._Myprocs;
+            _Mysize         = _Other._Mysize;
+            _Mycores        = _Other._Mycores;
+            _Mynodes        = _Other._Mynodes;
+            _Other._Myprocs = nullptr;
+            _Other._Mysize  = 0;
+            _Other._Mycores = 0;
+            _Other._Mynodes = 0;
+        }
+
+        return *this;
+    }
+
+    processor_topology processor_topology::query() {
+        processor_topology _Result;
+        unique_smart_array<processor_info> _Procs = mjsync_impl::_Discover_processors();
+        if (_Procs) { // indices are dense, so the last processor determines the counts
+            const processor_info& _Last = _Procs.get()[_Procs.size() - 1];
+            _Result._Mycores            = _Last.core + 1;
+            _Result._Mynodes            = _Last.numa_node + 1;
+            _Result._Mysize             = _Procs.size();
+            _Result._Myprocs            = _Procs.release().ptr;
+        }
+
+        return _Result;
+    }
+
+    bool processor_topology::empty() const noexcept {
+        return _Mysize == 0;
+    }
+
+    ::std::span<const processor_info> processor_topology::processors() const noexcept {
+        return ::std::span<const processor_info>(_Myprocs, _Mysize);
+    }
+
+    ::std::span<const processor_info> processor_topology::node_processors(const uint32_t _Node) const noexcept {
+        // processors are ordered by node, so the processors of one node form a contiguous range
+        const processor_info* const _Begin = _Myprocs;
+        const processor_info* const _End   = _Myprocs + _Mysize;
+        const processor_info* const _First = ::std::partition_point(_Begin, _End,
+            [_Node](const processor_info& _Proc) noexcept { return _Proc.numa_node < _Node; });
+        const processor_info* const _Last  = ::std::partition_point(_First, _End,
+            [_Node](const processor_info& _Proc) noexcept { return _Proc.numa_node == _Node; });
+        return ::std::span<const processor_info>(_First, _Last);
+    }
+
+    ::std::span<const processor_info> processor_topology::core_processors(const uint32_t _Core) const noexcept {
+        // cores are numbered in processor order, so the SMT siblings form a contiguous range
+        const processor_info* const _Begin = _Myprocs;
+        const processor_info* const _End   = _Myprocs + _Mysize;
+        const processor_info* const _First = ::std::partition_point(_Begin, _End,
+            [_Core](const processor_info& _Proc) noexcept { return _Proc.core < _Core; });
+        const processor_info* const _Last  = ::std::partition_point(_First, _End,
+            [_Core](const processor_info& _Proc) noexcept { return _Proc.core == _Core; });
+        return ::std::span<const processor_info>(_First, _Last);
+    }
+
+    size_t processor_topology::core_count() const noexcept {
+        return _Mycores;
+    }
+
+    size_t processor_topology::numa_node_count() const noexcept {
+        return _Mynodes;
+    }
+} // namespace mjx
\ No newline at end of file
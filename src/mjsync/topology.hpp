@@ -0,0 +1,62 @@
+// topology.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _MJSYNC_TOPOLOGY_HPP_
+#define _MJSYNC_TOPOLOGY_HPP_
+#include <cstddef>
+#include <cstdint>
+#include <mjsync/api.hpp>
+#include <span>
+
+namespace mjx {
+    struct processor_info { // describes a single logical processor
+        uint16_t group     = 0; // processor group, always zero on systems without processor groups
+        uint8_t number     = 0; // number of the processor within its group
+        uint32_t core      = 0; // index of the physical core, shared by SMT siblings
+        uint32_t numa_node = 0; // index of the NUMA node
+    };
+
+    class _MJSYNC_API processor_topology { // logical processors grouped by NUMA node and physical core
+    public:
+        processor_topology() noexcept;
+        processor_topology(processor_topology&& _Other) noexcept;
+        ~processor_topology() noexcept;
+
+        processor_topology& operator=(processor_topology&& _Other) noexcept;
+
+        processor_topology(const processor_topology&)            = delete;
+        processor_topology& operator=(const processor_topology&) = delete;
+
+        // discovers the topology of the current system, returns an empty topology on failure
+        static processor_topology query();
+
+        // checks if the topology is empty
+        bool empty() const noexcept;
+
+        // returns all logical processors, ordered by NUMA node, then by core
+        ::std::span<const processor_info> processors() const noexcept;
+
+        // returns the logical processors that belong to the NUMA node
+        ::std::span<const processor_info> node_processors(const uint32_t _Node) const noexcept;
+
+        // returns the logical processors that share the core (SMT siblings)
+        ::std::span<const processor_info> core_processors(const uint32_t _Core) const noexcept;
+
+        // returns the number of physical cores
+        size_t core_count() const noexcept;
+
+        // returns the number of NUMA nodes
+        size_t numa_node_count() const noexcept;
+
+    private:
+        processor_info* _Myprocs;
+        size_t _Mysize;
+        uint32_t _Mycores;
+        uint32_t _Mynodes;
+    };
+} // namespace mjx
+
+#endif // _MJSYNC_TOPOLOGY_HPP_
\ No newline at end of file
@@ -0,0 +1,197 @@
+// trace.cpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <cstdio>
+#include <fstream>
+#include <mjsync/impl/trace.hpp>
+#include <mjsync/trace.hpp>
+
+namespace mjx {
+    namespace mjsync_impl {
+        _Trace_registry& _Get_trace_registry() noexcept {
+            static _Trace_registry _Registry;
+            return _Registry;
+        }
+
+        class _Trace_json_writer { // formats the events into a fixed buffer, passed to the writer in chunks
+        public:
+            _Trace_json_writer(const trace_writer _Writer, void* const _Arg, const uint64_t _Origin) noexcept
+                : _Mywriter(_Writer), _Myarg(_Arg), _Myorigin(_Origin), _Mybuf(), _Mysize(0), _Myfirst(true) {}
+
+            ~_Trace_json_writer() noexcept {}
+
+            _Trace_json_writer(const _Trace_json_writer&)            = delete;
+            _Trace_json_writer& operator=(const _Trace_json_writer&) = delete;
+
+            void _Begin() noexcept {
+                _Append("{\"traceEvents\":[");
+            }
+
+            void _End() noexcept {
+                _Append("],\"displayTimeUnit\":\"ns\"}\n");
+                _Flush();
+            }
+
+            void _Thread_name(const unsigned long _Thread) noexcept {
+                char _Line[128];
+                ::snprintf(_Line, sizeof(_Line),
+                    "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%lu,\"args\":{\"name\":\"worker %lu\"}}",
+                    _Thread, _Thread);
+                _Event(_Line);
+            }
+
+            void _Record(const unsigned long _Thread, const _Trace_snapshot& _Snapshot) noexcept {
+                // timestamps are in microseconds relative to the start of the trace, as the format expects
+                if (_Snapshot._Time < _Myorigin) { // recorded before the trace started, skip it
+                    return;
+                }
+
+                const uint64_t _Elapsed = _Snapshot._Time - _Myorigin;
+                char _Line[160];
+                if (_Snapshot._Event == _Trace_event::_End) {
+                    ::snprintf(_Line, sizeof(_Line), "{\"ph\":\"E\",\"pid\":1,\"tid\":%lu,\"ts\":%llu.%03u}",
+                        _Thread, static_cast<unsigned long long>(_Elapsed / 1000),
+                        static_cast<unsigned int>(_Elapsed % 1000));
+                    _Event(_Line);
+                    return;
+                }
+
+                _Separate();
+                _Append("{\"name\":\"");
+                _Append_escaped(_Snapshot._Label ? _Snapshot._Label : "task");
+                ::snprintf(_Line, sizeof(_Line),
+                    "\",\"cat\":\"task\",\"ph\":\"B\",\"pid\":1,\"tid\":%lu,\"ts\":%llu.%03u,"
+                    "\"args\":{\"id\":%llu,\"priority\":%u}}",
+                    _Thread, static_cast<unsigned long long>(_Elapsed / 1000),
+                    static_cast<unsigned int>(_Elapsed % 1000), static_cast<unsigned long long>(_Snapshot._Task),
+                    static_cast<unsigned int>(_Snapshot._Priority));
+                _Append(_Line);
+            }
+
+        private:
+            void _Event(const char* const _Text) noexcept {
+                _Separate();
+                _Append(_Text);
+            }
+
+            void _Separate() noexcept {
+                if (_Myfirst) {
+                    _Myfirst = false;
+                } else {
+                    _Append(",\n");
+                }
+            }
+
+            void _Append(const char* _Text) noexcept {
+                for (; *_Text; ++_Text) {
+                    _Put(*_Text);
+                }
+            }
+
+            void _Append_escaped(const char* _Text) noexcept {
+                // labels are user strings, quotes, backslashes and control characters must be escaped
+                for (; *_Text; ++_Text) {
+                    const unsigned char _Ch = static_cast<unsigned char>(*_Text);
+                    if (_Ch == '"' || _Ch == '\\') {
+                        _Put('\\');
+                        _Put(static_cast<char>(_Ch));
+                    } else if (_Ch < 0x20) {
+                        char _Escape[8];
+                        ::snprintf(_Escape, sizeof(_Escape), "\\u%04x", _Ch);
+                        _Append(_Escape);
+                    } else {
+                        _Put(static_cast<char>(_Ch));
+                    }
+                }
+            }
+
+            void _Put(const char _Ch) noexcept {
+                if (_Mysize == sizeof(_Mybuf)) {
+                    _Flush();
+                }
+
+                _Mybuf[_Mysize++] = _Ch;
+            }
+
+            void _Flush() noexcept {
+                if (_Mysize > 0) {
+                    _Mywriter(_Mybuf, _Mysize, _Myarg);
+                    _Mysize = 0;
+                }
+            }
+
+            trace_writer _Mywriter;
+            void* _Myarg;
+            uint64_t _Myorigin; // start of the trace
+            char _Mybuf[4096];
+            size_t _Mysize;
+            bool _Myfirst; // set until the first event is written
+        };
+    } // namespace mjsync_impl
+
+    bool start_tracing(const size_t _Capacity) noexcept {
+        constexpr size_t _Max_capacity = size_t{1} << 24;
+        if (_Capacity == 0 || _Capacity > _Max_capacity) {
+            return false;
+        }
+
+        mjsync_impl::_Get_trace_registry()._Start(_Capacity);
+        return true;
+    }
+
+    void stop_tracing() noexcept {
+        mjsync_impl::_Get_trace_registry()._Stop();
+    }
+
+    bool is_tracing() noexcept {
+        return mjsync_impl::_Get_trace_registry()._Is_enabled();
+    }
+
+    bool flush_trace(const trace_writer _Writer, void* const _Arg) noexcept {
+        if (!_Writer) {
+            return false;
+        }
+
+        // Note: Flushing does not stop the recording threads, the events recorded meanwhile may be missing
+        //       or cut off, but never torn. Each buffer is copied before it is written.
+        mjsync_impl::_Trace_registry& _Registry = mjsync_impl::_Get_trace_registry();
+        mjsync_impl::_Trace_json_writer _Json(_Writer, _Arg, _Registry._Origin());
+        try {
+            _Json._Begin();
+            _Registry._For_each_buffer(
+                [&_Json](const mjsync_impl::_Trace_buffer& _Buffer) {
+                    _Json._Thread_name(_Buffer._Thread);
+                    _Buffer._Visit(
+                        [&_Json, &_Buffer](const mjsync_impl::_Trace_snapshot& _Snapshot) noexcept {
+                            _Json._Record(_Buffer._Thread, _Snapshot);
+                        }
+                    );
+                }
+            );
+            _Json._End();
+            return true;
+        } catch (...) { // out of memory, the output is incomplete
+            return false;
+        }
+    }
+
+    bool flush_trace(const char* const _Path) noexcept {
+        try {
+            ::std::ofstream _File(_Path, ::std::ios::binary | ::std::ios::trunc);
+            if (!_File) {
+                return false;
+            }
+
+            const bool _Written = ::mjx::flush_trace(
+                [](const char* const _Data, const size_t _Size, void* const _Arg) {
+                    static_cast<::std::ofstream*>(_Arg)->write(_Data, static_cast<::std::streamsize>(_Size));
+                }, &_File);
+            _File.close();
+            return _Written && !_File.fail();
+        } catch (...) {
+            return false;
+        }
+    }
+} // namespace mjx
\ No newline at end of file
@@ -0,0 +1,36 @@
+// trace.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _MJSYNC_TRACE_HPP_
+#define _MJSYNC_TRACE_HPP_
+#include <cstddef>
+#include <mjsync/api.hpp>
+
+namespace mjx {
+    struct trace_label { // names the traced task, the string must outlive the trace
+        const char* name = nullptr;
+    };
+
+    using trace_writer = void(*)(const char*, size_t, void*); // receives the output in chunks, must not throw
+
+    // starts a new trace, each thread keeps its last _Capacity events (rounded up to a power of two),
+    // the events of the previous trace are discarded
+    _MJSYNC_API bool start_tracing(const size_t _Capacity = 65536) noexcept;
+
+    // stops recording, the events are kept until the next trace starts
+    _MJSYNC_API void stop_tracing() noexcept;
+
+    // checks if the events are being recorded
+    _MJSYNC_API bool is_tracing() noexcept;
+
+    // writes the events of the current trace as Chrome trace-event JSON, in chunks passed to _Writer
+    _MJSYNC_API bool flush_trace(const trace_writer _Writer, void* const _Arg) noexcept;
+
+    // writes the events of the current trace as Chrome trace-event JSON to the file
+    _MJSYNC_API bool flush_trace(const char* const _Path) noexcept;
+} // namespace mjx
+
+#endif // _MJSYNC_TRACE_HPP_
\ No newline at end of file
@@ -22,7 +22,7 @@ namespace mjx {
 
     waitable_event::~waitable_event() noexcept {
         if (_Myhandle) {
-            ::CloseHandle(_Myhandle);
+            mjsync_impl::_Close_waitable_event(_Myhandle);
             _Myhandle = nullptr;
         }
     }
@@ -46,27 +46,27 @@ namespace mjx {
 
     void waitable_event::wait(const uint32_t _Timeout) noexcept {
         if (_Myhandle) {
-            ::WaitForSingleObject(_Myhandle, _Timeout);
+            mjsync_impl::_Wait_for_waitable_event(_Myhandle, _Timeout);
         }
     }
 
     void waitable_event::wait_and_reset(const uint32_t _Timeout) noexcept {
         if (_Myhandle) {
-            if (::WaitForSingleObject(_Myhandle, _Timeout) == WAIT_OBJECT_0) {
-                ::ResetEvent(_Myhandle);
+            if (mjsync_impl::_Wait_for_waitable_event(_Myhandle, _Timeout)) {
+                mjsync_impl::_Reset_waitable_event(_Myhandle);
             }
         }
     }
 
     void waitable_event::notify() noexcept {
         if (_Myhandle) {
-            ::SetEvent(_Myhandle);
+            mjsync_impl::_Set_waitable_event(_Myhandle);
         }
     }
 
     void waitable_event::reset() noexcept {
         if (_Myhandle) {
-            ::ResetEvent(_Myhandle);
+            mjsync_impl::_Reset_waitable_event(_Myhandle);
         }
     }
 } // namespace mjx
\ No newline at end of file
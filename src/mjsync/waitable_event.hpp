@@ -26,6 +26,7 @@ namespace mjx {
         waitable_event(waitable_event&& _Other) noexcept;
         ~waitable_event() noexcept;
 
+        // opens or creates a named event, shared between processes, Windows only (invalid elsewhere)
         explicit waitable_event(const wchar_t* const _Name) noexcept;
         explicit waitable_event(uninitialized_event_t) noexcept;
 
@@ -0,0 +1,107 @@
+// test_async.cpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <array>
+#include <atomic>
+#include <mjsync/async.hpp>
+#include <mjsync/future.hpp>
+#include <mjsync/thread_pool.hpp>
+#include <stdexcept>
+#include <tests/test_utils.hpp>
+
+namespace mjx {
+    namespace test {
+        void _Get_returns_the_result() {
+            thread_pool _Pool(2);
+            future<int> _Future = ::mjx::async(_Pool, [](const int _Left, const int _Right) {
+                return _Left + _Right;
+            }, 40, 2);
+            _MJSYNC_CHECK(_Future.valid());
+            _MJSYNC_CHECK(_Future.get() == 42);
+            _MJSYNC_CHECK(!_Future.valid());
+        }
+
+        void _Get_rethrows_the_exception() {
+            thread_pool _Pool(2);
+            future<void> _Future = ::mjx::async(_Pool, [] { throw ::std::runtime_error("producer failed"); });
+            bool _Thrown         = false;
+            try {
+                _Future.get();
+            } catch (const ::std::runtime_error&) {
+                _Thrown = true;
+            }
+
+            _MJSYNC_CHECK(_Thrown);
+        }
+
+        void _Then_chains_the_results() {
+            thread_pool _Pool(2);
+            future<int> _Future = ::mjx::async(_Pool, [] { return 20; })
+                .then([](const int _Value) { return _Value + 1; })
+                .then([](const int _Value) { return _Value * 2; });
+            _MJSYNC_CHECK(_Future.get() == 42);
+        }
+
+        int _Sum_below(thread_pool& _Pool, const int _Count) {
+            // each level waits for the next one, which is queued behind the waiting worker
+            if (_Count == 0) {
+                return 0;
+            }
+
+            future<int> _Rest = ::mjx::async(_Pool, [&_Pool, _Count] { return _Sum_below(_Pool, _Count - 1); });
+            return _Count + _Rest.get();
+        }
+
+        void _Worker_gets_a_child_result() {
+            thread_pool _Pool(1);
+            future<int> _Future = ::mjx::async(_Pool, [&_Pool] { return _Sum_below(_Pool, 10); });
+            _MJSYNC_CHECK(_Wait_until([&] { return _Future.is_ready(); }));
+            _MJSYNC_CHECK(_Future.get() == 55);
+        }
+
+        void _Worker_gets_a_large_child_result() {
+            // the state does not fit into the task's inline storage and is allocated
+            thread_pool _Pool(1);
+            future<int> _Future = ::mjx::async(_Pool, [&_Pool] {
+                ::std::array<int, 256> _Values{};
+                _Values[255]       = 7;
+                future<int> _Child = ::mjx::async(_Pool, [_Values] { return _Values[255]; });
+                return _Child.get();
+            });
+            _MJSYNC_CHECK(_Wait_until([&] { return _Future.is_ready(); }));
+            _MJSYNC_CHECK(_Future.get() == 7);
+        }
+
+        void _Worker_waits_for_a_child() {
+            thread_pool _Pool(2);
+            ::std::atomic<int> _Count{0};
+            future<void> _Future = ::mjx::async(_Pool, [&] {
+                future<void> _Children[8];
+                for (future<void>& _Child : _Children) {
+                    _Child = ::mjx::async(_Pool, [&_Count] { ++_Count; });
+                }
+
+                for (const future<void>& _Child : _Children) {
+                    _Child.wait();
+                }
+            });
+            _MJSYNC_CHECK(_Wait_until([&] { return _Future.is_ready(); }));
+            _MJSYNC_CHECK(_Count == 8);
+        }
+    } // namespace test
+} // namespace mjx
+
+int main() {
+    using namespace ::mjx::test;
+    static constexpr _Test_case _Cases[] = {
+        {"get_returns_the_result", &_Get_returns_the_result},
+        {"get_rethrows_the_exception", &_Get_rethrows_the_exception},
+        {"then_chains_the_results", &_Then_chains_the_results},
+        {"worker_gets_a_child_result", &_Worker_gets_a_child_result},
+        {"worker_gets_a_large_child_result", &_Worker_gets_a_large_child_result},
+        {"worker_waits_for_a_child", &_Worker_waits_for_a_child},
+    };
+    return _Run_tests(_Cases);
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+// test_parallel.cpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <atomic>
+#include <cstddef>
+#include <mjsync/parallel.hpp>
+#include <mjsync/thread_pool.hpp>
+#include <stdexcept>
+#include <tests/test_utils.hpp>
+#include <vector>
+
+namespace mjx {
+    namespace test {
+        void _For_visits_every_index_once() {
+            thread_pool _Pool(4);
+            ::std::vector<::std::atomic<int>> _Visits(100000);
+            ::mjx::parallel_for(_Pool, size_t{0}, _Visits.size(), [&](const size_t _Idx) { ++_Visits[_Idx]; });
+            bool _Once = true;
+            for (const ::std::atomic<int>& _Count : _Visits) {
+                _Once &= _Count == 1;
+            }
+
+            _MJSYNC_CHECK(_Once);
+        }
+
+        void _For_over_iterators() {
+            thread_pool _Pool(4);
+            ::std::vector<int> _Values(10000, 1);
+            ::mjx::parallel_for(_Pool, _Values.begin(), _Values.end(), [](int& _Value) { _Value *= 3; }, 16);
+            bool _All = true;
+            for (const int _Value : _Values) {
+                _All &= _Value == 3;
+            }
+
+            _MJSYNC_CHECK(_All);
+        }
+
+        void _Reduce_keeps_the_order() {
+            thread_pool _Pool(4);
+            _MJSYNC_CHECK(::mjx::parallel_reduce(_Pool, size_t{0}, size_t{100000}, 0LL) == 4999950000LL);
+
+            // not commutative, only associative
+            const ::std::vector<long long> _Digits = ::std::vector<long long>(18, 1);
+            const long long _Joined                = ::mjx::parallel_transform_reduce(
+                _Pool, _Digits.begin(), _Digits.end(), 0LL,
+                [](const long long _Left, const long long _Right) {
+                    long long _Scale = 1;
+                    for (long long _Rest = _Right; _Rest > 0; _Rest /= 10) {
+                        _Scale *= 10;
+                    }
+
+                    return _Left * _Scale + _Right;
+                },
+                [](const long long _Digit) { return _Digit; }, 1);
+            _MJSYNC_CHECK(_Joined == 111111111111111111LL);
+        }
+
+        void _Nested_for_does_not_deadlock() {
+            // the inner pieces are queued behind the workers that wait for them, which must run them themselves
+            for (int _Round = 0; _Round < 20; ++_Round) {
+                thread_pool _Pool(2);
+                ::std::atomic<int> _Count{0};
+                ::mjx::parallel_for(_Pool, size_t{0}, size_t{64}, [&](size_t) {
+                    ::mjx::parallel_for(_Pool, size_t{0}, size_t{64}, [&](size_t) { ++_Count; }, 1);
+                }, 1);
+                _MJSYNC_CHECK(_Count == 4096);
+            }
+        }
+
+        void _For_rethrows_the_exception() {
+            thread_pool _Pool(4);
+            bool _Thrown = false;
+            try {
+                ::mjx::parallel_for(_Pool, size_t{0}, size_t{1000}, [](const size_t _Idx) {
+                    if (_Idx == 500) {
+                        throw ::std::runtime_error("element failed");
+                    }
+                }, 1);
+            } catch (const ::std::runtime_error&) {
+                _Thrown = true;
+            }
+
+            _MJSYNC_CHECK(_Thrown);
+        }
+    } // namespace test
+} // namespace mjx
+
+int main() {
+    using namespace ::mjx::test;
+    static constexpr _Test_case _Cases[] = {
+        {"for_visits_every_index_once", &_For_visits_every_index_once},
+        {"for_over_iterators", &_For_over_iterators},
+        {"reduce_keeps_the_order", &_Reduce_keeps_the_order},
+        {"nested_for_does_not_deadlock", &_Nested_for_does_not_deadlock},
+        {"for_rethrows_the_exception", &_For_rethrows_the_exception},
+    };
+    return _Run_tests(_Cases);
+}
\ No newline at end of file
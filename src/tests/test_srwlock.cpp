@@ -0,0 +1,134 @@
+// test_srwlock.cpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <atomic>
+#include <chrono>
+#include <mjsync/srwlock.hpp>
+#include <tests/test_utils.hpp>
+#include <thread>
+#include <vector>
+
+namespace mjx {
+    namespace test {
+        void _Exclusive_counter() {
+            shared_lock _Lock;
+            long _Counter = 0;
+            ::std::vector<::std::thread> _Threads;
+            for (int _Idx = 0; _Idx < 4; ++_Idx) {
+                _Threads.emplace_back([&] {
+                    for (int _Iter = 0; _Iter < 100000; ++_Iter) {
+                        lock_guard _Guard(_Lock);
+                        ++_Counter;
+                    }
+                });
+            }
+
+            for (::std::thread& _Thread : _Threads) {
+                _Thread.join();
+            }
+
+            _MJSYNC_CHECK(_Counter == 400000);
+        }
+
+        void _Readers_see_consistent_state() {
+            // the writers keep both values equal, a reader never observes a half-done update
+            shared_lock _Lock;
+            long _First  = 0;
+            long _Second = 0;
+            ::std::atomic<bool> _Torn{false};
+            ::std::vector<::std::thread> _Threads;
+            for (int _Idx = 0; _Idx < 6; ++_Idx) {
+                _Threads.emplace_back([&, _Idx] {
+                    for (int _Iter = 0; _Iter < 50000; ++_Iter) {
+                        if (_Idx % 3 == 0) {
+                            lock_guard _Guard(_Lock);
+                            ++_First;
+                            ++_Second;
+                        } else {
+                            shared_lock_guard _Guard(_Lock);
+                            if (_First != _Second) {
+                                _Torn = true;
+                            }
+                        }
+                    }
+                });
+            }
+
+            for (::std::thread& _Thread : _Threads) {
+                _Thread.join();
+            }
+
+            _MJSYNC_CHECK(!_Torn);
+            _MJSYNC_CHECK(_First == 100000 && _Second == 100000);
+        }
+
+        void _Readers_share_the_lock() {
+            shared_lock _Lock;
+            ::std::atomic<bool> _Entered{false};
+            _Lock.lock_shared();
+            ::std::thread _Reader([&] {
+                shared_lock_guard _Guard(_Lock);
+                _Entered = true;
+            });
+            _MJSYNC_CHECK(_Wait_until([&] { return _Entered.load(); }));
+            _Lock.unlock_shared();
+            _Reader.join();
+        }
+
+        void _Writer_excludes_readers() {
+            shared_lock _Lock;
+            ::std::atomic<bool> _Entered{false};
+            _Lock.lock();
+            ::std::thread _Reader([&] {
+                shared_lock_guard _Guard(_Lock);
+                _Entered = true;
+            });
+            ::std::this_thread::sleep_for(::std::chrono::milliseconds(50));
+            _MJSYNC_CHECK(!_Entered);
+            _Lock.unlock();
+            _MJSYNC_CHECK(_Wait_until([&] { return _Entered.load(); }));
+            _Reader.join();
+        }
+
+        void _Waiting_writer_gets_the_lock() {
+            // a stream of readers must not starve a waiting writer
+            shared_lock _Lock;
+            ::std::atomic<bool> _Stop{false};
+            ::std::atomic<bool> _Written{false};
+            ::std::vector<::std::thread> _Readers;
+            for (int _Idx = 0; _Idx < 3; ++_Idx) {
+                _Readers.emplace_back([&] {
+                    while (!_Stop) {
+                        shared_lock_guard _Guard(_Lock);
+                        ::std::this_thread::yield();
+                    }
+                });
+            }
+
+            ::std::thread _Writer([&] {
+                lock_guard _Guard(_Lock);
+                _Written = true;
+            });
+            _MJSYNC_CHECK(_Wait_until([&] { return _Written.load(); }));
+            _Stop = true;
+            _Writer.join();
+            for (::std::thread& _Reader : _Readers) {
+                _Reader.join();
+            }
+        }
+    } // namespace test
+} // namespace mjx
+
+int main() {
+    using namespace ::mjx::test;
+    static constexpr _Test_case _Cases[] = {
+        {"exclusive_counter", &_Exclusive_counter},
+        {"readers_see_consistent_state", &_Readers_see_consistent_state},
+        {"readers_share_the_lock", &_Readers_share_the_lock},
+        {"writer_excludes_readers", &_Writer_excludes_readers},
+        {"waiting_writer_gets_the_lock", &_Waiting_writer_gets_the_lock},
+    };
+    return _Run_tests(_Cases);
+}
\ No newline at end of file
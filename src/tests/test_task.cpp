@@ -0,0 +1,206 @@
+// test_task.cpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mjsync/task.hpp>
+#include <mjsync/thread.hpp>
+#include <mjsync/thread_pool.hpp>
+#include <tests/test_utils.hpp>
+#include <thread>
+
+namespace mjx {
+    namespace test {
+        struct _Blocker { // a task that runs until released
+            ::std::atomic<bool> _Started{false};
+            ::std::atomic<bool> _Released{false};
+
+            static void _Run(void* const _Arg) noexcept {
+                _Blocker* const _Self = static_cast<_Blocker*>(_Arg);
+                _Self->_Started       = true;
+                while (!_Self->_Released) {
+                    ::std::this_thread::sleep_for(::std::chrono::milliseconds(1));
+                }
+            }
+        };
+
+        void _Increment(void* const _Arg) noexcept {
+            ++*static_cast<::std::atomic<int>*>(_Arg);
+        }
+
+        void _Task_runs() {
+            thread _Thread;
+            ::std::atomic<int> _Count{0};
+            task _Task = _Thread.schedule_task(&_Increment, &_Count);
+            _MJSYNC_CHECK(_Task.is_registered());
+            _Task.wait_until_done();
+            _MJSYNC_CHECK(_Count == 1);
+            _MJSYNC_CHECK(_Task.state() == task_state::done);
+        }
+
+        void _Cancel_wakes_the_waiter() {
+            // the task is queued behind a blocker, canceling it must release the thread that waits for it
+            thread _Thread;
+            _Blocker _Block;
+            task _First = _Thread.schedule_task(&_Blocker::_Run, &_Block);
+            ::std::atomic<int> _Count{0};
+            task _Second = _Thread.schedule_task(&_Increment, &_Count);
+            ::std::atomic<bool> _Woken{false};
+            ::std::thread _Waiter([&] {
+                _Second.wait_until_done();
+                _Woken = true;
+            });
+            ::std::this_thread::sleep_for(::std::chrono::milliseconds(20));
+            _MJSYNC_CHECK(_Second.cancel() == task::cancellation_result::success);
+            _MJSYNC_CHECK(_Wait_until([&] { return _Woken.load(); }, ::std::chrono::seconds(3)));
+            _MJSYNC_CHECK(_Second.state() == task_state::canceled);
+
+            _Block._Released = true;
+            _Waiter.join();
+            _First.wait_until_done();
+            _MJSYNC_CHECK(_Count == 0); // the canceled task has been skipped
+        }
+
+        void _Cancel_twice() {
+            thread _Thread;
+            _Blocker _Block;
+            task _First  = _Thread.schedule_task(&_Blocker::_Run, &_Block);
+            task _Second = _Thread.schedule_task(&_Increment, nullptr);
+            _MJSYNC_CHECK(_Second.cancel() == task::cancellation_result::success);
+            _MJSYNC_CHECK(_Second.cancel() == task::cancellation_result::already_canceled);
+            _Block._Released = true;
+            _First.wait_until_done();
+        }
+
+        void _Cancel_started_task_fails() {
+            thread _Thread;
+            _Blocker _Block;
+            task _Task = _Thread.schedule_task(&_Blocker::_Run, &_Block);
+            _MJSYNC_CHECK(_Wait_until([&] { return _Block._Started.load(); }));
+            _MJSYNC_CHECK(_Task.cancel() == task::cancellation_result::already_started);
+            _MJSYNC_CHECK(_Task.state() == task_state::running);
+            _Block._Released = true;
+            _Task.wait_until_done();
+            _MJSYNC_CHECK(_Task.state() == task_state::done);
+            _MJSYNC_CHECK(_Task.cancel() == task::cancellation_result::already_started);
+            _MJSYNC_CHECK(_Task.state() == task_state::done);
+        }
+
+        void _Unregistered_task() {
+            task _Task;
+            _MJSYNC_CHECK(!_Task.is_registered());
+            _MJSYNC_CHECK(_Task.state() == task_state::none);
+            _MJSYNC_CHECK(_Task.cancel() == task::cancellation_result::task_not_registered);
+            _Task.wait_until_done(); // returns at once
+        }
+
+        struct _Nested_wait {
+            thread_pool* _Pool;
+            ::std::atomic<int> _Count{0};
+            ::std::atomic<bool> _Done{false};
+
+            static void _Run(void* const _Arg) noexcept {
+                // the inner task is queued behind the waiting worker, which must run it itself
+                _Nested_wait* const _Self = static_cast<_Nested_wait*>(_Arg);
+                task _Inner               = _Self->_Pool->schedule_task(&_Increment, &_Self->_Count);
+                _Inner.wait_until_done();
+                _Self->_Done = true;
+            }
+        };
+
+        void _Worker_waits_for_its_own_task() {
+            thread_pool _Pool(1);
+            _Nested_wait _State;
+            _State._Pool = &_Pool;
+            task _Outer  = _Pool.schedule_task(&_Nested_wait::_Run, &_State);
+            _MJSYNC_CHECK(_Wait_until([&] { return _State._Done.load(); }));
+            _Outer.wait_until_done();
+            _MJSYNC_CHECK(_State._Count == 1);
+        }
+        struct _Deleter_probe {
+            ::std::atomic<bool> _Finished{false};
+            ::std::atomic<int> _Deleted{0};
+            ::std::atomic<int>* _Early;
+
+            static void _Run(void* const _Arg) noexcept {
+                ::std::this_thread::sleep_for(::std::chrono::milliseconds(5));
+                static_cast<_Deleter_probe*>(_Arg)->_Finished = true;
+            }
+
+            static void _Delete(void* const _Arg) noexcept {
+                _Deleter_probe* const _Self = static_cast<_Deleter_probe*>(_Arg);
+                if (!_Self->_Finished) {
+                    ++*_Self->_Early;
+                }
+
+                ++_Self->_Deleted;
+            }
+        };
+
+        struct _Deleter_parent {
+            static constexpr size_t _Count = 4;
+
+            thread_pool* _Pool;
+            _Deleter_probe _Children[_Count];
+            ::std::atomic<int> _Early{0};
+
+            static void _Run(void* const _Arg) noexcept {
+                // the last child is run inline by this worker while the other worker pops the children in order
+                _Deleter_parent* const _Self = static_cast<_Deleter_parent*>(_Arg);
+                task_descriptor _Descs[_Count];
+                task _Tasks[_Count];
+                for (size_t _Idx = 0; _Idx < _Count; ++_Idx) {
+                    _Self->_Children[_Idx]._Early = &_Self->_Early;
+                    _Descs[_Idx] = task_descriptor{&_Deleter_probe::_Run, &_Self->_Children[_Idx],
+                        task_priority::normal, &_Deleter_probe::_Delete};
+                }
+
+                _Self->_Pool->schedule_tasks(_Descs, _Tasks);
+                for (size_t _Idx = _Count; _Idx > 0; --_Idx) {
+                    _Tasks[_Idx - 1].wait_until_done();
+                }
+            }
+        };
+
+        void _Deleter_runs_after_the_callable() {
+            for (int _Round = 0; _Round < 10; ++_Round) {
+                thread_pool _Pool(2);
+                _Deleter_parent _Parent;
+                _Parent._Pool = &_Pool;
+                task _Task    = _Pool.schedule_task(&_Deleter_parent::_Run, &_Parent);
+                _MJSYNC_CHECK(_Wait_until([&] {
+                    for (const _Deleter_probe& _Child : _Parent._Children) {
+                        if (_Child._Deleted.load() == 0) {
+                            return false;
+                        }
+                    }
+
+                    return true;
+                }));
+                _Task.wait_until_done();
+                ::std::this_thread::sleep_for(::std::chrono::milliseconds(10));
+                _MJSYNC_CHECK(_Parent._Early == 0);
+                for (const _Deleter_probe& _Child : _Parent._Children) {
+                    _MJSYNC_CHECK(_Child._Deleted == 1);
+                }
+            }
+        }
+    } // namespace test
+} // namespace mjx
+
+int main() {
+    using namespace ::mjx::test;
+    static constexpr _Test_case _Cases[] = {
+        {"task_runs", &_Task_runs},
+        {"cancel_wakes_the_waiter", &_Cancel_wakes_the_waiter},
+        {"cancel_twice", &_Cancel_twice},
+        {"cancel_started_task_fails", &_Cancel_started_task_fails},
+        {"unregistered_task", &_Unregistered_task},
+        {"worker_waits_for_its_own_task", &_Worker_waits_for_its_own_task},
+        {"deleter_runs_after_the_callable", &_Deleter_runs_after_the_callable},
+    };
+    return _Run_tests(_Cases);
+}
\ No newline at end of file
@@ -0,0 +1,120 @@
+// test_task_graph.cpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <atomic>
+#include <cstddef>
+#include <mjsync/task.hpp>
+#include <mjsync/task_graph.hpp>
+#include <mjsync/thread_pool.hpp>
+#include <stdexcept>
+#include <tests/test_utils.hpp>
+
+namespace mjx {
+    namespace test {
+        void _Diamond_runs_in_order() {
+            thread_pool _Pool(4);
+            task_graph _Graph;
+            ::std::atomic<int> _Step{0};
+            ::std::atomic<bool> _Wrong{false};
+            const task_graph::node_id _Top    = _Graph.add_node([&] { _Step = 1; });
+            const task_graph::node_id _Left   = _Graph.add_node([&] { _Wrong = _Wrong || _Step.fetch_add(1) < 1; });
+            const task_graph::node_id _Right  = _Graph.add_node([&] { _Wrong = _Wrong || _Step.fetch_add(1) < 1; });
+            const task_graph::node_id _Bottom = _Graph.add_node([&] { _Wrong = _Wrong || _Step.load() != 3; });
+            _MJSYNC_CHECK(_Graph.add_edge(_Top, _Left));
+            _MJSYNC_CHECK(_Graph.add_edge(_Top, _Right));
+            _MJSYNC_CHECK(_Graph.add_edge(_Left, _Bottom));
+            _MJSYNC_CHECK(_Graph.add_edge(_Right, _Bottom));
+            _MJSYNC_CHECK(!_Graph.add_edge(_Bottom, _Top)); // would close a cycle
+            for (int _Round = 0; _Round < 100; ++_Round) { // reusable
+                _MJSYNC_CHECK(_Graph.run(_Pool));
+            }
+
+            _MJSYNC_CHECK(!_Wrong);
+            _MJSYNC_CHECK(!_Graph.is_running());
+        }
+
+        struct _Nested_run {
+            thread_pool* _Pool;
+            task_graph _Graph;
+            ::std::atomic<int> _Count{0};
+            ::std::atomic<bool> _Done{false};
+
+            static void _Run(void* const _Arg) noexcept {
+                // the nodes are queued behind the waiting worker, which must run them itself
+                _Nested_run* const _Self = static_cast<_Nested_run*>(_Arg);
+                (void) _Self->_Graph.run(*_Self->_Pool);
+                _Self->_Done = true;
+            }
+        };
+
+        void _Worker_runs_a_graph() {
+            thread_pool _Pool(1);
+            _Nested_run _State;
+            _State._Pool = &_Pool;
+            task_graph::node_id _Prev = task_graph::invalid_node;
+            for (int _Idx = 0; _Idx < 16; ++_Idx) {
+                const task_graph::node_id _Node = _State._Graph.add_node([&_State] { ++_State._Count; });
+                if (_Prev != task_graph::invalid_node) {
+                    _State._Graph.add_edge(_Prev, _Node);
+                }
+
+                _Prev = _Node;
+            }
+
+            task _Outer = _Pool.schedule_task(&_Nested_run::_Run, &_State);
+            _MJSYNC_CHECK(_Wait_until([&] { return _State._Done.load(); }));
+            _Outer.wait_until_done();
+            _MJSYNC_CHECK(_State._Count == 16);
+        }
+
+        void _Failure_skips_a_long_chain() {
+            // the skipped nodes are completed by the thread that released them, without recursing
+            constexpr size_t _Length = 20000;
+            thread_pool _Pool(2);
+            task_graph _Graph;
+            ::std::atomic<size_t> _Count{0};
+            task_graph::node_id _Prev = _Graph.add_node([] { throw ::std::runtime_error("head failed"); });
+            for (size_t _Idx = 1; _Idx < _Length; ++_Idx) {
+                const task_graph::node_id _Node = _Graph.add_node([&_Count] { ++_Count; });
+                _Graph.add_edge(_Prev, _Node);
+                _Prev = _Node;
+            }
+
+            bool _Thrown = false;
+            try {
+                (void) _Graph.run(_Pool);
+            } catch (const ::std::runtime_error&) {
+                _Thrown = true;
+            }
+
+            _MJSYNC_CHECK(_Thrown);
+            _MJSYNC_CHECK(_Count == 0);
+            _MJSYNC_CHECK(!_Graph.is_running());
+        }
+        void _Destroy_right_after_run() {
+            // the last node may still be notifying the runner when the graph is destroyed
+            thread_pool _Pool(4);
+            ::std::atomic<int> _Count{0};
+            for (int _Round = 0; _Round < 20000; ++_Round) {
+                task_graph _Graph;
+                _Graph.add_node([&_Count] { ++_Count; });
+                (void) _Graph.run(_Pool);
+            }
+
+            _MJSYNC_CHECK(_Count == 20000);
+        }
+    } // namespace test
+} // namespace mjx
+
+int main() {
+    using namespace ::mjx::test;
+    static constexpr _Test_case _Cases[] = {
+        {"diamond_runs_in_order", &_Diamond_runs_in_order},
+        {"worker_runs_a_graph", &_Worker_runs_a_graph},
+        {"failure_skips_a_long_chain", &_Failure_skips_a_long_chain},
+        {"destroy_right_after_run", &_Destroy_right_after_run},
+    };
+    return _Run_tests(_Cases);
+}
\ No newline at end of file
@@ -0,0 +1,139 @@
+// test_task_group.cpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <atomic>
+#include <chrono>
+#include <mjsync/task_group.hpp>
+#include <mjsync/thread_pool.hpp>
+#include <stdexcept>
+#include <tests/test_utils.hpp>
+#include <thread>
+
+namespace mjx {
+    namespace test {
+        void _Wait_joins_all_members() {
+            thread_pool _Pool(4);
+            task_group _Group;
+            ::std::atomic<int> _Count{0};
+            for (int _Idx = 0; _Idx < 10000; ++_Idx) {
+                _Group.run(_Pool, [&_Count] { ++_Count; });
+            }
+
+            _Group.wait();
+            _MJSYNC_CHECK(_Count == 10000);
+            _MJSYNC_CHECK(_Group.pending_tasks() == 0);
+        }
+
+        void _Members_spawn_members() {
+            thread_pool _Pool(2);
+            task_group _Group;
+            ::std::atomic<int> _Count{0};
+            for (int _Idx = 0; _Idx < 100; ++_Idx) {
+                _Group.run(_Pool, [&] {
+                    for (int _Inner = 0; _Inner < 10; ++_Inner) {
+                        _Group.run(_Pool, [&_Count] { ++_Count; });
+                    }
+
+                    ++_Count;
+                });
+            }
+
+            _Group.wait();
+            _MJSYNC_CHECK(_Count == 1100);
+        }
+
+        void _Wait_rethrows_member_exceptions() {
+            thread_pool _Pool(2);
+            task_group _Group;
+            for (int _Idx = 0; _Idx < 10; ++_Idx) {
+                _Group.run(_Pool, [_Idx] {
+                    if (_Idx % 5 == 0) {
+                        throw ::std::runtime_error("member failed");
+                    }
+                });
+            }
+
+            bool _Thrown = false;
+            try {
+                _Group.wait();
+            } catch (const task_group_error& _Error) {
+                _Thrown = true;
+                _MJSYNC_CHECK(_Error.exceptions().size() == 2);
+            }
+
+            _MJSYNC_CHECK(_Thrown);
+            _Group.wait(); // reusable, the exceptions have been collected
+        }
+
+        void _Cancel_skips_unstarted_members() {
+            thread_pool _Pool(1);
+            task_group _Group;
+            ::std::atomic<bool> _Released{false};
+            ::std::atomic<int> _Count{0};
+            _Group.run(_Pool, [&] {
+                while (!_Released) {
+                    ::std::this_thread::sleep_for(::std::chrono::milliseconds(1));
+                }
+            });
+            for (int _Idx = 0; _Idx < 100; ++_Idx) {
+                _Group.run(_Pool, [&_Count] { ++_Count; });
+            }
+
+            _Group.cancel();
+            _MJSYNC_CHECK(_Group.is_canceled());
+            _MJSYNC_CHECK(_Group.get_token().stop_requested());
+            _Released = true;
+            _Group.wait();
+            _MJSYNC_CHECK(_Count == 0);
+        }
+
+        void _Move_assignment_waits_for_members() {
+            // the old members complete into the old group, it must outlive them
+            thread_pool _Pool(4);
+            ::std::atomic<int> _Finished{0};
+            task_group _Group;
+            for (int _Idx = 0; _Idx < 8; ++_Idx) {
+                _Group.run(_Pool, [&_Finished] {
+                    ::std::this_thread::sleep_for(::std::chrono::milliseconds(20));
+                    ++_Finished;
+                });
+            }
+
+            ::std::this_thread::sleep_for(::std::chrono::milliseconds(5));
+            _Group = task_group{};
+            _MJSYNC_CHECK(_Finished == 8);
+            _Group.run(_Pool, [&_Finished] { ++_Finished; });
+            _Group.wait();
+            _MJSYNC_CHECK(_Finished == 9);
+        }
+        void _Destroy_right_after_wait() {
+            // the last member may still be notifying the waiter when the group is destroyed
+            thread_pool _Pool(4);
+            ::std::atomic<int> _Count{0};
+            for (int _Round = 0; _Round < 20000; ++_Round) {
+                task_group _Group;
+                _Group.run(_Pool, [&_Count] { ++_Count; });
+                if (_Round % 2 == 0) {
+                    _Group.wait();
+                }
+            }
+
+            _MJSYNC_CHECK(_Count == 20000);
+        }
+    } // namespace test
+} // namespace mjx
+
+int main() {
+    using namespace ::mjx::test;
+    static constexpr _Test_case _Cases[] = {
+        {"wait_joins_all_members", &_Wait_joins_all_members},
+        {"members_spawn_members", &_Members_spawn_members},
+        {"wait_rethrows_member_exceptions", &_Wait_rethrows_member_exceptions},
+        {"cancel_skips_unstarted_members", &_Cancel_skips_unstarted_members},
+        {"move_assignment_waits_for_members", &_Move_assignment_waits_for_members},
+        {"destroy_right_after_wait", &_Destroy_right_after_wait},
+    };
+    return _Run_tests(_Cases);
+}
\ No newline at end of file
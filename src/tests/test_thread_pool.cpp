@@ -0,0 +1,89 @@
+// test_thread_pool.cpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mjsync/thread_pool.hpp>
+#include <tests/test_utils.hpp>
+#include <thread>
+
+namespace mjx {
+    namespace test {
+        struct _Pool_caller { // a task that calls into its pool while the pool removes its thread
+            thread_pool* _Pool;
+            ::std::atomic<size_t> _Started{0};
+            ::std::atomic<size_t> _Finished{0};
+            ::std::atomic<bool> _Removing{false};
+
+            static void _Run(void* const _Arg) noexcept {
+                _Pool_caller* const _Self = static_cast<_Pool_caller*>(_Arg);
+                ++_Self->_Started;
+                while (!_Self->_Removing) {
+                    ::std::this_thread::sleep_for(::std::chrono::milliseconds(1));
+                }
+
+                ::std::this_thread::sleep_for(::std::chrono::milliseconds(20)); // the removal waits for this task
+                _Self->_Pool->set_idle_policy(_Self->_Pool->get_idle_policy());
+                (void) _Self->_Pool->is_auto_scaling();
+                ++_Self->_Finished;
+            }
+        };
+
+        void _Removed_thread_may_call_the_pool() {
+            thread_pool _Pool(4);
+            _Pool_caller _Caller;
+            _Caller._Pool = &_Pool;
+            for (size_t _Idx = 0; _Idx < 4; ++_Idx) {
+                _Pool.schedule_task(&_Pool_caller::_Run, &_Caller);
+            }
+
+            _MJSYNC_CHECK(_Wait_until([&] { return _Caller._Started.load() == 4; }));
+            _Caller._Removing = true;
+            _Pool.decrease_thread_count(3); // every thread is busy, a busy one is removed
+            _MJSYNC_CHECK(_Pool.thread_count() == 1);
+            _MJSYNC_CHECK(_Wait_until([&] { return _Caller._Finished.load() == 4; }));
+        }
+
+        void _Cleared_thread_may_call_the_pool() {
+            thread_pool _Pool(2);
+            _Pool_caller _Caller;
+            _Caller._Pool = &_Pool;
+            for (size_t _Idx = 0; _Idx < 2; ++_Idx) {
+                _Pool.schedule_task(&_Pool_caller::_Run, &_Caller);
+            }
+
+            _MJSYNC_CHECK(_Wait_until([&] { return _Caller._Started.load() == 2; }));
+            _Caller._Removing = true;
+            _Pool.decrease_thread_count(2); // removes all threads, each one finishes its task first
+            _MJSYNC_CHECK(_Pool.thread_count() == 0);
+            _MJSYNC_CHECK(_Caller._Finished == 2);
+        }
+
+        void _Reduced_pool_keeps_the_pending_tasks() {
+            thread_pool _Pool(4);
+            ::std::atomic<int> _Count{0};
+            for (int _Idx = 0; _Idx < 10000; ++_Idx) {
+                _Pool.schedule_task([](void* const _Arg) noexcept {
+                    ::std::this_thread::yield();
+                    ++*static_cast<::std::atomic<int>*>(_Arg);
+                }, &_Count);
+            }
+
+            _Pool.decrease_thread_count(3); // the queues of the removed threads move to the remaining one
+            _MJSYNC_CHECK(_Wait_until([&] { return _Count.load() == 10000; }));
+        }
+    } // namespace test
+} // namespace mjx
+
+int main() {
+    using namespace ::mjx::test;
+    static constexpr _Test_case _Cases[] = {
+        {"removed_thread_may_call_the_pool", &_Removed_thread_may_call_the_pool},
+        {"cleared_thread_may_call_the_pool", &_Cleared_thread_may_call_the_pool},
+        {"reduced_pool_keeps_the_pending_tasks", &_Reduced_pool_keeps_the_pending_tasks},
+    };
+    return _Run_tests(_Cases);
+}
\ No newline at end of file
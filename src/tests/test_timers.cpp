@@ -0,0 +1,110 @@
+// test_timers.cpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <atomic>
+#include <chrono>
+#include <mjsync/thread_pool.hpp>
+#include <tests/test_utils.hpp>
+#include <thread>
+
+namespace mjx {
+    namespace test {
+        struct _Timer_probe {
+            ::std::atomic<int> _Count{0};
+            ::std::atomic<long long> _First_ms{-1};
+            _Clock::time_point _Start = _Clock::now();
+
+            static void _Fire(void* const _Arg) noexcept {
+                _Timer_probe* const _Self = static_cast<_Timer_probe*>(_Arg);
+                long long _Expected       = -1;
+                _Self->_First_ms.compare_exchange_strong(_Expected, _Elapsed_ms(_Self->_Start));
+                ++_Self->_Count;
+            }
+        };
+
+        void _Schedule_after_fires_once() {
+            thread_pool _Pool(2);
+            _Timer_probe _Probe;
+            const thread_pool::timer_id _Id =
+                _Pool.schedule_after(::std::chrono::milliseconds(50), &_Timer_probe::_Fire, &_Probe);
+            _MJSYNC_CHECK(_Id != thread_pool::invalid_timer);
+            _MJSYNC_CHECK(_Wait_until([&] { return _Probe._Count.load() == 1; }));
+            _MJSYNC_CHECK(_Probe._First_ms >= 45);
+            ::std::this_thread::sleep_for(::std::chrono::milliseconds(50));
+            _MJSYNC_CHECK(_Probe._Count == 1);
+            _MJSYNC_CHECK(!_Pool.cancel_timer(_Id)); // already fired
+        }
+
+        void _Schedule_at_fires() {
+            thread_pool _Pool(1);
+            _Timer_probe _Probe;
+            _Pool.schedule_at(_Probe._Start + ::std::chrono::milliseconds(30), &_Timer_probe::_Fire, &_Probe);
+            _MJSYNC_CHECK(_Wait_until([&] { return _Probe._Count.load() == 1; }));
+            _MJSYNC_CHECK(_Probe._First_ms >= 25);
+        }
+
+        void _Canceled_timer_never_fires() {
+            thread_pool _Pool(1);
+            _Timer_probe _Probe;
+            const thread_pool::timer_id _Id =
+                _Pool.schedule_after(::std::chrono::milliseconds(100), &_Timer_probe::_Fire, &_Probe);
+            _MJSYNC_CHECK(_Pool.pending_timers() == 1);
+            _MJSYNC_CHECK(_Pool.cancel_timer(_Id));
+            _MJSYNC_CHECK(!_Pool.cancel_timer(_Id));
+            _MJSYNC_CHECK(_Pool.pending_timers() == 0);
+            ::std::this_thread::sleep_for(::std::chrono::milliseconds(200));
+            _MJSYNC_CHECK(_Probe._Count == 0);
+        }
+
+        void _Periodic_timer_repeats_until_canceled() {
+            thread_pool _Pool(2);
+            _Timer_probe _Probe;
+            const thread_pool::timer_id _Id =
+                _Pool.schedule_every(::std::chrono::milliseconds(10), &_Timer_probe::_Fire, &_Probe);
+            _MJSYNC_CHECK(_Wait_until([&] { return _Probe._Count.load() >= 3; }));
+            _MJSYNC_CHECK(_Pool.cancel_timer(_Id));
+            ::std::this_thread::sleep_for(::std::chrono::milliseconds(30)); // a firing in progress may finish
+            const int _Count = _Probe._Count;
+            ::std::this_thread::sleep_for(::std::chrono::milliseconds(100));
+            _MJSYNC_CHECK(_Probe._Count == _Count);
+        }
+
+        void _Timers_fire_in_order() {
+            thread_pool _Pool(1);
+            struct _Order {
+                ::std::atomic<int> _Next{0};
+                ::std::atomic<bool> _Wrong{false};
+            } _State;
+            struct _Step {
+                _Order* _State;
+                int _Index;
+
+                static void _Fire(void* const _Arg) noexcept {
+                    _Step* const _Self = static_cast<_Step*>(_Arg);
+                    if (_Self->_State->_Next.fetch_add(1) != _Self->_Index) {
+                        _Self->_State->_Wrong = true;
+                    }
+                }
+            } _Steps[3] = {{&_State, 0}, {&_State, 1}, {&_State, 2}};
+            _Pool.schedule_after(::std::chrono::milliseconds(90), &_Step::_Fire, &_Steps[2]);
+            _Pool.schedule_after(::std::chrono::milliseconds(10), &_Step::_Fire, &_Steps[0]);
+            _Pool.schedule_after(::std::chrono::milliseconds(50), &_Step::_Fire, &_Steps[1]);
+            _MJSYNC_CHECK(_Wait_until([&] { return _State._Next.load() == 3; }));
+            _MJSYNC_CHECK(!_State._Wrong);
+        }
+    } // namespace test
+} // namespace mjx
+
+int main() {
+    using namespace ::mjx::test;
+    static constexpr _Test_case _Cases[] = {
+        {"schedule_after_fires_once", &_Schedule_after_fires_once},
+        {"schedule_at_fires", &_Schedule_at_fires},
+        {"canceled_timer_never_fires", &_Canceled_timer_never_fires},
+        {"periodic_timer_repeats_until_canceled", &_Periodic_timer_repeats_until_canceled},
+        {"timers_fire_in_order", &_Timers_fire_in_order},
+    };
+    return _Run_tests(_Cases);
+}
\ No newline at end of file
@@ -0,0 +1,81 @@
+// test_utils.hpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+#ifndef _MJSYNC_TESTS_TEST_UTILS_HPP_
+#define _MJSYNC_TESTS_TEST_UTILS_HPP_
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <exception>
+#include <thread>
+
+// records a failure without stopping the test case
+#define _MJSYNC_CHECK(_Cond) ::mjx::test::_Check(static_cast<bool>(_Cond), #_Cond, __FILE__, __LINE__)
+
+namespace mjx {
+    namespace test {
+        using _Clock = ::std::chrono::steady_clock;
+
+        struct _Test_case {
+            const char* _Name;
+            void (*_Func)();
+        };
+
+        inline size_t& _Failure_count() noexcept {
+            static size_t _Count = 0;
+            return _Count;
+        }
+
+        inline void _Check(const bool _Cond, const char* const _Expr, const char* const _File, const int _Line) {
+            if (!_Cond) {
+                ::fprintf(stderr, "%s:%d: check failed: %s\n", _File, _Line, _Expr);
+                ++_Failure_count();
+            }
+        }
+
+        template <class _Pred>
+        bool _Wait_until(_Pred&& _Done, const ::std::chrono::milliseconds _Timeout = ::std::chrono::seconds(10)) {
+            // polls the predicate, a hang becomes a failed check rather than a stuck test
+            const _Clock::time_point _Deadline = _Clock::now() + _Timeout;
+            while (!_Done()) {
+                if (_Clock::now() >= _Deadline) {
+                    return false;
+                }
+
+                ::std::this_thread::sleep_for(::std::chrono::milliseconds(1));
+            }
+
+            return true;
+        }
+
+        inline long long _Elapsed_ms(const _Clock::time_point _Start) noexcept {
+            return ::std::chrono::duration_cast<::std::chrono::milliseconds>(_Clock::now() - _Start).count();
+        }
+
+        template <size_t _Size>
+        int _Run_tests(const _Test_case (&_Cases)[_Size]) {
+            // runs every case, an exception fails the case, returns the process exit code
+            for (const _Test_case& _Case : _Cases) {
+                const size_t _Before = _Failure_count();
+                try {
+                    _Case._Func();
+                } catch (const ::std::exception& _Exception) {
+                    ::fprintf(stderr, "%s: unexpected exception: %s\n", _Case._Name, _Exception.what());
+                    ++_Failure_count();
+                } catch (...) {
+                    ::fprintf(stderr, "%s: unexpected exception\n", _Case._Name);
+                    ++_Failure_count();
+                }
+
+                ::printf("[%s] %s\n", _Failure_count() == _Before ? "  OK  " : "FAILED", _Case._Name);
+            }
+
+            return _Failure_count() == 0 ? 0 : 1;
+        }
+    } // namespace test
+} // namespace mjx
+
+#endif // _MJSYNC_TESTS_TEST_UTILS_HPP_
\ No newline at end of file
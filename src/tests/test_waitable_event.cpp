@@ -0,0 +1,144 @@
+// test_waitable_event.cpp
+
+// Copyright (c) Mateusz Jandura. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <atomic>
+#include <chrono>
+#include <mjsync/waitable_event.hpp>
+#include <tests/test_utils.hpp>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace mjx {
+    namespace test {
+        void _Wait_times_out() {
+            waitable_event _Event;
+            _MJSYNC_CHECK(_Event.valid());
+            const _Clock::time_point _Start = _Clock::now();
+            _Event.wait(50);
+            _MJSYNC_CHECK(_Elapsed_ms(_Start) >= 45);
+        }
+
+        void _Notify_wakes_the_waiter() {
+            waitable_event _Event;
+            ::std::atomic<bool> _Woken{false};
+            ::std::thread _Waiter([&] {
+                _Event.wait();
+                _Woken = true;
+            });
+            ::std::this_thread::sleep_for(::std::chrono::milliseconds(20));
+            _MJSYNC_CHECK(!_Woken);
+            _Event.notify();
+            _MJSYNC_CHECK(_Wait_until([&] { return _Woken.load(); }));
+            _Waiter.join();
+        }
+
+        void _Notify_wakes_all_waiters() {
+            waitable_event _Event;
+            ::std::atomic<int> _Woken{0};
+            ::std::vector<::std::thread> _Waiters;
+            for (int _Idx = 0; _Idx < 4; ++_Idx) {
+                _Waiters.emplace_back([&] {
+                    _Event.wait();
+                    ++_Woken;
+                });
+            }
+
+            ::std::this_thread::sleep_for(::std::chrono::milliseconds(20));
+            _Event.notify();
+            _MJSYNC_CHECK(_Wait_until([&] { return _Woken.load() == 4; }));
+            for (::std::thread& _Waiter : _Waiters) {
+                _Waiter.join();
+            }
+        }
+
+        void _Event_stays_set_until_reset() {
+            waitable_event _Event;
+            _Event.notify();
+            _Clock::time_point _Start = _Clock::now();
+            _Event.wait(1000);
+            _Event.wait(1000);
+            _MJSYNC_CHECK(_Elapsed_ms(_Start) < 500);
+
+            _Event.reset();
+            _Start = _Clock::now();
+            _Event.wait(50);
+            _MJSYNC_CHECK(_Elapsed_ms(_Start) >= 45);
+        }
+
+        void _Wait_and_reset_consumes_the_signal() {
+            waitable_event _Event;
+            _Event.notify();
+            _Clock::time_point _Start = _Clock::now();
+            _Event.wait_and_reset(1000);
+            _MJSYNC_CHECK(_Elapsed_ms(_Start) < 500);
+
+            _Start = _Clock::now();
+            _Event.wait(50);
+            _MJSYNC_CHECK(_Elapsed_ms(_Start) >= 45);
+        }
+
+        void _Ping_pong() {
+            waitable_event _Ping;
+            waitable_event _Pong;
+            ::std::atomic<int> _Count{0};
+            ::std::thread _Peer([&] {
+                for (int _Idx = 0; _Idx < 10000; ++_Idx) {
+                    _Ping.wait_and_reset();
+                    ++_Count;
+                    _Pong.notify();
+                }
+            });
+            for (int _Idx = 0; _Idx < 10000; ++_Idx) {
+                _Ping.notify();
+                _Pong.wait_and_reset();
+            }
+
+            _Peer.join();
+            _MJSYNC_CHECK(_Count == 10000);
+        }
+
+        void _Uninitialized_event() {
+            waitable_event _Event(uninitialized_event);
+            _MJSYNC_CHECK(!_Event.valid());
+            _Event.notify(); // no effect
+            _Event.wait(); // returns at once
+        }
+
+        void _Named_event() {
+            waitable_event _Event(L"mjsync_test_named_event");
+#ifdef _WIN32
+            _MJSYNC_CHECK(_Event.valid());
+#else // ^^^ _WIN32 ^^^ / vvv !_WIN32 vvv
+            _MJSYNC_CHECK(!_Event.valid()); // named events are Windows-only
+#endif // _WIN32
+        }
+
+        void _Move_transfers_the_event() {
+            waitable_event _Event;
+            waitable_event _Other(::std::move(_Event));
+            _MJSYNC_CHECK(!_Event.valid());
+            _MJSYNC_CHECK(_Other.valid());
+            _Event = ::std::move(_Other);
+            _MJSYNC_CHECK(_Event.valid());
+        }
+    } // namespace test
+} // namespace mjx
+
+int main() {
+    using namespace ::mjx::test;
+    static constexpr _Test_case _Cases[] = {
+        {"wait_times_out", &_Wait_times_out},
+        {"notify_wakes_the_waiter", &_Notify_wakes_the_waiter},
+        {"notify_wakes_all_waiters", &_Notify_wakes_all_waiters},
+        {"event_stays_set_until_reset", &_Event_stays_set_until_reset},
+        {"wait_and_reset_consumes_the_signal", &_Wait_and_reset_consumes_the_signal},
+        {"ping_pong", &_Ping_pong},
+        {"uninitialized_event", &_Uninitialized_event},
+        {"named_event", &_Named_event},
+        {"move_transfers_the_event", &_Move_transfers_the_event},
+    };
+    return _Run_tests(_Cases);
+}
\ No newline at end of file